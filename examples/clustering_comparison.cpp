@@ -0,0 +1,104 @@
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/space_filling_curve.hpp>
+#include <htool/htool.hpp>
+
+using namespace std;
+using namespace htool;
+
+class MyMatrix : public VirtualGenerator<double> {
+    const vector<double> &p;
+    int space_dim;
+
+  public:
+    // Constructor
+    MyMatrix(int space_dim0, int nr, const vector<double> &p0) : VirtualGenerator(nr, nr), p(p0), space_dim(space_dim0) {}
+    double get_coef(const int &k, const int &j) const {
+        return 1. / (1e-3 + std::sqrt(std::inner_product(p.begin() + space_dim * k, p.begin() + space_dim * k + space_dim, p.begin() + space_dim * j, double(0), std::plus<double>(), [](double u, double v) { return (u - v) * (u - v); })));
+    }
+
+    void copy_submatrix(int M, int N, const int *const rows, const int *const cols, double *ptr) const override {
+        for (int j = 0; j < M; j++) {
+            for (int k = 0; k < N; k++) {
+                ptr[j + M * k] = this->get_coef(rows[j], cols[k]);
+            }
+        }
+    }
+
+    std::vector<double> operator*(std::vector<double> a) {
+        std::vector<double> result(nr, 0);
+        for (int i = 0; i < nr; i++) {
+            for (int k = 0; k < nc; k++) {
+                result[i] += this->get_coef(i, k) * a[k];
+            }
+        }
+        return result;
+    }
+};
+
+// Cluster tree build, assembly, compression and error of a product, times are the maximum over the processes
+template <typename ClusteringType>
+void compare(const std::string &name, int size, const vector<double> &p, MyMatrix &A, const vector<double> &x, const vector<double> &reference, double epsilon, double eta) {
+    int rankWorld;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+
+    std::shared_ptr<Cluster<ClusteringType>> t = make_shared<Cluster<ClusteringType>>(3);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double cluster_time = MPI_Wtime();
+    t->build(size, p.data(), 2);
+    cluster_time = MPI_Wtime() - cluster_time;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double assembly_time = MPI_Wtime();
+    HMatrix<double> HA(t, t, epsilon, eta);
+    HA.build(A, p.data());
+    assembly_time = MPI_Wtime() - assembly_time;
+
+    double times[2] = {cluster_time, assembly_time};
+    MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    double compression = HA.compression_ratio();
+    std::vector<double> result(size, 0);
+    HA.mvprod_global_to_global(x.data(), result.data());
+
+    if (rankWorld == 0) {
+        cout << name << " : cluster tree " << times[0] << " s, assembly " << times[1] << " s, compression ratio " << compression << ", relative error " << norm2(reference - result) / norm2(reference) << endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Usage: Clustering_comparison [number of points]
+    int size = argc > 1 ? StrToNbr<int>(argv[1]) : 10000;
+
+    // Htool parameters
+    double epsilon = 1e-4;
+    double eta     = 10;
+
+    // Points on the unit sphere
+    srand(1);
+    vector<double> p(3 * size);
+    for (int j = 0; j < size; j++) {
+        double z     = 2 * ((double)rand() / (double)(RAND_MAX)) - 1;
+        double theta = ((double)rand() / (double)(RAND_MAX));
+        p[3 * j + 0] = std::sqrt(1 - z * z) * cos(2 * M_PI * theta);
+        p[3 * j + 1] = std::sqrt(1 - z * z) * sin(2 * M_PI * theta);
+        p[3 * j + 2] = z;
+    }
+
+    MyMatrix A(3, size, p);
+    std::vector<double> x(size, 1);
+    std::vector<double> reference = A * x;
+
+    // PCA against the orderings along space-filling curves
+    compare<PCARegularClustering>("PCA regular splitting  ", size, p, A, x, reference, epsilon, eta);
+    compare<PCAGeometricClustering>("PCA geometric splitting", size, p, A, x, reference, epsilon, eta);
+    compare<MortonClustering>("Morton curve           ", size, p, A, x, reference, epsilon, eta);
+    compare<HilbertClustering>("Hilbert curve          ", size, p, A, x, reference, epsilon, eta);
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+}
@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# Initialization
+MY_PATH="`dirname \"$0\"`"
+MY_PATH="`( cd \"$MY_PATH\" && pwd )`"
+cd ${MY_PATH}
+cd ../
+mkdir -p build & cd build
+cmake ../
+make Clustering_comparison
+
+# Arguments
+nb_points=20000
+
+# Run
+mpirun -np 2 ./examples/Clustering_comparison ${nb_points}
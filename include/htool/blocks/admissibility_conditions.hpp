@@ -14,7 +14,14 @@ class VirtualAdmissibilityCondition {
 class RjasanowSteinbach final : public VirtualAdmissibilityCondition {
   public:
     bool ComputeAdmissibility(const VirtualCluster &target, const VirtualCluster &source, double eta) const override {
-        bool admissible = 2 * std::min(target.get_rad(), source.get_rad()) < eta * std::max((norm2(target.get_ctr() - source.get_ctr()) - target.get_rad() - source.get_rad()), 0.);
+        // Distance between centers without temporary vector
+        const double *target_ctr = target.get_ctr_data();
+        const double *source_ctr = source.get_ctr_data();
+        double distance          = 0;
+        for (int p = 0; p < target.get_space_dim(); p++) {
+            distance += (target_ctr[p] - source_ctr[p]) * (target_ctr[p] - source_ctr[p]);
+        }
+        bool admissible = 2 * std::min(target.get_rad(), source.get_rad()) < eta * std::max((std::sqrt(distance) - target.get_rad() - source.get_rad()), 0.);
         return admissible;
     }
 };
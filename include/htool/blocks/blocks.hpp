@@ -290,6 +290,7 @@ class Block {
     }
 
     std::size_t get_size() const { return std::size_t(this->t.get_size()) * std::size_t(this->s.get_size()); }
+    int get_nb_sons() const { return sons.size(); }
     const Block &get_son(int j) const { return *(sons[j]); }
     Block &get_son(int j) { return *(sons[j]); }
 
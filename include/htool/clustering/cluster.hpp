@@ -10,6 +10,34 @@
 #include <stack>
 
 namespace htool {
+
+// Nodes of at least cluster_task_size points are built by OpenMP tasks of their own, see PCA::recursive_build
+const int cluster_task_size  = 1 << 12;
+const int cluster_chunk_size = 1 << 14;
+
+// Partial reductions f(begin, end, partial) over chunks of cluster_chunk_size of [0, nb_pt), each partial starting from init.
+// Chunks do not depend on the number of threads, so that combining the partials in order gives the same result with any
+// number of threads, and they are computed by OpenMP tasks when there are several of them
+template <typename F>
+std::vector<double> reduce_by_chunks(int nb_pt, const std::vector<double> &init, F f) {
+    int width     = init.size();
+    int nb_chunks = std::max((nb_pt + cluster_chunk_size - 1) / cluster_chunk_size, 1);
+    std::vector<double> partials(std::size_t(nb_chunks) * width);
+    for (int c = 0; c < nb_chunks; c++) {
+        std::copy(init.begin(), init.end(), partials.begin() + std::size_t(c) * width);
+    }
+    for (int c = 0; c < nb_chunks; c++) {
+#if _OPENMP
+#    pragma omp task shared(partials, f) if (nb_chunks > 1)
+#endif
+        f(c * cluster_chunk_size, std::min(nb_pt, (c + 1) * cluster_chunk_size), partials.data() + std::size_t(c) * width);
+    }
+#if _OPENMP
+#    pragma omp taskwait
+#endif
+    return partials;
+}
+
 template <typename ClusteringType>
 class Cluster : public VirtualCluster {
   protected:
@@ -156,9 +184,190 @@ class Cluster : public VirtualCluster {
         this->build(nb_pt0, x0, std::vector<double>(nb_pt0, 0).data(), std::vector<double>(nb_pt0, 1).data(), MasterOffset0, nb_sons, comm);
     }
 
+    // distributed build cluster tree, each process gives only its nb_pt0 points, numbered after the ones of the previous
+    // processes. The root is split with collective reductions and a parallel splitting in one son per process, each son
+    // receives its points and builds its subtree, which is then sent to all processes with the permutation
+    void build_distributed(int nb_pt0, const double *const x0, const double *const r0, const double *const g0, int nb_sons = -1, MPI_Comm comm = MPI_COMM_WORLD) {
+        // MPI parameters
+        int rankWorld, sizeWorld;
+        MPI_Comm_size(comm, &sizeWorld);
+        MPI_Comm_rank(comm, &rankWorld);
+
+        // Impossible value for nb_sons
+        if (nb_sons == 0 || nb_sons == 1)
+            throw std::string("Impossible value for nb_sons:" + NbrToStr<int>(nb_sons)); // LCOV_EXCL_LINE
+
+        // nb_sons=-1 is automatic mode
+        if (nb_sons == -1) {
+            nb_sons = 2;
+        }
+
+        // Global numbering
+        int global_offset = 0;
+        int global_nb_pt  = nb_pt0;
+        MPI_Exscan(&nb_pt0, &global_offset, 1, MPI_INT, MPI_SUM, comm);
+        MPI_Allreduce(MPI_IN_PLACE, &global_nb_pt, 1, MPI_INT, MPI_SUM, comm);
+        if (rankWorld == 0) {
+            global_offset = 0;
+        }
+
+        // Initialisation of root
+        this->rad   = 0;
+        this->size  = global_nb_pt;
+        this->nb_pt = global_nb_pt;
+        this->rank  = -1;
+        this->MasterOffset.resize(sizeWorld);
+        this->LocalPermutation = false;
+        this->depth            = 0;
+        this->permutation->resize(global_nb_pt);
+
+        // Sons of the root, one per process
+        std::vector<double> dir = clustering_type.build_distributed_root(x0, r0, g0, nb_pt0, this, comm);
+        std::vector<int> targets(nb_pt0, 0);
+        if (sizeWorld > 1) {
+            targets = clustering_type.distributed_splitting(x0, nb_pt0, global_offset, this, sizeWorld, dir, comm);
+        }
+        std::vector<int> send_counts(sizeWorld, 0), sizes(sizeWorld);
+        for (int j = 0; j < nb_pt0; j++) {
+            send_counts[targets[j]]++;
+        }
+        MPI_Allreduce(send_counts.data(), sizes.data(), sizeWorld, MPI_INT, MPI_SUM, comm);
+
+        int count = 0;
+        for (int p = 0; p < sizeWorld; p++) {
+            this->sons.emplace_back(new Cluster(this, p, this->depth + 1, this->permutation));
+            this->sons[p]->set_offset(count);
+            this->sons[p]->set_size(sizes[p]);
+            this->sons[p]->set_rank(p);
+            this->MasterOffset[p] = std::pair<int, int>(count, sizes[p]);
+            if (rankWorld == p) {
+                this->local_cluster = this->sons[p].get();
+            }
+            count += sizes[p];
+        }
+
+        // Points sent to the process of their son
+        std::vector<int> recv_counts(sizeWorld), send_displs(sizeWorld, 0), recv_displs(sizeWorld, 0);
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+        std::partial_sum(send_counts.begin(), send_counts.end() - 1, send_displs.begin() + 1);
+        std::partial_sum(recv_counts.begin(), recv_counts.end() - 1, recv_displs.begin() + 1);
+        int local_nb_pt = sizes[rankWorld];
+
+        std::vector<double> send_x(space_dim * nb_pt0), send_r(nb_pt0), send_g(nb_pt0);
+        std::vector<int> send_nums(nb_pt0), positions(send_displs);
+        for (int j = 0; j < nb_pt0; j++) {
+            int i = positions[targets[j]]++;
+            std::copy_n(x0 + space_dim * j, space_dim, send_x.data() + space_dim * i);
+            send_r[i]    = r0[j];
+            send_g[i]    = g0[j];
+            send_nums[i] = global_offset + j;
+        }
+
+        std::vector<double> local_x(space_dim * local_nb_pt), local_r(local_nb_pt), local_g(local_nb_pt);
+        std::vector<int> local_nums(local_nb_pt);
+        MPI_Alltoallv(send_r.data(), send_counts.data(), send_displs.data(), MPI_DOUBLE, local_r.data(), recv_counts.data(), recv_displs.data(), MPI_DOUBLE, comm);
+        MPI_Alltoallv(send_g.data(), send_counts.data(), send_displs.data(), MPI_DOUBLE, local_g.data(), recv_counts.data(), recv_displs.data(), MPI_DOUBLE, comm);
+        MPI_Alltoallv(send_nums.data(), send_counts.data(), send_displs.data(), MPI_INT, local_nums.data(), recv_counts.data(), recv_displs.data(), MPI_INT, comm);
+        for (int p = 0; p < sizeWorld; p++) {
+            send_counts[p] *= space_dim;
+            send_displs[p] *= space_dim;
+            recv_counts[p] *= space_dim;
+            recv_displs[p] *= space_dim;
+        }
+        MPI_Alltoallv(send_x.data(), send_counts.data(), send_displs.data(), MPI_DOUBLE, local_x.data(), recv_counts.data(), recv_displs.data(), MPI_DOUBLE, comm);
+
+        // Subtree of the local son, built from its points numbered locally
+        std::stack<Cluster *> s;
+        std::stack<std::vector<int>> n;
+        std::vector<int> local_num(local_nb_pt);
+        std::iota(local_num.begin(), local_num.end(), 0);
+        s.push(this->local_cluster);
+        n.push(local_num);
+        clustering_type.recursive_build(local_x.data(), local_r.data(), local_g.data(), nb_sons, comm, s, n);
+
+        int depths[2] = {-this->min_depth, this->max_depth};
+        MPI_Allreduce(MPI_IN_PLACE, depths, 2, MPI_INT, MPI_MAX, comm);
+        this->min_depth = -depths[0];
+        this->max_depth = depths[1];
+
+        // Subtrees of the other processes, in preorder, as offset, size and number of sons, and radius and center
+        std::vector<int> tree_ints;
+        std::vector<double> tree_doubles;
+        s.push(this->local_cluster);
+        while (!s.empty()) {
+            Cluster *curr = s.top();
+            s.pop();
+            tree_ints.insert(tree_ints.end(), {curr->offset, curr->size, int(curr->sons.size())});
+            tree_doubles.push_back(curr->rad);
+            tree_doubles.insert(tree_doubles.end(), curr->ctr.begin(), curr->ctr.end());
+            for (int p = curr->sons.size() - 1; p >= 0; p--) {
+                s.push(curr->sons[p].get());
+            }
+        }
+
+        std::vector<int> tree_counts(sizeWorld), tree_displs(sizeWorld, 0);
+        int nb_nodes = tree_doubles.size() / (1 + space_dim);
+        MPI_Allgather(&nb_nodes, 1, MPI_INT, tree_counts.data(), 1, MPI_INT, comm);
+        std::partial_sum(tree_counts.begin(), tree_counts.end() - 1, tree_displs.begin() + 1);
+        int nb_all_nodes = tree_displs.back() + tree_counts.back();
+        std::vector<int> all_tree_ints(3 * nb_all_nodes);
+        std::vector<double> all_tree_doubles((1 + space_dim) * nb_all_nodes);
+        for (int p = 0; p < sizeWorld; p++) {
+            tree_counts[p] *= 3;
+            tree_displs[p] *= 3;
+        }
+        MPI_Allgatherv(tree_ints.data(), tree_ints.size(), MPI_INT, all_tree_ints.data(), tree_counts.data(), tree_displs.data(), MPI_INT, comm);
+        for (int p = 0; p < sizeWorld; p++) {
+            tree_counts[p] = tree_counts[p] / 3 * (1 + space_dim);
+            tree_displs[p] = tree_displs[p] / 3 * (1 + space_dim);
+        }
+        MPI_Allgatherv(tree_doubles.data(), tree_doubles.size(), MPI_DOUBLE, all_tree_doubles.data(), tree_counts.data(), tree_displs.data(), MPI_DOUBLE, comm);
+
+        for (int p = 0; p < sizeWorld; p++) {
+            if (p == rankWorld) {
+                continue;
+            }
+            int node = tree_displs[p] / (1 + space_dim);
+            s.push(this->sons[p].get());
+            while (!s.empty()) {
+                Cluster *curr = s.top();
+                s.pop();
+                curr->offset = all_tree_ints[3 * node];
+                curr->size   = all_tree_ints[3 * node + 1];
+                curr->rank   = p;
+                curr->rad    = all_tree_doubles[(1 + space_dim) * node];
+                std::copy_n(all_tree_doubles.begin() + (1 + space_dim) * node + 1, space_dim, curr->ctr.begin());
+                int curr_nb_sons = all_tree_ints[3 * node + 2];
+                for (int q = 0; q < curr_nb_sons; q++) {
+                    curr->add_son(curr->counter * curr_nb_sons + q, curr->depth + 1, this->permutation);
+                }
+                for (int q = curr_nb_sons - 1; q >= 0; q--) {
+                    s.push(curr->sons[q].get());
+                }
+                node++;
+            }
+        }
+
+        // Permutation, from local numbers of the local son to global numbers
+        for (int i = this->local_cluster->offset; i < this->local_cluster->offset + local_nb_pt; i++) {
+            (*this->permutation)[i] = local_nums[(*this->permutation)[i]];
+        }
+        std::vector<int> perm_counts(sizeWorld), perm_displs(sizeWorld);
+        for (int p = 0; p < sizeWorld; p++) {
+            perm_counts[p] = this->MasterOffset[p].second;
+            perm_displs[p] = this->MasterOffset[p].first;
+        }
+        MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, this->permutation->data(), perm_counts.data(), perm_displs.data(), MPI_INT, comm);
+    }
+
+    void build_distributed(int nb_pt0, const double *const x0, int nb_sons = -1, MPI_Comm comm = MPI_COMM_WORLD) {
+        this->build_distributed(nb_pt0, x0, std::vector<double>(nb_pt0, 0).data(), std::vector<double>(nb_pt0, 1).data(), nb_sons, comm);
+    }
+
     //// Getters for local data
     double get_rad() const { return rad; }
     const std::vector<double> &get_ctr() const { return ctr; }
+    const double *get_ctr_data() const { return ctr.data(); }
     const VirtualCluster &get_son(const int &j) const { return *(sons[j]); }
     VirtualCluster &get_son(const int &j) { return *(sons[j]); }
     Cluster *get_son_ptr(const int &j) { return sons[j].get(); }
@@ -392,7 +601,7 @@ class Cluster : public VirtualCluster {
 
                 std::vector<std::string> infos_str = {NbrToStr(curr->get_nb_sons()), NbrToStr(curr->get_rank()), NbrToStr(curr->get_offset()), NbrToStr(curr->get_size()), NbrToStr(curr->get_rad())};
                 for (int p = 0; p < this->space_dim; p++) {
-                    infos_str.push_back(NbrToStr(curr->get_ctr()[p]));
+                    infos_str.push_back(NbrToStr(curr->get_ctr_data()[p]));
                 }
 
                 std::string infos = join("|", infos_str);
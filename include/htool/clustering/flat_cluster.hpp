@@ -0,0 +1,306 @@
+#ifndef HTOOL_CLUSTERING_FLAT_CLUSTER_HPP
+#define HTOOL_CLUSTERING_FLAT_CLUSTER_HPP
+
+#include "virtual_cluster.hpp"
+#include <fstream>
+#include <stack>
+
+namespace htool {
+
+// Immutable copy of a built cluster tree with its nodes in breadth-first order and their data in arrays, the sons of a
+// node are consecutive nodes. Nodes are FlatCluster objects stored contiguously and viewing the arrays of the tree, so
+// that traversals of the tree, as the construction of block trees, do not follow pointers across the heap.
+class FlatCluster : public VirtualCluster {
+  protected:
+    struct Tree {
+        // Nodes in breadth-first order, sons of node i are nodes first_sons[i] to first_sons[i] + nb_sons[i] - 1
+        std::vector<int> offsets;
+        std::vector<int> sizes;
+        std::vector<int> ranks;
+        std::vector<int> depths;
+        std::vector<int> counters;
+        std::vector<int> first_sons;
+        std::vector<int> nb_sons;
+        std::vector<double> rads;
+        std::vector<double> ctrs; // center of node i starts at space_dim * i
+        std::vector<FlatCluster> nodes;
+
+        int space_dim;
+        int minclustersize;
+        int ndofperelt;
+        int max_depth;
+        int min_depth;
+        int local_cluster;
+        bool LocalPermutation;
+        std::shared_ptr<std::vector<int>> permutation;
+        std::vector<std::pair<int, int>> MasterOffset;
+    };
+
+    std::shared_ptr<Tree> tree_ptr;
+    Tree *tree;
+    int index;
+
+    // Node constructor
+    FlatCluster(Tree *tree0, int index0) : tree(tree0), index(index0) {}
+
+    // Copy of the subtree of root, with the depths and counters of a local cluster tree when local is true
+    FlatCluster(const VirtualCluster &root, bool local) : tree_ptr(std::make_shared<Tree>()), tree(tree_ptr.get()), index(0) {
+        const VirtualCluster *local_cluster = local ? &root : &(root.get_local_cluster());
+        int space_dim                       = root.get_space_dim();
+
+        std::vector<const VirtualCluster *> queue(1, &root);
+        for (int i = 0; i < queue.size(); i++) {
+            const VirtualCluster *curr = queue[i];
+            tree->offsets.push_back(curr->get_offset());
+            tree->sizes.push_back(curr->get_size());
+            tree->ranks.push_back(curr->get_rank());
+            tree->depths.push_back(curr->get_depth());
+            tree->counters.push_back(curr->get_counter());
+            tree->first_sons.push_back(queue.size());
+            tree->nb_sons.push_back(curr->get_nb_sons());
+            tree->rads.push_back(curr->get_rad());
+            tree->ctrs.insert(tree->ctrs.end(), curr->get_ctr_data(), curr->get_ctr_data() + space_dim);
+            if (curr == local_cluster) {
+                tree->local_cluster = i;
+            }
+            for (int p = 0; p < curr->get_nb_sons(); p++) {
+                queue.push_back(&(curr->get_son(p)));
+            }
+        }
+        int nb_nodes = queue.size();
+
+        // Local cluster trees are numbered from their root, as Cluster::get_local_cluster_tree
+        if (local) {
+            tree->depths[0]   = 0;
+            tree->counters[0] = 0;
+            for (int i = 0; i < nb_nodes; i++) {
+                for (int p = 0; p < tree->nb_sons[i]; p++) {
+                    tree->depths[tree->first_sons[i] + p]   = tree->depths[i] + 1;
+                    tree->counters[tree->first_sons[i] + p] = tree->counters[i] * tree->nb_sons[i] + p;
+                }
+            }
+        }
+
+        tree->space_dim      = space_dim;
+        tree->minclustersize = root.get_minclustersize();
+        tree->ndofperelt     = root.get_ndofperelt();
+        tree->permutation    = std::make_shared<std::vector<int>>(root.get_perm());
+        if (local) {
+            tree->LocalPermutation = false;
+            tree->MasterOffset     = std::vector<std::pair<int, int>>(1, std::pair<int, int>(root.get_offset(), root.get_size()));
+            tree->max_depth        = 0;
+            tree->min_depth        = -1;
+            for (int i = 0; i < nb_nodes; i++) {
+                if (tree->nb_sons[i] == 0) {
+                    tree->max_depth = std::max(tree->max_depth, tree->depths[i]);
+                    tree->min_depth = (tree->min_depth < 0) ? tree->depths[i] : std::min(tree->min_depth, tree->depths[i]);
+                }
+            }
+        } else {
+            tree->LocalPermutation = root.IsLocal();
+            tree->MasterOffset     = root.get_masteroffset();
+            tree->max_depth        = root.get_max_depth();
+            tree->min_depth        = root.get_min_depth();
+        }
+
+        tree->nodes.reserve(nb_nodes);
+        for (int i = 0; i < nb_nodes; i++) {
+            tree->nodes.push_back(FlatCluster(tree, i));
+        }
+    }
+
+  public:
+    // Root constructor, copy of the tree of cluster
+    explicit FlatCluster(const VirtualCluster &cluster) : FlatCluster(*cluster.get_root(), false) {}
+
+    // FlatCluster cannot be built, it is a copy of a built cluster tree
+    void build(int, const double *const, const double *const, const double *const, int = -1, MPI_Comm = MPI_COMM_WORLD) {
+        throw std::logic_error("[Htool error] FlatCluster cannot be built, it is a copy of a built cluster tree"); // LCOV_EXCL_LINE
+    }
+    void build(int, const double *const, int = -1, MPI_Comm = MPI_COMM_WORLD) {
+        throw std::logic_error("[Htool error] FlatCluster cannot be built, it is a copy of a built cluster tree"); // LCOV_EXCL_LINE
+    }
+    void build(int, const double *const, const double *const, const double *const, const int *const, int = -1, MPI_Comm = MPI_COMM_WORLD) {
+        throw std::logic_error("[Htool error] FlatCluster cannot be built, it is a copy of a built cluster tree"); // LCOV_EXCL_LINE
+    }
+    void build(int, const double *const, const int *const, int = -1, MPI_Comm = MPI_COMM_WORLD) {
+        throw std::logic_error("[Htool error] FlatCluster cannot be built, it is a copy of a built cluster tree"); // LCOV_EXCL_LINE
+    }
+
+    //// Getters for local data
+    double get_rad() const { return tree->rads[index]; }
+    // View of the space_dim coordinates of the center in the centers of the tree
+    const double *get_ctr() const { return tree->ctrs.data() + tree->space_dim * index; }
+    const double *get_ctr_data() const { return tree->ctrs.data() + tree->space_dim * index; }
+    const VirtualCluster &get_son(const int &j) const { return tree->nodes[tree->first_sons[index] + j]; }
+    VirtualCluster &get_son(const int &j) { return tree->nodes[tree->first_sons[index] + j]; }
+    int get_depth() const { return tree->depths[index]; }
+    int get_rank() const { return tree->ranks[index]; }
+    int get_offset() const { return tree->offsets[index]; }
+    int get_size() const { return tree->sizes[index]; }
+    int get_nb_sons() const { return tree->nb_sons[index]; }
+    int get_counter() const { return tree->counters[index]; }
+    int get_index() const { return index; }
+    const VirtualCluster &get_local_cluster(MPI_Comm = MPI_COMM_WORLD) const { return tree->nodes[tree->local_cluster]; }
+
+    std::shared_ptr<VirtualCluster> get_local_cluster_tree(MPI_Comm = MPI_COMM_WORLD) {
+        return std::shared_ptr<VirtualCluster>(new FlatCluster(tree->nodes[tree->local_cluster], true));
+    }
+
+    std::vector<int> get_local_perm() const {
+        if (!tree->LocalPermutation) {
+            throw std::logic_error("[Htool error] Permutation is not local, get_local_perm cannot be used"); // LCOV_EXCL_LINE
+        } else {
+            return std::vector<int>(tree->permutation->begin() + get_local_offset(), tree->permutation->begin() + get_local_offset() + get_local_size());
+        }
+    }
+
+    bool IsLocal() const { return tree->LocalPermutation; }
+    bool IsLeaf() const { return tree->nb_sons[index] == 0; }
+
+    //// Getters for global data
+    int get_space_dim() const { return tree->space_dim; }
+    int get_minclustersize() const { return tree->minclustersize; }
+    int get_ndofperelt() const { return tree->ndofperelt; }
+    int get_max_depth() const { return tree->max_depth; }
+    int get_min_depth() const { return tree->min_depth; }
+    const std::vector<int> &get_perm() const { return *(tree->permutation); }
+    int get_perm(int i) const { return (*(tree->permutation))[i]; }
+    std::vector<int>::const_iterator get_perm_start() const { return tree->permutation->begin(); }
+    const VirtualCluster *get_root() const { return &(tree->nodes[0]); }
+
+    //// Getter for MasterOffsets
+    int get_local_offset() const { return tree->offsets[tree->local_cluster]; }
+    int get_local_size() const { return tree->sizes[tree->local_cluster]; }
+    const std::vector<std::pair<int, int>> &get_masteroffset() const { return tree->MasterOffset; }
+    std::pair<int, int> get_masteroffset(int i) const { return tree->MasterOffset[i]; }
+
+    //// Setters, FlatCluster is immutable
+    void set_rank(int) { throw std::logic_error("[Htool error] FlatCluster cannot be modified"); }                    // LCOV_EXCL_LINE
+    void set_offset(int) { throw std::logic_error("[Htool error] FlatCluster cannot be modified"); }                  // LCOV_EXCL_LINE
+    void set_size(int) { throw std::logic_error("[Htool error] FlatCluster cannot be modified"); }                    // LCOV_EXCL_LINE
+    void set_minclustersize(unsigned int) { throw std::logic_error("[Htool error] FlatCluster cannot be modified"); } // LCOV_EXCL_LINE
+    void set_ndofperelt(unsigned int) { throw std::logic_error("[Htool error] FlatCluster cannot be modified"); }     // LCOV_EXCL_LINE
+
+    // Output
+    void print(MPI_Comm comm = MPI_COMM_WORLD) const {
+        int rankWorld;
+        MPI_Comm_rank(comm, &rankWorld);
+        if (rankWorld == 0) {
+            if (!tree->permutation->empty()) {
+                std::cout << '[';
+                for (std::vector<int>::const_iterator i = get_perm_start() + get_offset(); i != get_perm_start() + get_offset() + get_size(); ++i)
+                    std::cout << *i << ',';
+                std::cout << "\b]" << std::endl;
+            }
+
+            for (int p = 0; p < get_nb_sons(); p++) {
+                get_son(p).print();
+            }
+        }
+    }
+
+    // Same output as Cluster::save_geometry, nodes of a given depth are numbered in the same depth-first order
+    void save_geometry(const double *const x0, std::string filename, const std::vector<int> &depths, MPI_Comm comm = MPI_COMM_WORLD) const {
+        int rankWorld;
+        MPI_Comm_rank(comm, &rankWorld);
+        if (rankWorld == 0) {
+            std::ofstream output(filename + ".csv");
+            const std::vector<int> &permutation = *(tree->permutation);
+
+            // Permuted geometric points
+            for (int d = 0; d < tree->space_dim; d++) {
+                output << "x_" << d << ",";
+                for (int i = 0; i < permutation.size(); ++i) {
+                    output << x0[tree->space_dim * permutation[i] + d];
+                    if (i != permutation.size() - 1) {
+                        output << ",";
+                    }
+                }
+                output << "\n";
+            }
+
+            std::vector<std::vector<int>> outputs(depths.size(), std::vector<int>(permutation.size()));
+            std::vector<int> counters(depths.size(), 0);
+            std::stack<int> s;
+            s.push(index);
+            while (!s.empty()) {
+                int i = s.top();
+                s.pop();
+                std::vector<int>::const_iterator it = std::find(depths.begin(), depths.end(), tree->depths[i]);
+                if (it != depths.end()) {
+                    int p = std::distance(depths.begin(), it);
+                    std::fill_n(outputs[p].begin() + tree->offsets[i], tree->sizes[i], counters[p]);
+                    counters[p] += 1;
+                }
+                for (int q = 0; q < tree->nb_sons[i]; q++) {
+                    s.push(tree->first_sons[i] + q);
+                }
+            }
+
+            for (int p = 0; p < depths.size(); p++) {
+                output << depths[p] << ",";
+
+                for (int i = 0; i < outputs[p].size(); ++i) {
+                    output << outputs[p][i];
+                    if (i != outputs[p].size() - 1) {
+                        output << ',';
+                    }
+                }
+                output << "\n";
+            }
+        }
+    }
+
+    // Same output as Cluster::save_cluster
+    void save_cluster(std::string filename, MPI_Comm comm = MPI_COMM_WORLD) const {
+        int rankWorld;
+        MPI_Comm_rank(comm, &rankWorld);
+        if (rankWorld == 0) {
+            // Permutation
+            std::ofstream output_permutation(filename + "_permutation.csv");
+            const std::vector<int> &permutation = *(tree->permutation);
+
+            for (int i = 0; i < permutation.size(); i++) {
+                output_permutation << permutation[i];
+                if (i != permutation.size() - 1) {
+                    output_permutation << ",";
+                }
+            }
+
+            // Tree
+            std::ofstream output_tree(filename + "_tree.csv");
+            std::vector<std::vector<std::string>> outputs(tree->max_depth + 1);
+            std::vector<int> queue(1, index);
+            for (int n = 0; n < queue.size(); n++) {
+                int i                              = queue[n];
+                std::vector<std::string> infos_str = {NbrToStr(tree->nb_sons[i]), NbrToStr(tree->ranks[i]), NbrToStr(tree->offsets[i]), NbrToStr(tree->sizes[i]), NbrToStr(tree->rads[i])};
+                for (int p = 0; p < tree->space_dim; p++) {
+                    infos_str.push_back(NbrToStr(tree->ctrs[tree->space_dim * i + p]));
+                }
+                outputs[tree->depths[i]].push_back(join("|", infos_str));
+
+                for (int q = 0; q < tree->nb_sons[i]; q++) {
+                    queue.push_back(tree->first_sons[i] + q);
+                }
+            }
+
+            for (int p = 0; p < outputs.size(); p++) {
+                for (int i = 0; i < outputs[p].size(); ++i) {
+                    output_tree << outputs[p][i];
+                    if (i != outputs[p].size() - 1) {
+                        output_tree << ',';
+                    }
+                }
+                output_tree << "\n";
+            }
+        }
+    }
+
+    void read_cluster(std::string, std::string, MPI_Comm = MPI_COMM_WORLD) {
+        throw std::logic_error("[Htool error] FlatCluster cannot be read, read a Cluster and copy it"); // LCOV_EXCL_LINE
+    }
+};
+
+} // namespace htool
+#endif
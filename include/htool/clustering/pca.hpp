@@ -19,115 +19,208 @@ class PCA {
         MPI_Comm_size(comm, &sizeWorld);
         MPI_Comm_rank(comm, &rankWorld);
 
+        if (!s.empty() && s.top()->get_space_dim() != 2 && s.top()->get_space_dim() != 3) {
+            throw std::logic_error("[Htool error] clustering not define for spatial dimension !=2 and !=3"); // LCOV_EXCL_LINE
+        }
+
+        std::vector<Cluster<PCA> *> clusters;
+        std::vector<std::vector<int>> nums;
         while (!s.empty()) {
-            Cluster<PCA> *curr   = s.top();
-            std::vector<int> num = n.top();
+            clusters.push_back(s.top());
+            nums.push_back(std::move(n.top()));
             s.pop();
             n.pop();
+        }
 
-            int curr_nb_sons = curr->get_depth() == 0 ? sizeWorld : nb_sons;
+        // Independent subtrees are built by OpenMP tasks, the tree does not depend on the number of threads
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp parallel
+#    pragma omp single
+#endif
+        for (int i = 0; i < clusters.size(); i++) {
+            Cluster<PCA> *curr    = clusters[i];
+            std::vector<int> *num = &(nums[i]);
+#if _OPENMP
+#    pragma omp task if (num->size() >= cluster_task_size)
+#endif
+            build_node(x, r, g, nb_sons, rankWorld, sizeWorld, curr, *num);
+        }
+    }
 
-            // Mass of the cluster
-            int nb_pt = curr->get_size();
-            double G  = 0;
-            for (int j = 0; j < nb_pt; j++) {
-                G += g[num[j]];
-            }
+    // Node curr with the points num, and its subtree
+    void build_node(const double *const x, const double *const r, const double *const g, int nb_sons, int rankWorld, int sizeWorld, Cluster<PCA> *curr, std::vector<int> &num) {
+        int curr_nb_sons = curr->get_depth() == 0 ? sizeWorld : nb_sons;
+        int space_dim    = curr->get_space_dim();
 
-            // Center of the cluster
-            std::vector<double> xc(curr->get_space_dim(), 0);
-            for (int j = 0; j < nb_pt; j++) {
-                for (int p = 0; p < curr->get_space_dim(); p++) {
-                    xc[p] += g[num[j]] * x[curr->get_space_dim() * num[j] + p];
+        // Mass and center of the cluster
+        int nb_pt                     = curr->get_size();
+        std::vector<double> mass_ctrs = reduce_by_chunks(nb_pt, std::vector<double>(1 + space_dim, 0), [&](int begin, int end, double *partial) {
+            for (int j = begin; j < end; j++) {
+                partial[0] += g[num[j]];
+            }
+            for (int j = begin; j < end; j++) {
+                for (int p = 0; p < space_dim; p++) {
+                    partial[1 + p] += g[num[j]] * x[space_dim * num[j] + p];
                 }
             }
-            std::transform(xc.begin(), xc.end(), xc.begin(), std::bind(std::multiplies<double>(), std::placeholders::_1, 1. / G));
+        });
+        double G = 0;
+        std::vector<double> xc(space_dim, 0);
+        for (int c = 0; c < mass_ctrs.size(); c += 1 + space_dim) {
+            G += mass_ctrs[c];
+            for (int p = 0; p < space_dim; p++) {
+                xc[p] += mass_ctrs[c + 1 + p];
+            }
+        }
+        std::transform(xc.begin(), xc.end(), xc.begin(), std::bind(std::multiplies<double>(), std::placeholders::_1, 1. / G));
 
-            curr->set_ctr(xc);
+        curr->set_ctr(xc);
 
-            // Radius and covariance matrix
-            Matrix<double> cov(curr->get_space_dim(), curr->get_space_dim());
-            double rad = 0;
-            for (int j = 0; j < nb_pt; j++) {
-                std::vector<double> u(3, 0);
-                for (int p = 0; p < curr->get_space_dim(); p++) {
-                    u[p] = x[curr->get_space_dim() * num[j] + p] - xc[p];
+        // Radius and covariance matrix
+        std::vector<double> covs_rads = reduce_by_chunks(nb_pt, std::vector<double>(space_dim * space_dim + 1, 0), [&](int begin, int end, double *partial) {
+            double &rad = partial[space_dim * space_dim];
+            for (int j = begin; j < end; j++) {
+                double u[3] = {0, 0, 0};
+                for (int p = 0; p < space_dim; p++) {
+                    u[p] = x[space_dim * num[j] + p] - xc[p];
                 }
 
-                rad = std::max(rad, norm2(u) + r[num[j]]);
-                for (int p = 0; p < curr->get_space_dim(); p++) {
-                    for (int q = 0; q < curr->get_space_dim(); q++) {
-                        cov(p, q) += g[num[j]] * u[p] * u[q];
+                rad = std::max(rad, std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]) + r[num[j]]);
+                for (int p = 0; p < space_dim; p++) {
+                    for (int q = 0; q < space_dim; q++) {
+                        partial[p + space_dim * q] += g[num[j]] * u[p] * u[q];
                     }
                 }
             }
-            curr->set_rad(rad);
-
-            // Direction of largest extent
-            std::vector<double> dir;
-            if (curr->get_space_dim() == 2) {
-                dir = solve_EVP_2(cov);
-            } else if (curr->get_space_dim() == 3) {
-                dir = solve_EVP_3(cov);
-            } else {
-                throw std::logic_error("[Htool error] clustering not define for spatial dimension !=2 and !=3"); // LCOV_EXCL_LINE
+        });
+        Matrix<double> cov(space_dim, space_dim);
+        double rad = 0;
+        for (int c = 0; c < covs_rads.size(); c += space_dim * space_dim + 1) {
+            for (int p = 0; p < space_dim; p++) {
+                for (int q = 0; q < space_dim; q++) {
+                    cov(p, q) += covs_rads[c + p + space_dim * q];
+                }
             }
+            rad = std::max(rad, covs_rads[c + space_dim * space_dim]);
+        }
+        curr->set_rad(rad);
 
-            // Creating sons
-            for (int p = 0; p < curr_nb_sons; p++) {
-                curr->add_son(curr->get_counter() * curr_nb_sons + p, curr->get_depth() + 1, curr->get_perm_ptr());
-            }
+        // Direction of largest extent
+        std::vector<double> dir = (space_dim == 2) ? solve_EVP_2(cov) : solve_EVP_3(cov);
 
-            // Compute numbering
-            std::vector<std::vector<int>> numbering = splitting(x, num, curr, curr_nb_sons, dir);
+        // Creating sons
+        for (int p = 0; p < curr_nb_sons; p++) {
+            curr->add_son(curr->get_counter() * curr_nb_sons + p, curr->get_depth() + 1, curr->get_perm_ptr());
+        }
 
-            // Set offsets, size and rank of sons
-            int count = 0;
+        // Compute numbering
+        std::vector<std::vector<int>> numbering = splitting(x, num, curr, curr_nb_sons, dir);
 
-            for (int p = 0; p < curr_nb_sons; p++) {
-                curr->get_son_ptr(p)->set_offset(curr->get_offset() + count);
-                curr->get_son_ptr(p)->set_size(numbering[p].size());
-                count += numbering[p].size();
-
-                // level of parallelization
-                if (curr->get_depth() == 0) {
-                    curr->get_son_ptr(p)->set_rank(curr->get_son_ptr(p)->get_counter());
-                    if (rankWorld == curr->get_son_ptr(p)->get_counter()) {
-                        curr->set_local_cluster(curr->get_son_ptr(p));
-                    }
-                    curr->set_MasterOffset(curr->get_son_ptr(p)->get_counter(), std::pair<int, int>(curr->get_son_ptr(p)->get_offset(), curr->get_son_ptr(p)->get_size()));
-                }
-                // after level of parallelization
-                else {
-                    curr->get_son_ptr(p)->set_rank(curr->get_rank());
+        // Set offsets, size and rank of sons
+        int count = 0;
+
+        for (int p = 0; p < curr_nb_sons; p++) {
+            curr->get_son_ptr(p)->set_offset(curr->get_offset() + count);
+            curr->get_son_ptr(p)->set_size(numbering[p].size());
+            count += numbering[p].size();
+
+            // level of parallelization
+            if (curr->get_depth() == 0) {
+                curr->get_son_ptr(p)->set_rank(curr->get_son_ptr(p)->get_counter());
+                if (rankWorld == curr->get_son_ptr(p)->get_counter()) {
+                    curr->set_local_cluster(curr->get_son_ptr(p));
                 }
+                curr->set_MasterOffset(curr->get_son_ptr(p)->get_counter(), std::pair<int, int>(curr->get_son_ptr(p)->get_offset(), curr->get_son_ptr(p)->get_size()));
+            }
+            // after level of parallelization
+            else {
+                curr->get_son_ptr(p)->set_rank(curr->get_rank());
             }
+        }
 
-            // Recursivite
-            bool test_minclustersize = true;
+        // Recursivite
+        bool test_minclustersize = true;
+        for (int p = 0; p < curr_nb_sons; p++) {
+            test_minclustersize = test_minclustersize && (numbering[p].size() >= curr->get_minclustersize());
+        }
+        if (test_minclustersize || curr->get_rank() == -1) {
             for (int p = 0; p < curr_nb_sons; p++) {
-                test_minclustersize = test_minclustersize && (numbering[p].size() >= curr->get_minclustersize());
+                Cluster<PCA> *son         = curr->get_son_ptr(p);
+                std::vector<int> *son_num = &(numbering[p]);
+#if _OPENMP
+#    pragma omp task if (son_num->size() >= cluster_task_size)
+#endif
+                build_node(x, r, g, nb_sons, rankWorld, sizeWorld, son, *son_num);
             }
-            if (test_minclustersize || curr->get_rank() == -1) {
-                for (int p = 0; p < curr_nb_sons; p++) {
-                    s.push((curr->get_son_ptr(p)));
-                    n.push(numbering[p]);
-                }
-            } else {
+#if _OPENMP
+#    pragma omp taskwait
+#endif
+        } else {
+#if _OPENMP
+#    pragma omp critical(htool_cluster_depth)
+#endif
+            {
                 curr->set_max_depth(std::max(curr->get_max_depth(), curr->get_depth()));
                 if (curr->get_min_depth() < 0) {
                     curr->set_min_depth(curr->get_depth());
                 } else {
                     curr->set_min_depth(std::min(curr->get_min_depth(), curr->get_depth()));
                 }
+            }
+
+            curr->clear_sons();
+            std::copy_n(num.begin(), num.size(), curr->get_perm_start() + curr->get_offset());
+        }
+    }
+
+    // Center, radius and direction of largest extent of the root of a build distributed among the processes of comm, with the
+    // nb_pt points of this process
+    std::vector<double> build_distributed_root(const double *const x, const double *const r, const double *const g, int nb_pt, Cluster<PCA> *root, MPI_Comm comm) {
+        int space_dim = root->get_space_dim();
+        if (space_dim != 2 && space_dim != 3) {
+            throw std::logic_error("[Htool error] clustering not define for spatial dimension !=2 and !=3"); // LCOV_EXCL_LINE
+        }
+
+        // Mass and center of the cluster
+        std::vector<double> mass_ctr(1 + space_dim, 0);
+        for (int j = 0; j < nb_pt; j++) {
+            mass_ctr[0] += g[j];
+            for (int p = 0; p < space_dim; p++) {
+                mass_ctr[1 + p] += g[j] * x[space_dim * j + p];
+            }
+        }
+        MPI_Allreduce(MPI_IN_PLACE, mass_ctr.data(), 1 + space_dim, MPI_DOUBLE, MPI_SUM, comm);
+        std::vector<double> xc(mass_ctr.begin() + 1, mass_ctr.end());
+        std::transform(xc.begin(), xc.end(), xc.begin(), std::bind(std::multiplies<double>(), std::placeholders::_1, 1. / mass_ctr[0]));
+
+        root->set_ctr(xc);
+
+        // Radius and covariance matrix
+        Matrix<double> cov(space_dim, space_dim);
+        double rad = 0;
+        for (int j = 0; j < nb_pt; j++) {
+            double u[3] = {0, 0, 0};
+            for (int p = 0; p < space_dim; p++) {
+                u[p] = x[space_dim * j + p] - xc[p];
+            }
 
-                curr->clear_sons();
-                std::copy_n(num.begin(), num.size(), curr->get_perm_start() + curr->get_offset());
+            rad = std::max(rad, std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]) + r[j]);
+            for (int p = 0; p < space_dim; p++) {
+                for (int q = 0; q < space_dim; q++) {
+                    cov(p, q) += g[j] * u[p] * u[q];
+                }
             }
         }
+        MPI_Allreduce(MPI_IN_PLACE, cov.data(), space_dim * space_dim, MPI_DOUBLE, MPI_SUM, comm);
+        MPI_Allreduce(MPI_IN_PLACE, &rad, 1, MPI_DOUBLE, MPI_MAX, comm);
+        root->set_rad(rad);
+
+        // Direction of largest extent
+        return (space_dim == 2) ? solve_EVP_2(cov) : solve_EVP_3(cov);
     }
 
     std::vector<std::vector<int>> splitting(const double *const x, std::vector<int> &num, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir);
+    std::vector<int> distributed_splitting(const double *const x, int nb_pt, int global_offset, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir, MPI_Comm comm);
 };
 
 // Specialization of splitting
@@ -137,6 +230,12 @@ inline std::vector<std::vector<int>> PCA<SplittingTypes::GeometricSplitting>::sp
 template <>
 inline std::vector<std::vector<int>> PCA<SplittingTypes::RegularSplitting>::splitting(const double *const x, std::vector<int> &num, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir) { return regular_splitting(x, num, curr_cluster, nb_sons, dir); }
 
+template <>
+inline std::vector<int> PCA<SplittingTypes::GeometricSplitting>::distributed_splitting(const double *const x, int nb_pt, int global_offset, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir, MPI_Comm comm) { return distributed_geometric_splitting(x, nb_pt, global_offset, curr_cluster, nb_sons, dir, comm); }
+
+template <>
+inline std::vector<int> PCA<SplittingTypes::RegularSplitting>::distributed_splitting(const double *const x, int nb_pt, int global_offset, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir, MPI_Comm comm) { return distributed_regular_splitting(x, nb_pt, global_offset, curr_cluster, nb_sons, dir, comm); }
+
 // Typdef with specific splitting
 typedef PCA<SplittingTypes::GeometricSplitting> PCAGeometricClustering;
 typedef PCA<SplittingTypes::RegularSplitting> PCARegularClustering;
@@ -0,0 +1,368 @@
+#ifndef HTOOL_CLUSTERING_SPACE_FILLING_CURVE_HPP
+#define HTOOL_CLUSTERING_SPACE_FILLING_CURVE_HPP
+
+#include "cluster.hpp"
+#include <cstdint>
+#include <limits>
+#include <stack>
+
+namespace htool {
+
+enum class CurveTypes { MortonCurve,
+                        HilbertCurve };
+
+// Index on the Morton curve of the cell of integer coordinates X[0], ..., X[space_dim-1] with nb_bits bits each, the bits
+// of the coordinates are interleaved from the most significant one, X[0] first
+inline std::uint64_t morton_key(const std::uint32_t *const X, int space_dim, int nb_bits) {
+    std::uint64_t key = 0;
+    for (int b = nb_bits - 1; b >= 0; b--) {
+        for (int p = 0; p < space_dim; p++) {
+            key = (key << 1) | ((X[p] >> b) & 1);
+        }
+    }
+    return key;
+}
+
+// Index on the Hilbert curve, X is transformed in place into the transposed Hilbert index whose bits are then
+// interleaved as for the Morton curve (J. Skilling, Programming the Hilbert curve, AIP Conference Proceedings 707, 2004)
+inline std::uint64_t hilbert_key(std::uint32_t *const X, int space_dim, int nb_bits) {
+    std::uint32_t M = std::uint32_t(1) << (nb_bits - 1);
+
+    // Inverse undo
+    for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+        std::uint32_t P = Q - 1;
+        for (int p = 0; p < space_dim; p++) {
+            if (X[p] & Q) {
+                X[0] ^= P;
+            } else {
+                std::uint32_t t = (X[0] ^ X[p]) & P;
+                X[0] ^= t;
+                X[p] ^= t;
+            }
+        }
+    }
+
+    // Gray encode
+    for (int p = 1; p < space_dim; p++) {
+        X[p] ^= X[p - 1];
+    }
+    std::uint32_t t = 0;
+    for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+        if (X[space_dim - 1] & Q) {
+            t ^= Q - 1;
+        }
+    }
+    for (int p = 0; p < space_dim; p++) {
+        X[p] ^= t;
+    }
+
+    return morton_key(X, space_dim, nb_bits);
+}
+
+// Stable sort of indices by keys, least significant digit first with digits of 8 bits. Digits shared by all the keys are
+// skipped. Histograms and scatters are computed by chunks of cluster_chunk_size, by OpenMP tasks when there are several
+// of them, and the result does not depend on the number of threads
+inline void radix_sort(std::vector<std::uint64_t> &keys, std::vector<int> &indices) {
+    const int nb_digits = 256;
+    int nb_pt           = keys.size();
+    int nb_chunks       = std::max((nb_pt + cluster_chunk_size - 1) / cluster_chunk_size, 1);
+    std::vector<std::uint64_t> sorted_keys(nb_pt);
+    std::vector<int> sorted_indices(nb_pt);
+    std::vector<int> counts(std::size_t(nb_chunks) * nb_digits);
+
+    for (int shift = 0; shift < 64 && nb_pt > 0; shift += 8) {
+        // Histogram of each chunk
+        std::fill(counts.begin(), counts.end(), 0);
+        for (int c = 0; c < nb_chunks; c++) {
+#if _OPENMP
+#    pragma omp task shared(keys, counts) if (nb_chunks > 1)
+#endif
+            for (int j = c * cluster_chunk_size; j < std::min(nb_pt, (c + 1) * cluster_chunk_size); j++) {
+                counts[std::size_t(c) * nb_digits + ((keys[j] >> shift) & (nb_digits - 1))] += 1;
+            }
+        }
+#if _OPENMP
+#    pragma omp taskwait
+#endif
+
+        int first_digit = (keys[0] >> shift) & (nb_digits - 1);
+        int count       = 0;
+        for (int c = 0; c < nb_chunks; c++) {
+            count += counts[std::size_t(c) * nb_digits + first_digit];
+        }
+        if (count == nb_pt) {
+            continue;
+        }
+
+        // Position of the first key of each digit and chunk
+        int position = 0;
+        for (int d = 0; d < nb_digits; d++) {
+            for (int c = 0; c < nb_chunks; c++) {
+                int chunk_count                        = counts[std::size_t(c) * nb_digits + d];
+                counts[std::size_t(c) * nb_digits + d] = position;
+                position += chunk_count;
+            }
+        }
+
+        // Scatter of each chunk
+        for (int c = 0; c < nb_chunks; c++) {
+#if _OPENMP
+#    pragma omp task shared(keys, indices, sorted_keys, sorted_indices, counts) if (nb_chunks > 1)
+#endif
+            for (int j = c * cluster_chunk_size; j < std::min(nb_pt, (c + 1) * cluster_chunk_size); j++) {
+                int &next            = counts[std::size_t(c) * nb_digits + ((keys[j] >> shift) & (nb_digits - 1))];
+                sorted_keys[next]    = keys[j];
+                sorted_indices[next] = indices[j];
+                next += 1;
+            }
+        }
+#if _OPENMP
+#    pragma omp taskwait
+#endif
+        std::swap(keys, sorted_keys);
+        std::swap(indices, sorted_indices);
+    }
+}
+
+// Clusters of points ordered along a space-filling curve: the points of each cluster given to recursive_build are sorted
+// by the index on the curve of their cell in a regular grid of their bounding box, and the tree is built by recursive
+// bisection of the sorted keys, so that its construction only needs one sort
+template <CurveTypes CurveType>
+class SpaceFillingCurve {
+  public:
+    void
+    recursive_build(const double *const x, const double *const r, const double *const g, int nb_sons, MPI_Comm comm, std::stack<Cluster<SpaceFillingCurve> *> &s, std::stack<std::vector<int>> &n) {
+
+        // MPI parameters
+        int rankWorld, sizeWorld;
+        MPI_Comm_size(comm, &sizeWorld);
+        MPI_Comm_rank(comm, &rankWorld);
+
+        if (!s.empty() && s.top()->get_space_dim() != 2 && s.top()->get_space_dim() != 3) {
+            throw std::logic_error("[Htool error] clustering not define for spatial dimension !=2 and !=3"); // LCOV_EXCL_LINE
+        }
+
+        std::vector<Cluster<SpaceFillingCurve> *> clusters;
+        std::vector<std::vector<int>> nums;
+        while (!s.empty()) {
+            clusters.push_back(s.top());
+            nums.push_back(std::move(n.top()));
+            s.pop();
+            n.pop();
+        }
+
+        // Independent subtrees are built by OpenMP tasks, the tree does not depend on the number of threads
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp parallel
+#    pragma omp single
+#endif
+        for (int i = 0; i < clusters.size(); i++) {
+            Cluster<SpaceFillingCurve> *curr = clusters[i];
+            std::vector<int> *num            = &(nums[i]);
+#if _OPENMP
+#    pragma omp task if (num->size() >= cluster_task_size)
+#endif
+            {
+                std::vector<std::uint64_t> keys = sort_along_curve(x, *num, curr->get_space_dim());
+                std::copy_n(num->begin(), num->size(), curr->get_perm_start() + curr->get_offset());
+                build_node(x, r, g, nb_sons, rankWorld, sizeWorld, curr, keys.data());
+            }
+        }
+    }
+
+    // Sorts num by the index on the curve of the cells of the points, and returns the sorted keys
+    std::vector<std::uint64_t> sort_along_curve(const double *const x, std::vector<int> &num, int space_dim) {
+        int nb_pt   = num.size();
+        int nb_bits = 64 / space_dim;
+
+        // Bounding box
+        std::vector<double> init(2 * space_dim, std::numeric_limits<double>::max());
+        std::vector<double> bounds = reduce_by_chunks(nb_pt, init, [&](int begin, int end, double *partial) {
+            for (int j = begin; j < end; j++) {
+                for (int p = 0; p < space_dim; p++) {
+                    partial[p]             = std::min(partial[p], x[space_dim * num[j] + p]);
+                    partial[space_dim + p] = std::min(partial[space_dim + p], -x[space_dim * num[j] + p]);
+                }
+            }
+        });
+        std::vector<double> min_point(space_dim, std::numeric_limits<double>::max());
+        double extent = 0;
+        for (int p = 0; p < space_dim; p++) {
+            double max_point = -std::numeric_limits<double>::max();
+            for (int c = 0; c < bounds.size(); c += 2 * space_dim) {
+                min_point[p] = std::min(min_point[p], bounds[c + p]);
+                max_point    = std::max(max_point, -bounds[c + space_dim + p]);
+            }
+            extent = std::max(extent, max_point - min_point[p]);
+        }
+
+        // Cells of the regular grid of the bounding box, with the same step along every axis
+        double max_cell = double((std::uint64_t(1) << nb_bits) - 1);
+        double scale    = extent > 0 ? max_cell / extent : 0;
+        std::vector<std::uint64_t> keys(nb_pt);
+        int nb_chunks = std::max((nb_pt + cluster_chunk_size - 1) / cluster_chunk_size, 1);
+        for (int c = 0; c < nb_chunks; c++) {
+#if _OPENMP
+#    pragma omp task shared(keys, num, min_point) if (nb_chunks > 1)
+#endif
+            for (int j = c * cluster_chunk_size; j < std::min(nb_pt, (c + 1) * cluster_chunk_size); j++) {
+                std::uint32_t X[3];
+                for (int p = 0; p < space_dim; p++) {
+                    X[p] = std::uint32_t(std::min(max_cell, (x[space_dim * num[j] + p] - min_point[p]) * scale));
+                }
+                keys[j] = key(X, space_dim, nb_bits);
+            }
+        }
+#if _OPENMP
+#    pragma omp taskwait
+#endif
+
+        radix_sort(keys, num);
+        return keys;
+    }
+
+    // Offsets of nb_sons consecutive parts of the nb_pt sorted keys and nb_pt. The part with the most points is bisected at
+    // the highest bit where its keys differ, that is along the boundary of the largest cell of the curve it crosses, until
+    // there are nb_sons parts. Parts whose keys are all equal are bisected at their middle
+    std::vector<int> bisection(const std::uint64_t *const keys, int nb_pt, int nb_sons) {
+        std::vector<int> offsets{0, nb_pt};
+        while (offsets.size() < nb_sons + 1) {
+            int q = 0;
+            for (int p = 1; p < offsets.size() - 1; p++) {
+                if (offsets[p + 1] - offsets[p] > offsets[q + 1] - offsets[q]) {
+                    q = p;
+                }
+            }
+
+            int begin  = offsets[q];
+            int end    = offsets[q + 1];
+            int middle = begin + (end - begin) / 2;
+            if (end - begin >= 2 && keys[begin] != keys[end - 1]) {
+                std::uint64_t bit = keys[begin] ^ keys[end - 1];
+                while (bit & (bit - 1)) {
+                    bit &= bit - 1;
+                }
+                middle = std::partition_point(keys + begin, keys + end, [&](std::uint64_t key) { return !(key & bit); }) - keys;
+            }
+            offsets.insert(offsets.begin() + q + 1, middle);
+        }
+        return offsets;
+    }
+
+    // Node curr with the points of its part of the permutation and their sorted keys, and its subtree
+    void build_node(const double *const x, const double *const r, const double *const g, int nb_sons, int rankWorld, int sizeWorld, Cluster<SpaceFillingCurve> *curr, const std::uint64_t *const keys) {
+        int curr_nb_sons = curr->get_depth() == 0 ? sizeWorld : nb_sons;
+        int space_dim    = curr->get_space_dim();
+
+        // Mass and center of the cluster
+        int nb_pt                            = curr->get_size();
+        std::vector<int>::const_iterator num = curr->get_perm_start() + curr->get_offset();
+        std::vector<double> mass_ctrs        = reduce_by_chunks(nb_pt, std::vector<double>(1 + space_dim, 0), [&](int begin, int end, double *partial) {
+            for (int j = begin; j < end; j++) {
+                partial[0] += g[num[j]];
+                for (int p = 0; p < space_dim; p++) {
+                    partial[1 + p] += g[num[j]] * x[space_dim * num[j] + p];
+                }
+            }
+        });
+        double G = 0;
+        std::vector<double> xc(space_dim, 0);
+        for (int c = 0; c < mass_ctrs.size(); c += 1 + space_dim) {
+            G += mass_ctrs[c];
+            for (int p = 0; p < space_dim; p++) {
+                xc[p] += mass_ctrs[c + 1 + p];
+            }
+        }
+        std::transform(xc.begin(), xc.end(), xc.begin(), std::bind(std::multiplies<double>(), std::placeholders::_1, 1. / G));
+
+        curr->set_ctr(xc);
+
+        // Radius
+        std::vector<double> rads = reduce_by_chunks(nb_pt, std::vector<double>(1, 0), [&](int begin, int end, double *partial) {
+            for (int j = begin; j < end; j++) {
+                double u[3] = {0, 0, 0};
+                for (int p = 0; p < space_dim; p++) {
+                    u[p] = x[space_dim * num[j] + p] - xc[p];
+                }
+                partial[0] = std::max(partial[0], std::sqrt(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]) + r[num[j]]);
+            }
+        });
+        curr->set_rad(*std::max_element(rads.begin(), rads.end()));
+
+        // Creating sons with consecutive parts of the sorted points, of equal sizes at the level of parallelization
+        std::vector<int> son_offsets(curr_nb_sons + 1);
+        if (curr->get_depth() == 0) {
+            for (int p = 0; p < curr_nb_sons + 1; p++) {
+                son_offsets[p] = (std::size_t(nb_pt) * p) / curr_nb_sons;
+            }
+        } else {
+            son_offsets = bisection(keys, nb_pt, curr_nb_sons);
+        }
+        bool test_minclustersize = true;
+        for (int p = 0; p < curr_nb_sons; p++) {
+            curr->add_son(curr->get_counter() * curr_nb_sons + p, curr->get_depth() + 1, curr->get_perm_ptr());
+            curr->get_son_ptr(p)->set_offset(curr->get_offset() + son_offsets[p]);
+            curr->get_son_ptr(p)->set_size(son_offsets[p + 1] - son_offsets[p]);
+            test_minclustersize = test_minclustersize && (son_offsets[p + 1] - son_offsets[p] >= curr->get_minclustersize());
+
+            // level of parallelization
+            if (curr->get_depth() == 0) {
+                curr->get_son_ptr(p)->set_rank(curr->get_son_ptr(p)->get_counter());
+                if (rankWorld == curr->get_son_ptr(p)->get_counter()) {
+                    curr->set_local_cluster(curr->get_son_ptr(p));
+                }
+                curr->set_MasterOffset(curr->get_son_ptr(p)->get_counter(), std::pair<int, int>(curr->get_son_ptr(p)->get_offset(), curr->get_son_ptr(p)->get_size()));
+            }
+            // after level of parallelization
+            else {
+                curr->get_son_ptr(p)->set_rank(curr->get_rank());
+            }
+        }
+
+        // Recursivite
+        if (test_minclustersize || curr->get_rank() == -1) {
+            for (int p = 0; p < curr_nb_sons; p++) {
+                Cluster<SpaceFillingCurve> *son = curr->get_son_ptr(p);
+                const std::uint64_t *son_keys   = keys + son_offsets[p];
+#if _OPENMP
+#    pragma omp task if (son->get_size() >= cluster_task_size)
+#endif
+                build_node(x, r, g, nb_sons, rankWorld, sizeWorld, son, son_keys);
+            }
+#if _OPENMP
+#    pragma omp taskwait
+#endif
+        } else {
+#if _OPENMP
+#    pragma omp critical(htool_cluster_depth)
+#endif
+            {
+                curr->set_max_depth(std::max(curr->get_max_depth(), curr->get_depth()));
+                if (curr->get_min_depth() < 0) {
+                    curr->set_min_depth(curr->get_depth());
+                } else {
+                    curr->set_min_depth(std::min(curr->get_min_depth(), curr->get_depth()));
+                }
+            }
+
+            curr->clear_sons();
+        }
+    }
+
+    std::uint64_t key(std::uint32_t *const X, int space_dim, int nb_bits);
+};
+
+// Specialization of key
+template <>
+inline std::uint64_t SpaceFillingCurve<CurveTypes::MortonCurve>::key(std::uint32_t *const X, int space_dim, int nb_bits) { return morton_key(X, space_dim, nb_bits); }
+
+template <>
+inline std::uint64_t SpaceFillingCurve<CurveTypes::HilbertCurve>::key(std::uint32_t *const X, int space_dim, int nb_bits) { return hilbert_key(X, space_dim, nb_bits); }
+
+// Typdef with specific curve
+typedef SpaceFillingCurve<CurveTypes::MortonCurve> MortonClustering;
+typedef SpaceFillingCurve<CurveTypes::HilbertCurve> HilbertClustering;
+
+} // namespace htool
+
+#endif
@@ -2,61 +2,81 @@
 #define HTOOL_CLUSTERING_SPLITTING_HPP
 
 #include "virtual_cluster.hpp"
+#include <limits>
 
 namespace htool {
 
 enum class SplittingTypes { GeometricSplitting,
                             RegularSplitting };
 
+// Projections of the points num along dir, computed once per node instead of in every comparison
+inline std::vector<std::pair<double, int>> projection_keys(const double *const x, const std::vector<int> &num, int space_dim, const std::vector<double> &dir) {
+    std::vector<std::pair<double, int>> keys(num.size());
+    for (int j = 0; j < num.size(); j++) {
+        keys[j] = std::pair<double, int>(std::inner_product(x + space_dim * num[j], x + space_dim * (1 + num[j]), dir.data(), double(0)), num[j]);
+    }
+    return keys;
+}
+
 inline std::vector<std::vector<int>> regular_splitting(const double *const x, std::vector<int> &num, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir) {
 
     std::vector<std::vector<int>> numbering(nb_sons);
-    std::vector<double> xc = curr_cluster->get_ctr();
-    int space_dim          = curr_cluster->get_space_dim();
+    int space_dim      = curr_cluster->get_space_dim();
+    int nb_pt          = num.size();
+    int size_numbering = nb_pt / nb_sons;
 
-    // Sort along direction
-    std::sort(num.begin(), num.end(), [&](int a, int b) {
-        double c = std::inner_product(x + space_dim * a, x + space_dim * (1 + a), dir.data(), double(0));
-        double d = std::inner_product(x + space_dim * b, x + space_dim * (1 + b), dir.data(), double(0));
-        return c < d;
-    });
+    // Partition along direction at the boundaries of the sons for dir and -dir, sons only depend on these partitions
+    std::vector<std::pair<double, int>> keys = projection_keys(x, num, space_dim, dir);
+    std::vector<int> bounds;
+    for (int p = 1; p < nb_sons; p++) {
+        bounds.push_back(p * size_numbering);
+        bounds.push_back(nb_pt - p * size_numbering);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    auto first = keys.begin();
+    for (int bound : bounds) {
+        if (0 < bound && bound < nb_pt && first < keys.begin() + bound) {
+            std::nth_element(first, keys.begin() + bound, keys.end(), [](const std::pair<double, int> &a, const std::pair<double, int> &b) { return a.first < b.first; });
+            first = keys.begin() + bound;
+        }
+    }
 
     // Choose a way dir (1) or -dir (2)
-    int dist1          = 0; // number of non local permutation
-    int dist2          = 0; // number of non local permutation
-    int size_numbering = num.size() / nb_sons;
-    int count_size     = 0;
-    auto rnum_ptr      = num.rbegin();
+    int dist1      = 0; // number of non local permutation
+    int dist2      = 0; // number of non local permutation
+    int count_size = 0;
+    auto rkeys_ptr = keys.rbegin();
 
     for (int p = 0; p < nb_sons - 1; p++) {
         for (int i = count_size; i < count_size + size_numbering; i++) {
-            dist1 += !((count_size <= num[i]) && (num[i] < count_size + size_numbering));
+            dist1 += !((count_size <= keys[i].second) && (keys[i].second < count_size + size_numbering));
         }
         for (int i = count_size; i < count_size + size_numbering; i++) {
-            dist2 += !((count_size <= rnum_ptr[i]) && (rnum_ptr[i] < count_size + size_numbering));
+            dist2 += !((count_size <= rkeys_ptr[i].second) && (rkeys_ptr[i].second < count_size + size_numbering));
         }
         count_size += size_numbering;
     }
-    for (int i = count_size; i < num.size(); i++) {
-        dist1 += !((count_size <= num[i]) && (num[i] < num.size()));
+    for (int i = count_size; i < nb_pt; i++) {
+        dist1 += !((count_size <= keys[i].second) && (keys[i].second < nb_pt));
     }
-    for (int i = count_size; i < num.size(); i++) {
-        dist2 += !((count_size <= rnum_ptr[i]) && (rnum_ptr[i] < num.size()));
+    for (int i = count_size; i < nb_pt; i++) {
+        dist2 += !((count_size <= rkeys_ptr[i].second) && (rkeys_ptr[i].second < nb_pt));
     }
     if (dist2 < dist1)
-        std::reverse(num.begin(), num.end());
+        std::reverse(keys.begin(), keys.end());
 
-    // Split
+    // Split, num is reordered as the concatenation of the sons
     count_size = 0;
-    for (int p = 0; p < nb_sons - 1; p++) {
-        numbering[p].resize(size_numbering);
-        std::copy_n(num.begin() + count_size, size_numbering, numbering[p].begin());
-        count_size += size_numbering;
+    for (int p = 0; p < nb_sons; p++) {
+        int size = (p == nb_sons - 1) ? nb_pt - count_size : size_numbering;
+        numbering[p].resize(size);
+        for (int i = 0; i < size; i++) {
+            numbering[p][i]     = keys[count_size + i].second;
+            num[count_size + i] = keys[count_size + i].second;
+        }
+        count_size += size;
     }
 
-    numbering.back().resize(num.size() - count_size);
-    std::copy(num.begin() + count_size, num.end(), numbering.back().begin());
-
     return numbering;
 }
 
@@ -64,59 +84,216 @@ inline std::vector<std::vector<int>> geometric_splitting(const double *const x,
     std::vector<std::vector<int>> numbering(nb_sons);
 
     // Geometry of current cluster
-    int nb_pt              = curr_cluster->get_size();
-    int space_dim          = curr_cluster->get_space_dim();
-    std::vector<double> xc = curr_cluster->get_ctr();
+    int nb_pt        = curr_cluster->get_size();
+    int space_dim    = curr_cluster->get_space_dim();
+    const double *xc = curr_cluster->get_ctr_data();
+
+    // Son of each point, sons are filled in the order of num after counting their sizes
+    std::vector<int> sons(nb_pt, 0);
+    std::vector<int> sizes(nb_sons, 0);
 
     // For 2 sons, we can use the center of the cluster
     if (nb_sons == 2) {
         for (int j = 0; j < nb_pt; j++) {
-            std::vector<double> dx(x + space_dim * num[j], x + space_dim * (1 + num[j]));
-            for (int p = 0; p < dx.size(); p++) {
-                dx[p] = dx[p] - xc[p];
-            }
-
-            if (dprod(dir, dx) > 0) {
-                numbering[0].push_back(num[j]);
-            } else {
-                numbering[1].push_back(num[j]);
+            double key = 0;
+            for (int p = 0; p < space_dim; p++) {
+                key += dir[p] * (x[space_dim * num[j] + p] - xc[p]);
             }
+            sons[j] = (key > 0) ? 0 : 1;
+            sizes[sons[j]]++;
         }
 
     }
     // Otherwise we have to something more
     else if (num.size() > 1) {
-        const auto minmax = std::minmax_element(num.begin(), num.end(), [&](int a, int b) {
-            double c = std::inner_product(x + space_dim * a, x + space_dim * (1 + a), dir.data(), double(0));
-            double d = std::inner_product(x + space_dim * b, x + space_dim * (1 + b), dir.data(), double(0));
-            return c < d;
-        });
-        std::vector<double> min(x + space_dim * *(minmax.first), x + space_dim * (1 + *(minmax.first)));
-        std::vector<double> max(x + space_dim * *(minmax.second), x + space_dim * (1 + *(minmax.second)));
+        std::vector<std::pair<double, int>> keys = projection_keys(x, num, space_dim, dir);
+        const auto minmax                        = std::minmax_element(keys.begin(), keys.end(), [](const std::pair<double, int> &a, const std::pair<double, int> &b) { return a.first < b.first; });
+        std::vector<double> min(x + space_dim * minmax.first->second, x + space_dim * (1 + minmax.first->second));
+        std::vector<double> max(x + space_dim * minmax.second->second, x + space_dim * (1 + minmax.second->second));
 
         double length = dprod(max - min, dir) / (double)nb_sons;
         for (int j = 0; j < nb_pt; j++) {
-            std::vector<double> dx(x + space_dim * num[j], x + space_dim * (1 + num[j]));
+            double key = 0;
+            for (int p = 0; p < space_dim; p++) {
+                key += (x[space_dim * num[j] + p] - min[p]) * dir[p];
+            }
+
+            int index = key / length;
+            sons[j]   = (index == nb_sons) ? index - 1 : index; // for max
+            sizes[sons[j]]++;
+        }
+
+        // Check that no son is empty, in this case, we do a regular splitting
+        if (std::find(sizes.begin(), sizes.end(), 0) != sizes.end()) {
+            return regular_splitting(x, num, curr_cluster, nb_sons, dir);
+        }
+    } else {
+        return numbering;
+    }
+
+    for (int p = 0; p < nb_sons; p++) {
+        numbering[p].reserve(sizes[p]);
+    }
+    for (int j = 0; j < nb_pt; j++) {
+        numbering[sons[j]].push_back(num[j]);
+    }
+
+    return numbering;
+}
+
+// Sons of the nb_pt points of this process at the root of a build distributed among the processes of comm, numbered from
+// global_offset. Sons have the sizes of regular_splitting, the points of all the processes are sorted along dir by a sample sort
+inline std::vector<int> distributed_regular_splitting(const double *const x, int nb_pt, int global_offset, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir, MPI_Comm comm) {
+    int rankWorld, sizeWorld;
+    MPI_Comm_size(comm, &sizeWorld);
+    MPI_Comm_rank(comm, &rankWorld);
+    int space_dim      = curr_cluster->get_space_dim();
+    int global_nb_pt   = curr_cluster->get_size();
+    int size_numbering = global_nb_pt / nb_sons;
+    if (global_nb_pt == 0) {
+        return std::vector<int>();
+    }
+
+    // Projections sorted locally, ties are broken by global numbers
+    std::vector<std::pair<double, int>> keys(nb_pt);
+    for (int j = 0; j < nb_pt; j++) {
+        keys[j] = std::pair<double, int>(std::inner_product(x + space_dim * j, x + space_dim * (1 + j), dir.data(), double(0)), global_offset + j);
+    }
+    std::sort(keys.begin(), keys.end());
 
-            int index = dprod(dx - min, dir) / length;
-            index     = (index == nb_sons) ? index - 1 : index; // for max
-            numbering[index].push_back(num[j]);
+    // Splitters between processes chosen in samples of every process
+    int nb_samples = std::min(nb_pt, 16 * sizeWorld);
+    std::vector<double> sample_keys(nb_samples);
+    std::vector<int> sample_nums(nb_samples);
+    for (int i = 0; i < nb_samples; i++) {
+        sample_keys[i] = keys[(std::size_t(i) * nb_pt) / nb_samples].first;
+        sample_nums[i] = keys[(std::size_t(i) * nb_pt) / nb_samples].second;
+    }
+    std::vector<int> sample_counts(sizeWorld), sample_displs(sizeWorld, 0);
+    MPI_Allgather(&nb_samples, 1, MPI_INT, sample_counts.data(), 1, MPI_INT, comm);
+    std::partial_sum(sample_counts.begin(), sample_counts.end() - 1, sample_displs.begin() + 1);
+    int nb_all_samples = sample_displs.back() + sample_counts.back();
+    std::vector<double> all_sample_keys(nb_all_samples);
+    std::vector<int> all_sample_nums(nb_all_samples);
+    MPI_Allgatherv(sample_keys.data(), nb_samples, MPI_DOUBLE, all_sample_keys.data(), sample_counts.data(), sample_displs.data(), MPI_DOUBLE, comm);
+    MPI_Allgatherv(sample_nums.data(), nb_samples, MPI_INT, all_sample_nums.data(), sample_counts.data(), sample_displs.data(), MPI_INT, comm);
+    std::vector<std::pair<double, int>> samples(nb_all_samples);
+    for (int i = 0; i < nb_all_samples; i++) {
+        samples[i] = std::pair<double, int>(all_sample_keys[i], all_sample_nums[i]);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    // Points sent to the process of their bucket, buckets are contiguous in the sorted keys
+    std::vector<int> send_counts(sizeWorld), send_displs(sizeWorld, 0);
+    for (int q = 0; q < sizeWorld; q++) {
+        int end        = (q < sizeWorld - 1) ? std::lower_bound(keys.begin(), keys.end(), samples[(std::size_t(q + 1) * nb_all_samples) / sizeWorld]) - keys.begin() : nb_pt;
+        send_counts[q] = end - send_displs[q];
+        if (q < sizeWorld - 1) {
+            send_displs[q + 1] = end;
         }
+    }
+    std::vector<int> recv_counts(sizeWorld), recv_displs(sizeWorld, 0);
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+    std::partial_sum(recv_counts.begin(), recv_counts.end() - 1, recv_displs.begin() + 1);
+    int nb_recv = recv_displs.back() + recv_counts.back();
 
-        // Check that no son is empty
-        bool empty = false;
-        for (int p = 0; p < numbering.size(); p++) {
-            if (numbering[p].size() == 0) {
-                empty = true;
+    std::vector<double> send_keys(nb_pt), recv_keys(nb_recv);
+    std::vector<int> send_nums(nb_pt), recv_nums(nb_recv);
+    for (int j = 0; j < nb_pt; j++) {
+        send_keys[j] = keys[j].first;
+        send_nums[j] = keys[j].second;
+    }
+    MPI_Alltoallv(send_keys.data(), send_counts.data(), send_displs.data(), MPI_DOUBLE, recv_keys.data(), recv_counts.data(), recv_displs.data(), MPI_DOUBLE, comm);
+    MPI_Alltoallv(send_nums.data(), send_counts.data(), send_displs.data(), MPI_INT, recv_nums.data(), recv_counts.data(), recv_displs.data(), MPI_INT, comm);
+
+    // Positions of the received points among the sorted points of all processes
+    std::vector<int> order(nb_recv);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return std::make_pair(recv_keys[a], recv_nums[a]) < std::make_pair(recv_keys[b], recv_nums[b]); });
+    int first_position = 0;
+    MPI_Exscan(&nb_recv, &first_position, 1, MPI_INT, MPI_SUM, comm);
+    if (rankWorld == 0) {
+        first_position = 0;
+    }
+    std::vector<int> positions(nb_recv);
+    for (int i = 0; i < nb_recv; i++) {
+        positions[order[i]] = first_position + i;
+    }
+
+    // Choose a way dir (1) or -dir (2) as regular_splitting
+    auto son_of = [&](int position) {
+        return (size_numbering == 0) ? nb_sons - 1 : std::min(position / size_numbering, nb_sons - 1);
+    };
+    auto is_local = [&](int son, int num) {
+        return (son * size_numbering <= num) && (num < ((son == nb_sons - 1) ? global_nb_pt : (son + 1) * size_numbering));
+    };
+    int dists[2] = {0, 0}; // numbers of non local permutation
+    for (int i = 0; i < nb_recv; i++) {
+        dists[0] += !is_local(son_of(positions[i]), recv_nums[i]);
+        dists[1] += !is_local(son_of(global_nb_pt - 1 - positions[i]), recv_nums[i]);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, dists, 2, MPI_INT, MPI_SUM, comm);
+
+    // Sons sent back to the processes of the points
+    std::vector<int> recv_sons(nb_recv), sorted_sons(nb_pt), sons(nb_pt);
+    for (int i = 0; i < nb_recv; i++) {
+        recv_sons[i] = son_of((dists[1] < dists[0]) ? global_nb_pt - 1 - positions[i] : positions[i]);
+    }
+    MPI_Alltoallv(recv_sons.data(), recv_counts.data(), recv_displs.data(), MPI_INT, sorted_sons.data(), send_counts.data(), send_displs.data(), MPI_INT, comm);
+    for (int j = 0; j < nb_pt; j++) {
+        sons[keys[j].second - global_offset] = sorted_sons[j];
+    }
+
+    return sons;
+}
+
+// Sons of the nb_pt points of this process at the root of a build distributed among the processes of comm, as
+// geometric_splitting up to rounding
+inline std::vector<int> distributed_geometric_splitting(const double *const x, int nb_pt, int global_offset, VirtualCluster const *const curr_cluster, int nb_sons, const std::vector<double> &dir, MPI_Comm comm) {
+    int space_dim    = curr_cluster->get_space_dim();
+    int global_nb_pt = curr_cluster->get_size();
+    const double *xc = curr_cluster->get_ctr_data();
+    std::vector<int> sons(nb_pt, 0);
+
+    // For 2 sons, we can use the center of the cluster
+    if (nb_sons == 2) {
+        for (int j = 0; j < nb_pt; j++) {
+            double key = 0;
+            for (int p = 0; p < space_dim; p++) {
+                key += dir[p] * (x[space_dim * j + p] - xc[p]);
             }
+            sons[j] = (key > 0) ? 0 : 1;
+        }
+    }
+    // Otherwise we have to something more
+    else if (global_nb_pt > 1) {
+        std::vector<double> keys(nb_pt);
+        double bounds[2] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max()}; // minima of the keys and of their opposites
+        for (int j = 0; j < nb_pt; j++) {
+            keys[j]   = std::inner_product(x + space_dim * j, x + space_dim * (1 + j), dir.data(), double(0));
+            bounds[0] = std::min(bounds[0], keys[j]);
+            bounds[1] = std::min(bounds[1], -keys[j]);
         }
-        // In this case, we do a regular splitting
-        if (empty) {
-            numbering = regular_splitting(x, num, curr_cluster, nb_sons, dir);
+        MPI_Allreduce(MPI_IN_PLACE, bounds, 2, MPI_DOUBLE, MPI_MIN, comm);
+
+        double length = (-bounds[1] - bounds[0]) / (double)nb_sons;
+        std::vector<int> sizes(nb_sons, 0);
+        for (int j = 0; j < nb_pt; j++) {
+            int index = (length > 0) ? (keys[j] - bounds[0]) / length : 0;
+            sons[j]   = std::min(index, nb_sons - 1); // for max
+            sizes[sons[j]]++;
         }
+        MPI_Allreduce(MPI_IN_PLACE, sizes.data(), nb_sons, MPI_INT, MPI_SUM, comm);
+
+        // Check that no son is empty, in this case, we do a regular splitting
+        if (std::find(sizes.begin(), sizes.end(), 0) != sizes.end()) {
+            return distributed_regular_splitting(x, nb_pt, global_offset, curr_cluster, nb_sons, dir, comm);
+        }
+    } else {
+        return distributed_regular_splitting(x, nb_pt, global_offset, curr_cluster, nb_sons, dir, comm);
     }
 
-    return numbering;
+    return sons;
 }
 
 } // namespace htool
@@ -27,7 +27,7 @@ class VirtualCluster {
 
     //// Getters for local data
     virtual double get_rad() const                            = 0;
-    virtual const std::vector<double> &get_ctr() const        = 0;
+    virtual const double *get_ctr_data() const                = 0;
     virtual const VirtualCluster &get_son(const int &j) const = 0;
     virtual VirtualCluster &get_son(const int &j)             = 0;
     virtual int get_depth() const                             = 0;
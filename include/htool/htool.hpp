@@ -5,21 +5,31 @@
 
 #include "clustering/bounding_box_1.hpp"
 #include "clustering/cluster.hpp"
+#include "clustering/flat_cluster.hpp"
 #include "clustering/pca.hpp"
+#include "clustering/space_filling_curve.hpp"
 
 #include "input_output/geometry.hpp"
 
 #include "lrmat/SVD.hpp"
+#include "lrmat/blockedACA.hpp"
 #include "lrmat/fullACA.hpp"
 #include "lrmat/lrmat.hpp"
 #include "lrmat/partialACA.hpp"
+#include "lrmat/randomizedSVD.hpp"
 #include "lrmat/sympartialACA.hpp"
 
+#include "misc/aligned_buffer.hpp"
+#include "misc/arena.hpp"
 #include "misc/misc.hpp"
+#include "misc/permute_transpose.hpp"
 #include "misc/user.hpp"
 
 #include "types/hmatrix.hpp"
+#include "types/kernel_cache.hpp"
 #include "types/matrix.hpp"
+#include "types/matvec_plan.hpp"
+#include "types/matvec_schedule.hpp"
 #include "types/point.hpp"
 #include "types/vector.hpp"
 #include "types/virtual_generator.hpp"
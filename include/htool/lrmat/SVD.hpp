@@ -3,45 +3,67 @@
 
 #include "../wrappers/wrapper_lapack.hpp"
 #include "lrmat.hpp"
+#include "partialACA.hpp"
+#include <memory>
 
 namespace htool {
 
+// Economy SVD computed by gesdd on the assembled block. Blocks whose
+// coefficients take more than max_bytes bytes are compressed by the fallback
+// compressor instead, so that the memory used stays bounded (no cap by default).
 template <typename T>
 class SVD final : public VirtualLowRankGenerator<T> {
+    std::size_t max_bytes;
+    std::shared_ptr<VirtualLowRankGenerator<T>> fallback;
 
   public:
-    using VirtualLowRankGenerator<T>::VirtualLowRankGenerator;
+    SVD() : max_bytes(0), fallback(nullptr) {}
+
+    SVD(std::size_t max_bytes0, std::shared_ptr<VirtualLowRankGenerator<T>> fallback0 = std::make_shared<partialACA<T>>()) : max_bytes(max_bytes0), fallback(fallback0) {
+        if (fallback == nullptr) {
+            throw std::invalid_argument("[Htool error] No fallback compressor given to SVD"); // LCOV_EXCL_LINE
+        }
+    }
+
+    std::size_t get_max_bytes() const { return max_bytes; }
+    std::shared_ptr<VirtualLowRankGenerator<T>> get_fallback() const { return fallback; }
+
+    void copy_low_rank_approximation(double epsilon, int M, int N, const int *const rows, const int *const cols, int &rank, T **U, T **V, const VirtualGenerator<T> &A, const VirtualCluster &t, const double *const xt, const VirtualCluster &s, const double *const xs) const {
+        if (max_bytes > 0 && std::size_t(M) * N * sizeof(T) > max_bytes) {
+            fallback->copy_low_rank_approximation(epsilon, M, N, rows, cols, rank, U, V, A, t, xt, s, xs);
+            return;
+        }
 
-    void copy_low_rank_approximation(double epsilon, int M, int N, const int *const rows, const int *const cols, int &rank, T **U, T **V, const VirtualGenerator<T> &A, const VirtualCluster &, const double *const, const VirtualCluster &, const double *const) const {
         int reqrank = 0;
         //// Matrix assembling
         double Norm = 0;
-        std::vector<T> mat(M * N);
+        std::vector<T> mat(std::size_t(M) * N);
         A.copy_submatrix(M, N, rows, cols, mat.data());
         for (int i = 0; i < mat.size(); i++) {
             Norm += std::abs(mat[i] * mat[i]);
         }
         Norm = sqrt(Norm);
 
-        //// SVD
+        //// SVD, only the first min(m,n) singular vectors are computed
         int m     = M;
         int n     = N;
+        int k     = std::min(m, n);
         int lda   = m;
         int ldu   = m;
-        int ldvt  = n;
+        int ldvt  = k;
         int lwork = -1;
         int info;
-        std::vector<underlying_type<T>> singular_values(std::min(m, n));
-        Matrix<T> u(m, m);
-        // std::vector<T> vt (n*n);
-        Matrix<T> vt(n, n);
-        std::vector<T> work(std::min(m, n));
-        std::vector<underlying_type<T>> rwork(5 * std::min(m, n));
-
-        Lapack<T>::gesvd("A", "A", &m, &n, mat.data(), &lda, singular_values.data(), u.data(), &ldu, vt.data(), &ldvt, work.data(), &lwork, rwork.data(), &info);
-        lwork = (int)std::real(work[0]);
+        std::vector<underlying_type<T>> singular_values(k);
+        std::vector<T> u(std::size_t(m) * k);
+        std::vector<T> vt(std::size_t(k) * n);
+        std::vector<T> work(1);
+        std::vector<underlying_type<T>> rwork(is_complex<T>() ? std::size_t(k) * std::max(5 * k + 7, 2 * std::max(m, n) + 2 * k + 1) : 0);
+        std::vector<int> iwork(8 * k);
+
+        Lapack<T>::gesdd("S", &m, &n, mat.data(), &lda, singular_values.data(), u.data(), &ldu, vt.data(), &ldvt, work.data(), &lwork, rwork.data(), iwork.data(), &info);
+        lwork = std::max((int)std::real(work[0]), 1);
         work.resize(lwork);
-        Lapack<T>::gesvd("A", "A", &m, &n, mat.data(), &lda, singular_values.data(), u.data(), &ldu, vt.data(), &ldvt, work.data(), &lwork, rwork.data(), &info);
+        Lapack<T>::gesdd("S", &m, &n, mat.data(), &lda, singular_values.data(), u.data(), &ldu, vt.data(), &ldvt, work.data(), &lwork, rwork.data(), iwork.data(), &info);
 
         if (rank == -1) {
 
@@ -54,7 +76,7 @@ class SVD final : public VirtualLowRankGenerator<T> {
                 svd_norm += std::pow(std::abs(singular_values[j]), 2);
             } while (j > 0 && std::sqrt(svd_norm) / Norm < epsilon);
 
-            reqrank = std::min(j + 1, std::min(m, n));
+            reqrank = std::min(j + 1, k);
 
             if (reqrank * (M + N) > (M * N)) {
                 reqrank = -1;
@@ -62,26 +84,23 @@ class SVD final : public VirtualLowRankGenerator<T> {
             rank = reqrank;
 
         } else {
-            reqrank = std::min(rank, std::min(M, N));
+            reqrank = std::min(rank, k);
+            rank    = reqrank;
         }
 
         if (rank > 0) {
-            *U = new T[M * rank];
-            *V = new T[rank * N];
-            for (int i = 0; i < M; i++) {
-                for (int j = 0; j < reqrank; j++) {
-                    (*U)[i + M * j] = u(i, j) * singular_values[j];
+            *U = new T[std::size_t(M) * rank];
+            *V = new T[std::size_t(rank) * N];
+            for (int j = 0; j < reqrank; j++) {
+                for (int i = 0; i < M; i++) {
+                    (*U)[i + std::size_t(M) * j] = u[i + std::size_t(ldu) * j] * singular_values[j];
                 }
             }
-            for (int i = 0; i < reqrank; i++) {
-                for (int j = 0; j < N; j++) {
-                    (*V)[i + rank * j] = vt(i, j);
-                }
+            for (int j = 0; j < N; j++) {
+                std::copy_n(vt.data() + std::size_t(ldvt) * j, reqrank, *V + std::size_t(rank) * j);
             }
         }
     }
-
-    // T get_singular_value(int i) { return singular_values[i]; }
 };
 
 } // namespace htool
@@ -0,0 +1,302 @@
+#ifndef HTOOL_BLOCKED_ACA_HPP
+#define HTOOL_BLOCKED_ACA_HPP
+
+#include "../wrappers/wrapper_blas.hpp"
+#include "../wrappers/wrapper_lapack.hpp"
+#include "lrmat.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace htool {
+//=================================================================//
+//                         BLOCKED ACA
+//*****************************************************************//
+// Partially pivoted ACA working on panels of block_size rows. The rows of a
+// panel are computed in one call to the generator and updated with one gemm,
+// a pivot is then chosen in each of these rows as in partialACA, and the
+// columns of these pivots are computed in one call and updated with one gemm.
+// Crosses are stored contiguously as the columns of U (M x rank) and of V^T
+// (N x rank).
+// The first panel contains the row closest to the center of the target
+// cluster (as in partialACA) and rows evenly spread in the block, the next
+// ones the unvisited rows where the last crosses are the largest.
+//
+// With recompression, when the rank is given by epsilon, U=QuRu and V^T=QvRv
+// are orthogonalized and the SVD of RuRv^T is truncated at epsilon.
+template <typename T>
+class blockedACA final : public VirtualLowRankGenerator<T> {
+    int block_size;
+    bool recompression;
+
+    // Truncates the approximation given by the first rank columns of uu (M x rank) and vv (N x rank), returns the new rank
+    int recompress(double epsilon, int M, int N, int rank, const std::vector<T> &uu, const std::vector<T> &vv, T **U, T **V) const {
+        int info;
+        int lwork = -1;
+        std::vector<T> Qu(uu.begin(), uu.begin() + std::size_t(M) * rank), Qv(vv.begin(), vv.begin() + std::size_t(N) * rank), tau_u(rank), tau_v(rank);
+        std::vector<T> work_query(4);
+        Lapack<T>::geqrf(&M, &rank, Qu.data(), &M, tau_u.data(), &work_query[0], &lwork, &info);
+        Lapack<T>::geqrf(&N, &rank, Qv.data(), &N, tau_v.data(), &work_query[1], &lwork, &info);
+        Lapack<T>::mqr("L", "N", &M, &rank, &rank, Qu.data(), &M, tau_u.data(), Qu.data(), &M, &work_query[2], &lwork, &info);
+        Lapack<T>::mqr("L", "N", &N, &rank, &rank, Qv.data(), &N, tau_v.data(), Qv.data(), &N, &work_query[3], &lwork, &info);
+        for (int i = 0; i < 4; i++) {
+            lwork = std::max(lwork, int(std::real(work_query[i])));
+        }
+        std::vector<T> work(lwork);
+        Lapack<T>::geqrf(&M, &rank, Qu.data(), &M, tau_u.data(), work.data(), &lwork, &info);
+        Lapack<T>::geqrf(&N, &rank, Qv.data(), &N, tau_v.data(), work.data(), &lwork, &info);
+
+        // SVD of the core matrix RuRv^T
+        std::vector<T> Ru(rank * rank, 0), Rv(rank * rank, 0), core(rank * rank);
+        for (int j = 0; j < rank; j++) {
+            std::copy_n(Qu.data() + std::size_t(M) * j, j + 1, Ru.data() + rank * j);
+            std::copy_n(Qv.data() + std::size_t(N) * j, j + 1, Rv.data() + rank * j);
+        }
+        char transa = 'N';
+        char transb = 'T';
+        T alpha     = 1;
+        T beta      = 0;
+        Blas<T>::gemm(&transa, &transb, &rank, &rank, &rank, &alpha, Ru.data(), &rank, Rv.data(), &rank, &beta, core.data(), &rank);
+
+        std::vector<underlying_type<T>> singular_values(rank), rwork(5 * rank);
+        std::vector<T> w(rank * rank), zh(rank * rank);
+        int lwork_svd = -1;
+        Lapack<T>::gesvd("S", "S", &rank, &rank, core.data(), &rank, singular_values.data(), w.data(), &rank, zh.data(), &rank, work_query.data(), &lwork_svd, rwork.data(), &info);
+        lwork_svd = std::max(int(std::real(work_query[0])), 1);
+        std::vector<T> work_svd(lwork_svd);
+        Lapack<T>::gesvd("S", "S", &rank, &rank, core.data(), &rank, singular_values.data(), w.data(), &rank, zh.data(), &rank, work_svd.data(), &lwork_svd, rwork.data(), &info);
+
+        // Truncation with respect to the Frobenius norm of the approximation
+        double norm = 0;
+        for (int j = 0; j < rank; j++) {
+            norm += std::pow(singular_values[j], 2);
+        }
+        int new_rank    = rank;
+        double tail_sum = 0;
+        while (new_rank > 1 && std::sqrt(tail_sum + std::pow(singular_values[new_rank - 1], 2)) <= epsilon * std::sqrt(norm)) {
+            tail_sum += std::pow(singular_values[new_rank - 1], 2);
+            new_rank--;
+        }
+
+        // U = Qu W S and V^T = Qv (Z^H)^T, Qu and Qv are applied with their Householder reflectors
+        *U = new T[std::size_t(M) * new_rank];
+        std::vector<T> Vt(std::size_t(N) * new_rank, 0);
+        std::fill_n(*U, std::size_t(M) * new_rank, T(0));
+        for (int k = 0; k < new_rank; k++) {
+            for (int i = 0; i < rank; i++) {
+                (*U)[i + std::size_t(M) * k] = w[i + rank * k] * singular_values[k];
+                Vt[i + std::size_t(N) * k]   = zh[k + rank * i];
+            }
+        }
+        Lapack<T>::mqr("L", "N", &M, &new_rank, &rank, Qu.data(), &M, tau_u.data(), *U, &M, work.data(), &lwork, &info);
+        Lapack<T>::mqr("L", "N", &N, &new_rank, &rank, Qv.data(), &N, tau_v.data(), Vt.data(), &N, work.data(), &lwork, &info);
+
+        *V = new T[std::size_t(new_rank) * N];
+        for (int j = 0; j < N; j++) {
+            for (int k = 0; k < new_rank; k++) {
+                (*V)[k + std::size_t(new_rank) * j] = Vt[j + std::size_t(N) * k];
+            }
+        }
+        return new_rank;
+    }
+
+  public:
+    blockedACA(int block_size0 = 8, bool recompression0 = true) : block_size(block_size0), recompression(recompression0) {
+        if (block_size < 1) {
+            throw std::invalid_argument("[Htool error] Block size of blockedACA must be positive"); // LCOV_EXCL_LINE
+        }
+    }
+
+    int get_block_size() const { return block_size; }
+    bool get_recompression() const { return recompression; }
+
+    // If reqrank=-1 (default value), we use the precision given by epsilon for the stopping criterion;
+    // otherwise, we use the required rank for the stopping criterion (!: at the end the rank could be lower)
+    void copy_low_rank_approximation(double epsilon, int M, int N, const int *const rows, const int *const cols, int &rank, T **U, T **V, const VirtualGenerator<T> &A, const VirtualCluster &t, const double *const xt, const VirtualCluster &, const double *const) const {
+
+        //// Choice of the first row (see paragraph 3.4.3 page 151 Bebendorf)
+        double dist = 1e30;
+        int I       = 0;
+        for (int i = 0; i < M; i++) {
+            double aux_dist = std::sqrt(std::inner_product(xt + (t.get_space_dim() * rows[i]), xt + (t.get_space_dim() * rows[i]) + t.get_space_dim(), t.get_ctr_data(), double(0), std::plus<double>(), [](double u, double v) { return (u - v) * (u - v); }));
+            if (dist > aux_dist) {
+                dist = aux_dist;
+                I    = i;
+            }
+        }
+        std::vector<int> panel(std::min(block_size, M));
+        for (int l = 0; l < panel.size(); l++) {
+            panel[l] = (I + (long(l) * M) / panel.size()) % M;
+        }
+
+        int reqrank           = rank;
+        int max_rank          = reqrank > 0 ? std::min(reqrank, std::min(M, N)) : std::min(M, N);
+        int q                 = 0;
+        bool converged        = false;
+        bool not_advantageous = false;
+        std::vector<T> uu, vv;
+        std::vector<char> visited_row(M, false);
+        std::vector<char> visited_col(N, false);
+
+        underlying_type<T> frob = 0;
+        underlying_type<T> aux  = 0;
+        int inc(1);
+        T one(1), minus_one(-1), zero(0);
+        char no_trans = 'N';
+        char trans    = 'T';
+        char conj     = 'C';
+
+        while (!converged && q < max_rank && !panel.empty()) {
+            int b = panel.size();
+
+            //// Residual of the rows of the panel
+            std::vector<int> panel_rows(b);
+            for (int l = 0; l < b; l++) {
+                panel_rows[l]         = rows[panel[l]];
+                visited_row[panel[l]] = true;
+            }
+            std::vector<T> R(std::size_t(b) * N);
+            A.copy_submatrix(b, N, panel_rows.data(), cols, R.data());
+            if (q > 0) {
+                std::vector<T> U_panel(std::size_t(b) * q);
+                for (int k = 0; k < q; k++) {
+                    for (int l = 0; l < b; l++) {
+                        U_panel[l + b * k] = uu[panel[l] + std::size_t(M) * k];
+                    }
+                }
+                Blas<T>::gemm(&no_trans, &trans, &b, &N, &q, &minus_one, U_panel.data(), &b, vv.data(), &N, &one, R.data(), &b);
+            }
+
+            //// Pivots in the panel, taken row by row, each pivot row is eliminated from the next rows of the panel
+            std::vector<int> pivot_rows, pivot_cols;
+            for (int p = 0; p < b && q + pivot_rows.size() < max_rank; p++) {
+                if ((q + pivot_rows.size() + 1) * (M + N) > std::size_t(M) * N) { // the next rank would not be advantageous
+                    not_advantageous = true;
+                    break;
+                }
+                underlying_type<T> pivot = 0;
+                int J                    = -1;
+                for (int j = 0; j < N; j++) {
+                    if (!visited_col[j] && std::abs(R[p + std::size_t(b) * j]) > pivot) {
+                        pivot = std::abs(R[p + std::size_t(b) * j]);
+                        J     = j;
+                    }
+                }
+                if (pivot <= 1e-15) { // zero row
+                    continue;
+                }
+                visited_col[J] = true;
+                T gamma        = T(1.) / R[p + std::size_t(b) * J];
+                for (int l = p + 1; l < b; l++) {
+                    T coef = -R[l + std::size_t(b) * J] * gamma;
+                    Blas<T>::axpy(&N, &coef, R.data() + p, &b, R.data() + l, &b);
+                }
+                pivot_rows.push_back(p);
+                pivot_cols.push_back(J);
+            }
+            int nb = pivot_rows.size();
+            if (nb == 0) {
+                if (q == 0 && !not_advantageous) { // corner case where first rows are zero, ACA fails, we build a dense block instead
+                    std::cout << "[Htool warning] blockedACA found zero rows in a " + std::to_string(M) + "x" + std::to_string(N) + " block. Final rank is -1" << std::endl;
+                }
+                break;
+            }
+
+            //// Residual of the columns of the pivots
+            std::vector<int> panel_cols(nb);
+            for (int l = 0; l < nb; l++) {
+                panel_cols[l] = cols[pivot_cols[l]];
+            }
+            std::vector<T> C(std::size_t(M) * nb);
+            A.copy_submatrix(M, nb, rows, panel_cols.data(), C.data());
+            if (q > 0) {
+                std::vector<T> V_panel(std::size_t(nb) * q);
+                for (int k = 0; k < q; k++) {
+                    for (int l = 0; l < nb; l++) {
+                        V_panel[l + nb * k] = vv[pivot_cols[l] + std::size_t(N) * k];
+                    }
+                }
+                Blas<T>::gemm(&no_trans, &trans, &M, &nb, &q, &minus_one, uu.data(), &M, V_panel.data(), &nb, &one, C.data(), &M);
+            }
+
+            //// New crosses, the rows of the pivots are the residual rows and the columns are eliminated like the rows
+            uu.resize(std::size_t(M) * (q + nb));
+            vv.resize(std::size_t(N) * (q + nb));
+            int nb_kept = nb;
+            for (int l = 0; l < nb; l++) {
+                T *u = uu.data() + std::size_t(M) * (q + l);
+                T *v = vv.data() + std::size_t(N) * (q + l);
+                for (int j = 0; j < N; j++) {
+                    v[j] = R[pivot_rows[l] + std::size_t(b) * j];
+                }
+                T gamma = T(1.) / v[pivot_cols[l]];
+                std::transform(C.data() + std::size_t(M) * l, C.data() + std::size_t(M) * (l + 1), u, [&](T x) { return x * gamma; });
+                for (int m = l + 1; m < nb; m++) {
+                    T coef = -v[pivot_cols[m]];
+                    Blas<T>::axpy(&M, &coef, u, &inc, C.data() + std::size_t(M) * m, &inc);
+                }
+
+                // Error estimator
+                if (reqrank < 0) {
+                    int previous_rank = q + l;
+                    aux               = std::pow(Blas<T>::nrm2(&M, u, &inc), 2) * std::pow(Blas<T>::nrm2(&N, v, &inc), 2);
+                    T frob_aux        = 0;
+                    if (previous_rank > 0) {
+                        std::vector<T> uu_u(previous_rank), vv_v(previous_rank);
+                        Blas<T>::gemv(&conj, &M, &previous_rank, &one, uu.data(), &M, u, &inc, &zero, uu_u.data(), &inc);
+                        Blas<T>::gemv(&conj, &N, &previous_rank, &one, vv.data(), &N, v, &inc, &zero, vv_v.data(), &inc);
+                        for (int k = 0; k < previous_rank; k++) {
+                            frob_aux += uu_u[k] * vv_v[k];
+                        }
+                    }
+                    frob += aux + 2 * std::real(frob_aux);
+                    if (std::sqrt(aux / frob) <= epsilon) {
+                        converged = true;
+                        nb_kept   = l + 1;
+                        break;
+                    }
+                }
+            }
+            q += nb_kept;
+            if (not_advantageous && !converged) {
+                break;
+            }
+
+            //// Next panel
+            std::vector<std::pair<underlying_type<T>, int>> candidates;
+            for (int i = 0; i < M; i++) {
+                if (visited_row[i])
+                    continue;
+                underlying_type<T> score = 0;
+                for (int l = q - nb_kept; l < q; l++) {
+                    score = std::max(score, std::abs(uu[i + std::size_t(M) * l]));
+                }
+                candidates.emplace_back(score, i);
+            }
+            int b_next = std::min(block_size, int(candidates.size()));
+            std::partial_sort(candidates.begin(), candidates.begin() + b_next, candidates.end(), [](const std::pair<underlying_type<T>, int> &a, const std::pair<underlying_type<T>, int> &b) { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+            panel.resize(b_next);
+            for (int l = 0; l < b_next; l++) {
+                panel[l] = candidates[l].second;
+            }
+        }
+
+        // Final rank
+        if (q == 0 || (not_advantageous && !converged)) {
+            rank = -1;
+        } else if (recompression && reqrank < 0 && q > 1) {
+            rank = recompress(epsilon, M, N, q, uu, vv, U, V);
+        } else {
+            rank = q;
+            *U   = new T[std::size_t(M) * rank];
+            *V   = new T[std::size_t(rank) * N];
+            std::copy_n(uu.begin(), std::size_t(M) * rank, *U);
+            for (int j = 0; j < N; j++) {
+                for (int k = 0; k < rank; k++) {
+                    (*V)[k + std::size_t(rank) * j] = vv[j + std::size_t(N) * k];
+                }
+            }
+        }
+    }
+};
+} // namespace htool
+#endif
@@ -2,6 +2,7 @@
 #define HTOOL_LRMAT_HPP
 
 #include "../clustering/cluster.hpp"
+#include "../misc/arena.hpp"
 #include "../types/matrix.hpp"
 #include "../types/virtual_generator.hpp"
 #include "virtual_lrmat_generator.hpp"
@@ -18,8 +19,12 @@ class LowRankMatrix : public IMatrix<T> {
     int rank;
     // nr, nc;
     Matrix<T> U, V;
-    std::vector<int> ir;
-    std::vector<int> ic;
+    // Owned copy of the indices, empty when they are referenced
+    std::vector<int> ir_storage;
+    std::vector<int> ic_storage;
+    // Point to ir_storage and ic_storage, or to external storage (usually a cluster permutation) which has to outlive the low rank matrix
+    const int *ir;
+    const int *ic;
     int offset_i;
     int offset_j;
     double epsilon;
@@ -28,26 +33,67 @@ class LowRankMatrix : public IMatrix<T> {
   public:
     // Constructors
     LowRankMatrix() = delete;
-    LowRankMatrix(int dimension0, const std::vector<int> &ir0, const std::vector<int> &ic0, int rank0 = -1, double epsilon0 = 1e-3) : IMatrix<T>(dimension0 * ir0.size(), dimension0 * ic0.size()), rank(rank0), U(), V(), ir(ir0), ic(ic0), offset_i(0), offset_j(0), epsilon(epsilon0), dimension(dimension0) {}
+    LowRankMatrix(int dimension0, const std::vector<int> &ir0, const std::vector<int> &ic0, int rank0 = -1, double epsilon0 = 1e-3) : IMatrix<T>(dimension0 * ir0.size(), dimension0 * ic0.size()), rank(rank0), U(), V(), ir_storage(ir0), ic_storage(ic0), ir(ir_storage.data()), ic(ic_storage.data()), offset_i(0), offset_j(0), epsilon(epsilon0), dimension(dimension0) {}
 
-    LowRankMatrix(int dimension0, const std::vector<int> &ir0, const std::vector<int> &ic0, int offset_i0, int offset_j0, int rank0 = -1, double epsilon0 = 1e-3) : IMatrix<T>(dimension0 * ir0.size(), dimension0 * ic0.size()), rank(rank0), U(), V(), ir(ir0), ic(ic0), offset_i(offset_i0), offset_j(offset_j0), epsilon(epsilon0), dimension(dimension0) {}
+    LowRankMatrix(int dimension0, const std::vector<int> &ir0, const std::vector<int> &ic0, int offset_i0, int offset_j0, int rank0 = -1, double epsilon0 = 1e-3) : IMatrix<T>(dimension0 * ir0.size(), dimension0 * ic0.size()), rank(rank0), U(), V(), ir_storage(ir0), ic_storage(ic0), ir(ir_storage.data()), ic(ic_storage.data()), offset_i(offset_i0), offset_j(offset_j0), epsilon(epsilon0), dimension(dimension0) {}
+
+    // Used by HMatrix, the nb_ir and nb_ic indices read from ir0 and ic0 are not copied and have to outlive the low rank matrix
+    LowRankMatrix(ReferenceIndices, int dimension0, int nb_ir, int nb_ic, const int *const ir0, const int *const ic0, int offset_i0, int offset_j0, int rank0 = -1, double epsilon0 = 1e-3) : IMatrix<T>(dimension0 * nb_ir, dimension0 * nb_ic), rank(rank0), U(), V(), ir(ir0), ic(ic0), offset_i(offset_i0), offset_j(offset_j0), epsilon(epsilon0), dimension(dimension0) {}
+
+    // Referenced indices stay referenced
+    LowRankMatrix(const LowRankMatrix &m) : IMatrix<T>(m), rank(m.rank), U(m.U), V(m.V), ir_storage(m.ir_storage), ic_storage(m.ic_storage), ir(m.ir_storage.empty() ? m.ir : ir_storage.data()), ic(m.ic_storage.empty() ? m.ic : ic_storage.data()), offset_i(m.offset_i), offset_j(m.offset_j), epsilon(m.epsilon), dimension(m.dimension) {}
+
+    LowRankMatrix &operator=(const LowRankMatrix &m) {
+        if (&m == this) {
+            return *this;
+        }
+        IMatrix<T>::operator=(m);
+        rank       = m.rank;
+        U          = m.U;
+        V          = m.V;
+        ir_storage = m.ir_storage;
+        ic_storage = m.ic_storage;
+        ir         = m.ir_storage.empty() ? m.ir : ir_storage.data();
+        ic         = m.ic_storage.empty() ? m.ic : ic_storage.data();
+        offset_i   = m.offset_i;
+        offset_j   = m.offset_j;
+        epsilon    = m.epsilon;
+        dimension  = m.dimension;
+        return *this;
+    }
 
     // VIrtual function
-    void build(const VirtualGenerator<T> &A, const VirtualLowRankGenerator<T> &LRGenerator, const VirtualCluster &t, const double *const xt, const VirtualCluster &s, const double *const xs) {
+    // When an arena is given, U and V are stored contiguously in it and the arena has to outlive the low rank matrix
+    void build(const VirtualGenerator<T> &A, const VirtualLowRankGenerator<T> &LRGenerator, const VirtualCluster &t, const double *const xt, const VirtualCluster &s, const double *const xs, Arena *arena = nullptr) {
         if (this->rank == 0) {
             T *uu, *vv;
-            uu = new T[this->nr];
-            vv = new T[this->nc];
+            if (arena == nullptr) {
+                uu = new T[this->nr];
+                vv = new T[this->nc];
+            } else {
+                uu = arena->allocate<T>(this->nr + this->nc);
+                vv = uu + this->nr;
+            }
             std::fill_n(uu, this->nr, 0);
             std::fill_n(vv, this->nc, 0);
-            this->U.assign(this->nr, 1, uu);
-            this->V.assign(1, this->nc, vv);
+            this->U.assign(this->nr, 1, uu, arena == nullptr);
+            this->V.assign(1, this->nc, vv, arena == nullptr);
         } else {
             T *uu, *vv;
-            LRGenerator.copy_low_rank_approximation(epsilon, ir.size(), ic.size(), ir.data(), ic.data(), rank, &uu, &vv, A, t, xt, s, xs);
-            if (rank > 0) {
+            LRGenerator.copy_low_rank_approximation(epsilon, this->nr / dimension, this->nc / dimension, ir, ic, rank, &uu, &vv, A, t, xt, s, xs);
+            if (rank > 0 && arena == nullptr) {
                 this->U.assign(this->nr, rank, uu);
                 this->V.assign(rank, this->nc, vv);
+            } else if (rank > 0) {
+                std::size_t size_U = std::size_t(this->nr) * rank;
+                std::size_t size_V = std::size_t(rank) * this->nc;
+                T *data            = arena->allocate<T>(size_U + size_V);
+                std::copy_n(uu, size_U, data);
+                std::copy_n(vv, size_V, data + size_U);
+                delete[] uu;
+                delete[] vv;
+                this->U.assign(this->nr, rank, data, false);
+                this->V.assign(rank, this->nc, data + size_U, false);
             } else {
                 // rank=-1 will be deleted
             }
@@ -58,14 +104,23 @@ class LowRankMatrix : public IMatrix<T> {
     // int nb_rows() const { return this->nr; }
     // int nb_cols() const { return this->nc; }
     int rank_of() const { return this->rank; }
-    std::vector<int> get_ir() const { return this->ir; }
-    std::vector<int> get_ic() const { return this->ic; }
+    std::vector<int> get_ir() const { return std::vector<int>(this->ir, this->ir + this->nr / dimension); }
+    std::vector<int> get_ic() const { return std::vector<int>(this->ic, this->ic + this->nc / dimension); }
+    const int *data_ir() const { return this->ir; }
+    const int *data_ic() const { return this->ic; }
     int get_offset_i() const { return this->offset_i; }
     int get_offset_j() const { return this->offset_j; }
     T get_U(int i, int j) const { return this->U(i, j); }
     T get_V(int i, int j) const { return this->V(i, j); }
     void assign_U(int i, int j, T *ptr) { return this->U.assign(i, j, ptr); }
     void assign_V(int i, int j, T *ptr) { return this->V.assign(i, j, ptr); }
+    const Matrix<T> &get_U_matrix() const { return this->U; }
+    const Matrix<T> &get_V_matrix() const { return this->V; }
+    // Moves U and V to u and v, which are not owned and have to outlive the low rank matrix
+    void relocate(T *u, T *v) {
+        this->U.relocate(u);
+        this->V.relocate(v);
+    }
     std::vector<int> get_xr() const { return this->xr; }
     std::vector<int> get_xc() const { return this->xc; }
     double get_epsilon() const { return this->epsilon; }
@@ -89,16 +144,63 @@ class LowRankMatrix : public IMatrix<T> {
     void add_mvprod_row_major(const T *const in, T *const out, const int &mu, char transb = 'T', char op = 'N') const {
         if (rank != 0) {
             std::vector<T> a(this->rank * mu);
+            this->add_mvprod_row_major(in, out, mu, transb, op, a.data());
+        }
+    }
+
+    // Same product without allocation, work holds at least rank*mu coefficients
+    void add_mvprod_row_major(const T *const in, T *const out, const int &mu, char transb, char op, T *work) const {
+        if (rank != 0) {
+            if (op == 'N') {
+                V.mvprod_row_major(in, work, mu, transb, op);
+                U.add_mvprod_row_major(work, out, mu, transb, op);
+            } else if (op == 'C' || op == 'T') {
+                U.mvprod_row_major(in, work, mu, transb, op);
+                V.add_mvprod_row_major(work, out, mu, transb, op);
+            }
+        }
+    }
+
+    // Products with column-major panels, work holds at least rank*mu coefficients
+    void add_mvprod_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu, char op = 'N') const {
+        if (rank != 0) {
+            std::vector<T> a(this->rank * mu);
+            this->add_mvprod_col_major(in, ldin, out, ldout, mu, op, a.data());
+        }
+    }
+
+    void add_mvprod_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu, char op, T *work) const {
+        if (rank != 0) {
             if (op == 'N') {
-                V.mvprod_row_major(in, a.data(), mu, transb, op);
-                U.add_mvprod_row_major(a.data(), out, mu, transb, op);
+                V.mvprod_col_major(in, ldin, work, rank, mu, op);
+                U.add_mvprod_col_major(work, rank, out, ldout, mu, op);
             } else if (op == 'C' || op == 'T') {
-                U.mvprod_row_major(in, a.data(), mu, transb, op);
-                V.add_mvprod_row_major(a.data(), out, mu, transb, op);
+                U.mvprod_col_major(in, ldin, work, rank, mu, op);
+                V.add_mvprod_col_major(work, rank, out, ldout, mu, op);
             }
         }
     }
 
+    // out_r += A in_c and out_c += op(A) in_r for one right-hand side, work holds at least 2*rank coefficients
+    void add_mvprod_and_transp(const T *const in_c, T *const out_r, const T *const in_r, T *const out_c, char op) const {
+        if (rank != 0) {
+            std::vector<T> work(2 * this->rank);
+            this->add_mvprod_and_transp(in_c, out_r, in_r, out_c, op, work.data());
+        }
+    }
+
+    // U is read once, its columns are as long as the block, V is read twice
+    void add_mvprod_and_transp(const T *const in_c, T *const out_r, const T *const in_r, T *const out_c, char op, T *work) const {
+        if (rank != 0) {
+            T *a = work;
+            T *b = work + rank;
+            V.mvprod_col_major(in_c, this->nc, a, rank, 1, 'N');
+            std::fill_n(b, rank, T(0));
+            U.add_mvprod_and_transp(a, out_r, in_r, b, op);
+            V.add_mvprod_col_major(b, rank, out_c, this->nc, 1, op);
+        }
+    }
+
     void get_whole_matrix(T *const out) const {
         char transa = 'N';
         char transb = 'N';
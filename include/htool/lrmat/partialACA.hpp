@@ -42,7 +42,7 @@ class partialACA final : public VirtualLowRankGenerator<T> {
         double dist = 1e30;
         int I       = 0;
         for (int i = 0; i < M; i++) {
-            double aux_dist = std::sqrt(std::inner_product(xt + (t.get_space_dim() * rows[i]), xt + (t.get_space_dim() * rows[i]) + t.get_space_dim(), t.get_ctr().begin(), double(0), std::plus<double>(), [](double u, double v) { return (u - v) * (u - v); }));
+            double aux_dist = std::sqrt(std::inner_product(xt + (t.get_space_dim() * rows[i]), xt + (t.get_space_dim() * rows[i]) + t.get_space_dim(), t.get_ctr_data(), double(0), std::plus<double>(), [](double u, double v) { return (u - v) * (u - v); }));
             if (dist > aux_dist) {
                 dist = aux_dist;
                 I    = i;
@@ -0,0 +1,175 @@
+#ifndef HTOOL_RANDOMIZED_SVD_HPP
+#define HTOOL_RANDOMIZED_SVD_HPP
+
+#include "../wrappers/wrapper_blas.hpp"
+#include "../wrappers/wrapper_lapack.hpp"
+#include "lrmat.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace htool {
+//=================================================================//
+//                        RANDOMIZED SVD
+//*****************************************************************//
+// Adaptive randomized range finder (see Halko, Martinsson and Tropp, 2011,
+// and Martinsson and Voronin, 2016). The block is assembled, then block_size
+// gaussian vectors at a time are applied to the residual R = A - QB with gemm,
+// the result is orthonormalized against Q and factorized with geqrf, which
+// gives the next columns of Q and rows of B = Q^H A, and R is updated. It stops
+// when ||R||_F <= epsilon ||A||_F, or with a required rank when Q has
+// rank+oversampling columns. The SVD of B is truncated so that the total error
+// stays below epsilon ||A||_F.
+// Random vectors only depend on the seed and on the block, so that the
+// approximation does not depend on the order in which blocks are computed.
+template <typename T>
+class randomizedSVD final : public VirtualLowRankGenerator<T> {
+    int block_size;
+    int oversampling;
+    unsigned int seed;
+
+    // Column by column, M * N may not fit in the int size of nrm2
+    static double frobenius_norm(int M, int N, const T *const R) {
+        int inc     = 1;
+        double norm = 0;
+        for (int j = 0; j < N; j++) {
+            double column_norm = Blas<T>::nrm2(&M, R + std::size_t(M) * j, &inc);
+            norm += column_norm * column_norm;
+        }
+        return std::sqrt(norm);
+    }
+
+  public:
+    randomizedSVD(int block_size0 = 8, int oversampling0 = 8, unsigned int seed0 = 0) : block_size(block_size0), oversampling(oversampling0), seed(seed0) {
+        if (block_size < 1 || oversampling < 0) {
+            throw std::invalid_argument("[Htool error] Invalid arguments to create randomizedSVD"); // LCOV_EXCL_LINE
+        }
+    }
+
+    int get_block_size() const { return block_size; }
+    int get_oversampling() const { return oversampling; }
+    unsigned int get_seed() const { return seed; }
+
+    void copy_low_rank_approximation(double epsilon, int M, int N, const int *const rows, const int *const cols, int &rank, T **U, T **V, const VirtualGenerator<T> &A, const VirtualCluster &, const double *const, const VirtualCluster &, const double *const) const {
+        int reqrank = rank;
+
+        //// Matrix assembling, R is the residual
+        std::vector<T> R(std::size_t(M) * N);
+        A.copy_submatrix(M, N, rows, cols, R.data());
+        double norm        = frobenius_norm(M, N, R.data());
+        double target_norm = epsilon * norm;
+        if (norm == 0) {
+            rank = -1;
+            return;
+        }
+
+        int max_rank    = std::min(M, N);
+        int target_rank = reqrank > 0 ? std::min(reqrank + oversampling, max_rank) : max_rank;
+
+        std::seed_seq seeds{seed, static_cast<unsigned int>(M), static_cast<unsigned int>(N), static_cast<unsigned int>(rows[0]), static_cast<unsigned int>(cols[0])};
+        std::mt19937 generator(seeds);
+        std::normal_distribution<double> distribution;
+
+        T one(1), minus_one(-1), zero(0);
+        char no_trans = 'N';
+        char conj     = 'C';
+        int info;
+
+        //// Range finder
+        std::vector<T> Q, B; // Q is M x q and B is q x N with leading dimension max_rank
+        int q                = 0;
+        double residual_norm = norm;
+        while (q < target_rank && (reqrank > 0 || residual_norm > target_norm)) {
+            int b = std::min(block_size, target_rank - q);
+            if (reqrank < 0 && std::size_t(q + b) * (std::size_t(M) + N) > std::size_t(M) * N) { // the next rank would not be advantageous
+                q = -1;
+                break;
+            }
+            Q.resize(std::size_t(M) * (q + b));
+            B.resize(std::size_t(max_rank) * N);
+
+            // Y = R Omega
+            std::vector<T> omega(std::size_t(N) * b);
+            for (auto &x : omega) {
+                x = distribution(generator);
+            }
+            T *Y = Q.data() + std::size_t(M) * q;
+            Blas<T>::gemm(&no_trans, &no_trans, &M, &b, &N, &one, R.data(), &M, omega.data(), &N, &zero, Y, &M);
+
+            // Orthogonalization against the previous columns of Q
+            if (q > 0) {
+                std::vector<T> QY(std::size_t(q) * b);
+                Blas<T>::gemm(&conj, &no_trans, &q, &b, &M, &one, Q.data(), &M, Y, &M, &zero, QY.data(), &q);
+                Blas<T>::gemm(&no_trans, &no_trans, &M, &b, &q, &minus_one, Q.data(), &M, QY.data(), &q, &one, Y, &M);
+            }
+
+            // Y = Q_new R_Y
+            std::vector<T> tau(b), Q_new(std::size_t(M) * b, 0);
+            int lwork = -1;
+            T work_query;
+            Lapack<T>::geqrf(&M, &b, Y, &M, tau.data(), &work_query, &lwork, &info);
+            lwork = std::max(std::max(int(std::real(work_query)), b), 1);
+            std::vector<T> work(lwork);
+            Lapack<T>::geqrf(&M, &b, Y, &M, tau.data(), work.data(), &lwork, &info);
+            for (int j = 0; j < b; j++) {
+                Q_new[j + std::size_t(M) * j] = 1;
+            }
+            Lapack<T>::mqr("L", "N", &M, &b, &b, Y, &M, tau.data(), Q_new.data(), &M, work.data(), &lwork, &info);
+            std::copy(Q_new.begin(), Q_new.end(), Y);
+
+            // B_new = Q_new^H R and R = R - Q_new B_new
+            std::vector<T> B_new(std::size_t(b) * N);
+            Blas<T>::gemm(&conj, &no_trans, &b, &N, &M, &one, Y, &M, R.data(), &M, &zero, B_new.data(), &b);
+            Blas<T>::gemm(&no_trans, &no_trans, &M, &N, &b, &minus_one, Y, &M, B_new.data(), &b, &one, R.data(), &M);
+            for (int j = 0; j < N; j++) {
+                std::copy_n(B_new.data() + std::size_t(b) * j, b, B.data() + q + std::size_t(max_rank) * j);
+            }
+            q += b;
+            residual_norm = frobenius_norm(M, N, R.data());
+        }
+
+        if (q <= 0) {
+            rank = -1;
+            return;
+        }
+
+        //// SVD of B
+        int ldb = max_rank;
+        std::vector<underlying_type<T>> singular_values(q), rwork(5 * q);
+        std::vector<T> w(std::size_t(q) * q), zh(std::size_t(q) * N);
+        int lwork = -1;
+        T work_query;
+        Lapack<T>::gesvd("S", "S", &q, &N, B.data(), &ldb, singular_values.data(), w.data(), &q, zh.data(), &q, &work_query, &lwork, rwork.data(), &info);
+        lwork = std::max(int(std::real(work_query)), 1);
+        std::vector<T> work(lwork);
+        Lapack<T>::gesvd("S", "S", &q, &N, B.data(), &ldb, singular_values.data(), w.data(), &q, zh.data(), &q, work.data(), &lwork, rwork.data(), &info);
+
+        // Truncation, the error of the truncation is orthogonal to the residual
+        int new_rank = q;
+        if (reqrank > 0) {
+            new_rank = std::min(reqrank, q);
+        } else {
+            double budget   = std::pow(target_norm, 2) - std::pow(residual_norm, 2);
+            double tail_sum = 0;
+            while (new_rank > 1 && tail_sum + std::pow(singular_values[new_rank - 1], 2) <= budget) {
+                tail_sum += std::pow(singular_values[new_rank - 1], 2);
+                new_rank--;
+            }
+        }
+
+        // U = Q W S and V = Z^H
+        for (int k = 0; k < new_rank; k++) {
+            std::transform(w.begin() + std::size_t(q) * k, w.begin() + std::size_t(q) * (k + 1), w.begin() + std::size_t(q) * k, [&](T x) { return x * singular_values[k]; });
+        }
+        rank = new_rank;
+        *U   = new T[std::size_t(M) * rank];
+        *V   = new T[std::size_t(rank) * N];
+        Blas<T>::gemm(&no_trans, &no_trans, &M, &rank, &q, &one, Q.data(), &M, w.data(), &q, &zero, *U, &M);
+        for (int j = 0; j < N; j++) {
+            std::copy_n(zh.data() + std::size_t(q) * j, rank, *V + std::size_t(rank) * j);
+        }
+    }
+};
+} // namespace htool
+#endif
@@ -64,7 +64,7 @@ class sympartialACA final : public VirtualLowRankGenerator<T> {
         double dist = 1e30;
         int I1      = 0;
         for (int i = 0; i < n1; i++) {
-            double aux_dist = std::sqrt(std::inner_product(x1 + (cluster_1->get_space_dim() * i1[i]), x1 + (cluster_1->get_space_dim() * i1[i]) + cluster_1->get_space_dim(), cluster_1->get_ctr().begin(), double(0), std::plus<double>(), [](double u, double v) { return (u - v) * (u - v); }));
+            double aux_dist = std::sqrt(std::inner_product(x1 + (cluster_1->get_space_dim() * i1[i]), x1 + (cluster_1->get_space_dim() * i1[i]) + cluster_1->get_space_dim(), cluster_1->get_ctr_data(), double(0), std::plus<double>(), [](double u, double v) { return (u - v) * (u - v); }));
 
             if (dist > aux_dist) {
                 dist = aux_dist;
@@ -0,0 +1,82 @@
+#ifndef HTOOL_ALIGNED_BUFFER_HPP
+#define HTOOL_ALIGNED_BUFFER_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace htool {
+
+// Allocates bytes aligned on alignment bytes with std::malloc, raw is the pointer to give to std::free
+inline void *aligned_malloc(std::size_t bytes, std::size_t alignment, void *&raw) {
+    raw = std::malloc(bytes + alignment);
+    if (raw == nullptr) {
+        throw std::bad_alloc(); // LCOV_EXCL_LINE
+    }
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(raw);
+    return reinterpret_cast<void *>((address + alignment - 1) / alignment * alignment);
+}
+
+//=================================================================//
+//                      CLASS ALIGNED BUFFER
+//*****************************************************************//
+// Uninitialized storage aligned on alignment bytes which only grows, so that
+// it is reused without allocation once it is large enough. Nothing is
+// constructed nor destroyed, it is meant for arithmetic types.
+template <typename T>
+class AlignedBuffer {
+  private:
+    void *raw;
+    T *ptr;
+    std::size_t capacity;
+    std::size_t alignment;
+
+  public:
+    explicit AlignedBuffer(std::size_t alignment0 = 64) : raw(nullptr), ptr(nullptr), capacity(0), alignment(alignment0) {}
+
+    AlignedBuffer(const AlignedBuffer &) = delete;
+    AlignedBuffer &operator=(const AlignedBuffer &) = delete;
+
+    AlignedBuffer(AlignedBuffer &&other) noexcept : raw(other.raw), ptr(other.ptr), capacity(other.capacity), alignment(other.alignment) {
+        other.raw      = nullptr;
+        other.ptr      = nullptr;
+        other.capacity = 0;
+    }
+
+    AlignedBuffer &operator=(AlignedBuffer &&other) noexcept {
+        if (this != &other) {
+            std::free(raw);
+            raw            = other.raw;
+            ptr            = other.ptr;
+            capacity       = other.capacity;
+            alignment      = other.alignment;
+            other.raw      = nullptr;
+            other.ptr      = nullptr;
+            other.capacity = 0;
+        }
+        return *this;
+    }
+
+    ~AlignedBuffer() { std::free(raw); }
+
+    // Returns storage for at least n elements, previous content is lost if it grows
+    T *reserve(std::size_t n) {
+        if (n > capacity) {
+            std::free(raw);
+            ptr      = nullptr;
+            capacity = 0;
+            ptr      = static_cast<T *>(aligned_malloc(n * sizeof(T), alignment, raw));
+            capacity = n;
+        }
+        return ptr;
+    }
+
+    // Getters
+    T *data() const { return ptr; }
+    std::size_t get_capacity() const { return capacity; }
+    std::size_t get_alignment() const { return alignment; }
+};
+
+} // namespace htool
+
+#endif
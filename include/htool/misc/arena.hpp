@@ -0,0 +1,126 @@
+#ifndef HTOOL_ARENA_HPP
+#define HTOOL_ARENA_HPP
+
+#if _OPENMP
+#    include <omp.h>
+#endif
+
+#include "aligned_buffer.hpp"
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace htool {
+
+//=================================================================//
+//                         CLASS ARENA
+//*****************************************************************//
+// Memory pool for block payloads. Memory is requested in large aligned chunks
+// which are released all together when the arena is destroyed. Each thread
+// carves its allocations in its own current chunk, the chunk is left
+// uninitialized so that its pages are first touched by the thread that fills
+// them. Nothing is constructed nor destroyed, it is meant for arithmetic types.
+class Arena {
+  private:
+    struct Cursor {
+        char *current;
+        char *end;
+        std::size_t used;
+        char padding[64]; // avoid false sharing between threads
+        Cursor() : current(nullptr), end(nullptr), used(0) {}
+    };
+
+    std::size_t chunk_size;
+    std::size_t alignment;
+    std::vector<void *> chunks;
+    std::size_t allocated;
+    std::mutex chunks_mutex;
+
+    // one cursor per thread, the last one is shared and protected by shared_mutex
+    std::vector<Cursor> cursors;
+    std::mutex shared_mutex;
+
+    char *new_chunk(std::size_t bytes) {
+        void *raw;
+        char *chunk = static_cast<char *>(aligned_malloc(bytes, alignment, raw));
+        std::lock_guard<std::mutex> lock(chunks_mutex);
+        chunks.push_back(raw);
+        allocated += bytes;
+        return chunk;
+    }
+
+    void *allocate_from(Cursor &cursor, std::size_t bytes) {
+        cursor.used += bytes;
+        if (bytes > chunk_size) {
+            return new_chunk(bytes);
+        }
+        if (cursor.current == nullptr || std::size_t(cursor.end - cursor.current) < bytes) {
+            cursor.current = new_chunk(chunk_size);
+            cursor.end     = cursor.current + chunk_size;
+        }
+        void *ptr = cursor.current;
+        cursor.current += bytes;
+        return ptr;
+    }
+
+    int thread_slot() const {
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+        int id = omp_get_thread_num();
+        if (omp_get_active_level() <= 1 && id < int(cursors.size()) - 1) {
+            return id;
+        }
+        return -1;
+#else
+        return 0;
+#endif
+    }
+
+  public:
+    explicit Arena(std::size_t chunk_size0 = std::size_t(1) << 22, std::size_t alignment0 = 64) : chunk_size(chunk_size0), alignment(alignment0), allocated(0) {
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+        cursors.resize(omp_get_max_threads() + 1);
+#else
+        cursors.resize(2);
+#endif
+    }
+
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    ~Arena() {
+        for (void *chunk : chunks) {
+            std::free(chunk);
+        }
+    }
+
+    // Thread-safe
+    void *allocate(std::size_t bytes) {
+        bytes = (bytes + alignment - 1) / alignment * alignment;
+        int id = thread_slot();
+        if (id < 0) {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            return allocate_from(cursors.back(), bytes);
+        }
+        return allocate_from(cursors[id], bytes);
+    }
+
+    template <typename T>
+    T *allocate(std::size_t n) { return static_cast<T *>(this->allocate(n * sizeof(T))); }
+
+    // Getters, not meant to be called during allocations
+    std::size_t get_chunk_size() const { return chunk_size; }
+    std::size_t get_alignment() const { return alignment; }
+    std::size_t get_nb_chunks() const { return chunks.size(); }
+    std::size_t get_allocated_bytes() const { return allocated; }
+    std::size_t get_used_bytes() const {
+        std::size_t used = 0;
+        for (const Cursor &cursor : cursors) {
+            used += cursor.used;
+        }
+        return used;
+    }
+};
+
+} // namespace htool
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef HTOOL_PERMUTE_TRANSPOSE_HPP
+#define HTOOL_PERMUTE_TRANSPOSE_HPP
+
+#if _OPENMP
+#    include <omp.h>
+#endif
+
+#include "misc.hpp"
+#include <algorithm>
+#include <cstddef>
+
+namespace htool {
+
+//=================================================================//
+//                    PERMUTED TRANSPOSITIONS
+//*****************************************************************//
+// Products with mu right-hand sides take column-major panels of n rows and
+// mu columns from the user and work on row-major panels, each row holding
+// the mu coefficients of one point of the cluster numbering. These kernels
+// permute and transpose in one pass, by tiles of rows and columns so that
+// both panels stay in cache. Row j of the row-major panel is the row
+// perm[j] - perm_offset of the column-major one, or row j if perm is
+// nullptr, and coefficients are conjugated if conj is true.
+
+// Sizes of the tiles, in rows and in columns
+const int permute_transpose_tile = 32;
+
+// Smallest number of coefficients copied with several threads
+const std::size_t permute_transpose_parallel_size = std::size_t(1) << 16;
+
+// out[i + j * mu] = in[perm[j] - perm_offset + i * ldin]
+template <typename T>
+void gather_transpose(int n, int mu, const int *perm, int perm_offset, const T *const in, int ldin, T *const out, bool conj = false) {
+    int nb_tiles = (n + permute_transpose_tile - 1) / permute_transpose_tile;
+#if _OPENMP
+#    pragma omp parallel for schedule(static) if (std::size_t(n) * mu >= permute_transpose_parallel_size && !omp_in_parallel())
+#endif
+    for (int tile = 0; tile < nb_tiles; tile++) {
+        int j_begin = tile * permute_transpose_tile;
+        int j_end   = std::min(j_begin + permute_transpose_tile, n);
+        int rows[permute_transpose_tile];
+        for (int j = j_begin; j < j_end; j++) {
+            rows[j - j_begin] = perm ? perm[j] - perm_offset : j;
+        }
+        for (int i_begin = 0; i_begin < mu; i_begin += permute_transpose_tile) {
+            int i_end = std::min(i_begin + permute_transpose_tile, mu);
+            for (int j = j_begin; j < j_end; j++) {
+                const T *in_row = in + rows[j - j_begin];
+                T *out_row      = out + std::size_t(j) * mu;
+                for (int i = i_begin; i < i_end; i++) {
+                    out_row[i] = conj ? conj_if_complex(in_row[std::size_t(i) * ldin]) : in_row[std::size_t(i) * ldin];
+                }
+            }
+        }
+    }
+}
+
+// out[perm[j] - perm_offset + i * ldout] = in[i + j * mu]
+template <typename T>
+void scatter_transpose(int n, int mu, const int *perm, int perm_offset, const T *const in, T *const out, int ldout, bool conj = false) {
+    int nb_tiles = (n + permute_transpose_tile - 1) / permute_transpose_tile;
+#if _OPENMP
+#    pragma omp parallel for schedule(static) if (std::size_t(n) * mu >= permute_transpose_parallel_size && !omp_in_parallel())
+#endif
+    for (int tile = 0; tile < nb_tiles; tile++) {
+        int j_begin = tile * permute_transpose_tile;
+        int j_end   = std::min(j_begin + permute_transpose_tile, n);
+        int rows[permute_transpose_tile];
+        for (int j = j_begin; j < j_end; j++) {
+            rows[j - j_begin] = perm ? perm[j] - perm_offset : j;
+        }
+        for (int i_begin = 0; i_begin < mu; i_begin += permute_transpose_tile) {
+            int i_end = std::min(i_begin + permute_transpose_tile, mu);
+            for (int j = j_begin; j < j_end; j++) {
+                const T *in_row = in + std::size_t(j) * mu;
+                T *out_row      = out + rows[j - j_begin];
+                for (int i = i_begin; i < i_end; i++) {
+                    out_row[std::size_t(i) * ldout] = conj ? conj_if_complex(in_row[i]) : in_row[i];
+                }
+            }
+        }
+    }
+}
+
+} // namespace htool
+
+#endif
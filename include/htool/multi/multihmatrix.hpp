@@ -276,7 +276,10 @@ void MultiHMatrix<T, MultiLowRankMatrix, AdmissibleCondition>::AddNearFieldMat(M
     const VirtualCluster &t = task.get_target_cluster();
     const VirtualCluster &s = task.get_source_cluster();
 
-    MultiSubMatrix<T> Local_MultiSubMatrix(mat, std::vector<int>(cluster_tree_t->get_perm_start() + t.get_offset(), cluster_tree_t->get_perm_start() + t.get_offset() + t.get_size()), std::vector<int>(cluster_tree_s->get_perm_start() + s.get_offset(), cluster_tree_s->get_perm_start() + s.get_offset() + s.get_size()), t.get_offset(), s.get_offset());
+    // Indices are copied by the blocks
+    std::vector<int> ir(cluster_tree_t->get_perm_start() + t.get_offset(), cluster_tree_t->get_perm_start() + t.get_offset() + t.get_size());
+    std::vector<int> ic(cluster_tree_s->get_perm_start() + s.get_offset(), cluster_tree_s->get_perm_start() + s.get_offset() + s.get_size());
+    MultiSubMatrix<T> Local_MultiSubMatrix(mat, ir, ic, t.get_offset(), s.get_offset());
 
     for (int l = 0; l < nb_hmatrix; l++) {
         SubMatrix<T> *submat = new SubMatrix<T>(Local_MultiSubMatrix[l]);
@@ -292,7 +295,10 @@ bool MultiHMatrix<T, MultiLowRankMatrix, AdmissibleCondition>::AddFarFieldMat(Mu
     const VirtualCluster &t = task.get_target_cluster();
     const VirtualCluster &s = task.get_source_cluster();
 
-    MultiLowRankMatrix<T> Local_MultiLowRankMatrix(std::vector<int>(cluster_tree_t->get_perm_start() + t.get_offset(), cluster_tree_t->get_perm_start() + t.get_offset() + t.get_size()), std::vector<int>(cluster_tree_s->get_perm_start() + s.get_offset(), cluster_tree_s->get_perm_start() + s.get_offset() + s.get_size()), mat.nb_matrix(), t.get_offset(), s.get_offset(), reqrank, epsilon);
+    // Indices are copied by the blocks
+    std::vector<int> ir(cluster_tree_t->get_perm_start() + t.get_offset(), cluster_tree_t->get_perm_start() + t.get_offset() + t.get_size());
+    std::vector<int> ic(cluster_tree_s->get_perm_start() + s.get_offset(), cluster_tree_s->get_perm_start() + s.get_offset() + s.get_size());
+    MultiLowRankMatrix<T> Local_MultiLowRankMatrix(ir, ic, mat.nb_matrix(), t.get_offset(), s.get_offset(), reqrank, epsilon);
     Local_MultiLowRankMatrix.build(mat, t, xt, tabt, s, xs, tabs);
 
     if (Local_MultiLowRankMatrix.rank_of() != -1) {
@@ -0,0 +1,168 @@
+#ifndef HTOOL_TESTING_KERNEL_GENERATORS_HPP
+#define HTOOL_TESTING_KERNEL_GENERATORS_HPP
+
+#include "../types/virtual_generator.hpp"
+#include <cmath>
+#include <complex>
+#include <vector>
+
+namespace htool {
+
+//=================================================================//
+//                   SINGLE LAYER KERNEL GENERATORS
+//*****************************************************************//
+// Reference implementations of copy_submatrix for classical kernels in 3D.
+// Coordinates are stored as a structure of arrays and the coordinates of the
+// rows of a block are gathered once per call, so that the loop over the rows
+// of each column has unit stride and no function call, which lets the compiler
+// vectorize it (math functions must not set errno, with -fno-math-errno for gcc).
+// The kernels are singular for coinciding points, where 0 is returned without
+// branching: with mask = (r > 0), mask/(r + (1 - mask)) is 1/r or 0.
+template <typename T>
+class VirtualKernelGenerator : public VirtualGenerator<T> {
+  protected:
+    std::vector<double> target_x, target_y, target_z;
+    std::vector<double> source_x, source_y, source_z;
+
+    void gather_targets(int M, const int *const rows, double *x, double *y, double *z) const {
+        for (int i = 0; i < M; i++) {
+            x[i] = target_x[rows[i]];
+            y[i] = target_y[rows[i]];
+            z[i] = target_z[rows[i]];
+        }
+    }
+
+  public:
+    // xt and xs are arrays of 3D points stored contiguously, as for HMatrix::build
+    VirtualKernelGenerator(int nr, int nc, const double *const xt, const double *const xs) : VirtualGenerator<T>(nr, nc), target_x(nr), target_y(nr), target_z(nr), source_x(nc), source_y(nc), source_z(nc) {
+        for (int i = 0; i < nr; i++) {
+            target_x[i] = xt[3 * i + 0];
+            target_y[i] = xt[3 * i + 1];
+            target_z[i] = xt[3 * i + 2];
+        }
+        for (int j = 0; j < nc; j++) {
+            source_x[j] = xs[3 * j + 0];
+            source_y[j] = xs[3 * j + 1];
+            source_z[j] = xs[3 * j + 2];
+        }
+    }
+
+    // Symmetric case
+    VirtualKernelGenerator(int nr, const double *const xt) : VirtualKernelGenerator(nr, nr, xt, xt) {}
+};
+
+// G(x,y) = 1/(4 pi |x-y|)
+class LaplaceSingleLayerGenerator : public VirtualKernelGenerator<double> {
+  public:
+    using VirtualKernelGenerator<double>::VirtualKernelGenerator;
+
+    void copy_submatrix(int M, int N, const int *const rows, const int *const cols, double *ptr) const override {
+        std::vector<double> x(M), y(M), z(M);
+        this->gather_targets(M, rows, x.data(), y.data(), z.data());
+        const double *px   = x.data();
+        const double *py   = y.data();
+        const double *pz   = z.data();
+        const double coeff = 1. / (4 * M_PI);
+
+        for (int j = 0; j < N; j++) {
+            double sx   = source_x[cols[j]];
+            double sy   = source_y[cols[j]];
+            double sz   = source_z[cols[j]];
+            double *col = ptr + std::size_t(M) * j;
+#if _OPENMP
+#    pragma omp simd
+#endif
+            for (int i = 0; i < M; i++) {
+                double dx   = px[i] - sx;
+                double dy   = py[i] - sy;
+                double dz   = pz[i] - sz;
+                double r    = std::sqrt(dx * dx + dy * dy + dz * dz);
+                double mask = r > 0;
+                col[i]      = coeff * mask / (r + (1 - mask));
+            }
+        }
+    }
+};
+
+// G(x,y) = exp(-kappa |x-y|)/(4 pi |x-y|)
+class YukawaSingleLayerGenerator : public VirtualKernelGenerator<double> {
+    double kappa;
+
+  public:
+    YukawaSingleLayerGenerator(double kappa0, int nr, int nc, const double *const xt, const double *const xs) : VirtualKernelGenerator<double>(nr, nc, xt, xs), kappa(kappa0) {}
+    YukawaSingleLayerGenerator(double kappa0, int nr, const double *const xt) : VirtualKernelGenerator<double>(nr, xt), kappa(kappa0) {}
+
+    double get_kappa() const { return kappa; }
+
+    void copy_submatrix(int M, int N, const int *const rows, const int *const cols, double *ptr) const override {
+        std::vector<double> x(M), y(M), z(M);
+        this->gather_targets(M, rows, x.data(), y.data(), z.data());
+        const double *px   = x.data();
+        const double *py   = y.data();
+        const double *pz   = z.data();
+        const double coeff = 1. / (4 * M_PI);
+
+        for (int j = 0; j < N; j++) {
+            double sx   = source_x[cols[j]];
+            double sy   = source_y[cols[j]];
+            double sz   = source_z[cols[j]];
+            double *col = ptr + std::size_t(M) * j;
+#if _OPENMP
+#    pragma omp simd
+#endif
+            for (int i = 0; i < M; i++) {
+                double dx   = px[i] - sx;
+                double dy   = py[i] - sy;
+                double dz   = pz[i] - sz;
+                double r    = std::sqrt(dx * dx + dy * dy + dz * dz);
+                double mask = r > 0;
+                col[i]      = coeff * mask * std::exp(-kappa * r) / (r + (1 - mask));
+            }
+        }
+    }
+};
+
+// G(x,y) = exp(i k |x-y|)/(4 pi |x-y|)
+class HelmholtzSingleLayerGenerator : public VirtualKernelGenerator<std::complex<double>> {
+    double wavenumber;
+
+  public:
+    HelmholtzSingleLayerGenerator(double wavenumber0, int nr, int nc, const double *const xt, const double *const xs) : VirtualKernelGenerator<std::complex<double>>(nr, nc, xt, xs), wavenumber(wavenumber0) {}
+    HelmholtzSingleLayerGenerator(double wavenumber0, int nr, const double *const xt) : VirtualKernelGenerator<std::complex<double>>(nr, xt), wavenumber(wavenumber0) {}
+
+    double get_wavenumber() const { return wavenumber; }
+
+    void copy_submatrix(int M, int N, const int *const rows, const int *const cols, std::complex<double> *ptr) const override {
+        std::vector<double> x(M), y(M), z(M);
+        this->gather_targets(M, rows, x.data(), y.data(), z.data());
+        const double *px   = x.data();
+        const double *py   = y.data();
+        const double *pz   = z.data();
+        const double coeff = 1. / (4 * M_PI);
+
+        for (int j = 0; j < N; j++) {
+            double sx = source_x[cols[j]];
+            double sy = source_y[cols[j]];
+            double sz = source_z[cols[j]];
+            // std::complex<double> has the layout of double[2]
+            double *col = reinterpret_cast<double *>(ptr + std::size_t(M) * j);
+#if _OPENMP
+#    pragma omp simd
+#endif
+            for (int i = 0; i < M; i++) {
+                double dx      = px[i] - sx;
+                double dy      = py[i] - sy;
+                double dz      = pz[i] - sz;
+                double r       = std::sqrt(dx * dx + dy * dy + dz * dz);
+                double mask    = r > 0;
+                double scale   = coeff * mask / (r + (1 - mask));
+                col[2 * i]     = scale * std::cos(wavenumber * r);
+                col[2 * i + 1] = scale * std::sin(wavenumber * r);
+            }
+        }
+    }
+};
+
+} // namespace htool
+
+#endif
@@ -7,23 +7,33 @@
 
 #include "../blocks/admissibility_conditions.hpp"
 #include "../blocks/blocks.hpp"
+#include "../clustering/flat_cluster.hpp"
 #include "../clustering/virtual_cluster.hpp"
 #include "../lrmat/lrmat.hpp"
 #include "../lrmat/sympartialACA.hpp"
 #include "../lrmat/virtual_lrmat_generator.hpp"
+#include "../misc/aligned_buffer.hpp"
+#include "../misc/arena.hpp"
 #include "../misc/misc.hpp"
+#include "../misc/permute_transpose.hpp"
 #include "../types/virtual_dense_blocks_generator.hpp"
 #include "../types/virtual_generator.hpp"
 #include "../types/virtual_hmatrix.hpp"
 #include "../wrappers/wrapper_mpi.hpp"
+#include "kernel_cache.hpp"
 #include "matrix.hpp"
+#include "matvec_plan.hpp"
+#include "matvec_schedule.hpp"
 #include "point.hpp"
 #include "zero_generator.hpp"
 #include <cassert>
+#include <chrono>
 #include <fstream>
+#include <future>
 #include <map>
 #include <memory>
 #include <mpi.h>
+#include <tuple>
 
 namespace htool {
 
@@ -57,6 +67,13 @@ class HMatrix : public VirtualHMatrix<T> {
     int false_positive;
     bool use_permutation;
     bool delay_dense_computation;
+    bool use_arena;
+    bool fused_symmetric_products;
+    std::size_t fused_symmetric_products_min_bytes;
+    std::size_t arena_chunk_size;
+    int dense_blocks_batch_size;
+    std::size_t kernel_cache_budget;
+    int matvec_nb_bands;
 
     // Parameters
     double epsilon;
@@ -72,8 +89,15 @@ class HMatrix : public VirtualHMatrix<T> {
     std::shared_ptr<VirtualCluster> cluster_tree_t;
     std::shared_ptr<VirtualCluster> cluster_tree_s;
 
+    // Breadth-first copies of the cluster trees, viewed by the block tree
+    std::shared_ptr<VirtualCluster> flat_cluster_tree_t;
+    std::shared_ptr<VirtualCluster> flat_cluster_tree_s;
+
     std::unique_ptr<Block> BlockTree;
 
+    // Storage of the block payloads when use_arena is true, declared before the blocks viewing it
+    std::unique_ptr<Arena> arena;
+
     std::vector<std::unique_ptr<IMatrix<T>>> MyComputedBlocks;
     std::vector<LowRankMatrix<T> *> MyFarFieldMats;
     std::vector<SubMatrix<T> *> MyNearFieldMats;
@@ -90,14 +114,181 @@ class HMatrix : public VirtualHMatrix<T> {
     const MPI_Comm comm;
     int rankWorld, sizeWorld;
 
+    // Assembly load balance
+    std::vector<double> thread_busy_time;
+    double blocks_wall_time;
+
+    // Rows and columns served by the kernel cache during the compression
+    std::size_t kernel_cache_hits, kernel_cache_misses;
+
+    // Frozen layout: the blocks of the products with the same rows are stored contiguously in packed_storage,
+    // with the U of their low-rank blocks side by side so that they are applied by one product
+    struct PackedRow {
+        int offset_i;
+        int nb_rows;
+        int rank; // sum of the ranks of lrmats
+        T *U;     // nb_rows x rank
+        double cost;
+        bool local_source; // all the blocks only need the local part of the source
+        std::vector<LowRankMatrix<T> *> lrmats;
+        std::vector<SubMatrix<T> *> dense_blocks;
+    };
+    bool frozen_layout;
+    std::vector<PackedRow> packed_rows;
+    AlignedBuffer<T> packed_storage;
+
+    // Owner-computes schedules of the products, items of local_matvec_schedule and matvec_schedule are
+    // ('N', b): MyComputedBlocks[b], ('S', b): transpose of MyDiagComputedBlocks[b], ('D', b): MyStrictlyDiagNearFieldMats[b] with symmetry,
+    // ('F', b): MyDiagComputedBlocks[b] and its transpose, replacing its items 'N' and 'S' when is_fused_block,
+    // and ('P', r): packed_rows[r] replacing the items 'N' with a frozen layout, items of transp_matvec_schedule are ('N', b).
+    // Items of local_matvec_schedule only need the local part of the source, so that they are computed while the rest is gathered
+    struct MatvecItem {
+        char type;
+        int index;
+        const LowRankMatrix<T> *lrmat; // nullptr if the block is dense
+    };
+    std::vector<MatvecItem> local_matvec_items, matvec_items, transp_matvec_items;
+    MatvecSchedule local_matvec_schedule, matvec_schedule, transp_matvec_schedule;
+    int matvec_max_rank;
+
+    // Halo of the products: intervals of the source needed by the blocks of matvec_schedule, received from
+    // the process owning them, and intervals of the local part of the source needed by the other processes
+    struct HaloInterval {
+        int rank;
+        int offset;
+        int size;
+    };
+    std::vector<HaloInterval> halo_recvs, halo_sends;
+
+    mutable int nb_mat_vec_prod;
+    mutable double total_time_mat_vec_prod;
+
+    // Blocks assembled by one task, merged into its parent
+    struct LocalBlocks {
+        std::vector<std::unique_ptr<IMatrix<T>>> ComputedBlocks;
+        std::vector<SubMatrix<T> *> NearFieldMats;
+        std::vector<LowRankMatrix<T> *> FarFieldMats;
+        std::vector<IMatrix<T> *> DiagComputedBlocks;
+        std::vector<SubMatrix<T> *> DiagNearFieldMats;
+        std::vector<LowRankMatrix<T> *> DiagFarFieldMats;
+        std::vector<SubMatrix<T> *> StrictlyDiagNearFieldMats;
+        std::vector<LowRankMatrix<T> *> StrictlyDiagFarFieldMats;
+        int false_positive = 0;
+
+        void append(LocalBlocks &other) {
+            ComputedBlocks.insert(ComputedBlocks.end(), std::make_move_iterator(other.ComputedBlocks.begin()), std::make_move_iterator(other.ComputedBlocks.end()));
+            NearFieldMats.insert(NearFieldMats.end(), other.NearFieldMats.begin(), other.NearFieldMats.end());
+            FarFieldMats.insert(FarFieldMats.end(), other.FarFieldMats.begin(), other.FarFieldMats.end());
+        }
+
+        // Diagonal blocks are the ones whose source cluster is in the local part of the source tree
+        void classify(int local_offset_s, int local_size_s) {
+            auto is_diag = [&](const IMatrix<T> *block) { return local_offset_s <= block->get_offset_j() && block->get_offset_j() < local_offset_s + local_size_s; };
+            for (int i = 0; i < ComputedBlocks.size(); i++) {
+                if (is_diag(ComputedBlocks[i].get()))
+                    DiagComputedBlocks.push_back(ComputedBlocks[i].get());
+            }
+            for (int i = 0; i < FarFieldMats.size(); i++) {
+                if (is_diag(FarFieldMats[i])) {
+                    DiagFarFieldMats.push_back(FarFieldMats[i]);
+                    if (FarFieldMats[i]->get_offset_j() == FarFieldMats[i]->get_offset_i())
+                        StrictlyDiagFarFieldMats.push_back(FarFieldMats[i]);
+                }
+            }
+            for (int i = 0; i < NearFieldMats.size(); i++) {
+                if (is_diag(NearFieldMats[i])) {
+                    DiagNearFieldMats.push_back(NearFieldMats[i]);
+                    if (NearFieldMats[i]->get_offset_j() == NearFieldMats[i]->get_offset_i())
+                        StrictlyDiagNearFieldMats.push_back(NearFieldMats[i]);
+                }
+            }
+        }
+    };
+
+    // Appends the lists of every task in task order, positions are given by a prefix sum so that tasks are moved concurrently
+    template <typename U>
+    static void merge_local_blocks(std::vector<LocalBlocks> &tasks_blocks, std::vector<U> LocalBlocks::*list, std::vector<U> &result) {
+        std::vector<std::size_t> offsets(tasks_blocks.size() + 1, result.size());
+        for (int p = 0; p < tasks_blocks.size(); p++) {
+            offsets[p + 1] = offsets[p] + (tasks_blocks[p].*list).size();
+        }
+        result.resize(offsets.back());
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp parallel for schedule(static)
+#endif
+        for (int p = 0; p < tasks_blocks.size(); p++) {
+            std::move((tasks_blocks[p].*list).begin(), (tasks_blocks[p].*list).end(), result.begin() + offsets[p]);
+        }
+    }
+
     // Internal methods
     void ComputeBlocks(VirtualGenerator<T> &mat, const double *const xt, const double *const xs);
-    void ComputeSymBlocks(VirtualGenerator<T> &mat, const double *const xt, const double *const xs);
-    bool ComputeAdmissibleBlock(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, std::vector<std::unique_ptr<IMatrix<T>>> &MyComputedBlocks_local, std::vector<SubMatrix<T> *> &, std::vector<LowRankMatrix<T> *> &, int &);
-    bool ComputeAdmissibleBlocksSym(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, std::vector<std::unique_ptr<IMatrix<T>>> &MyComputedBlocks_local, std::vector<SubMatrix<T> *> &, std::vector<LowRankMatrix<T> *> &, int &);
-    void AddNearFieldMat(VirtualGenerator<T> &mat, Block &task, std::vector<std::unique_ptr<IMatrix<T>>> &, std::vector<SubMatrix<T> *> &);
-    void AddFarFieldMat(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, std::vector<std::unique_ptr<IMatrix<T>>> &, std::vector<LowRankMatrix<T> *> &, const int &reqrank = -1);
+    bool ComputeAdmissibleBlock(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, LocalBlocks &local_blocks);
+    void AddNearFieldMat(VirtualGenerator<T> &mat, Block &task, LocalBlocks &local_blocks);
+    void ComputeDenseBlocks(VirtualGenerator<T> &mat, std::size_t first_block = 0);
+    bool AddFarFieldMat(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, LocalBlocks &local_blocks, const int &reqrank = -1);
+    void ComputeMatvecSchedules();
+    void ComputeMatvecHalo();
+    // Blocks of the local diagonal part applied with their transpose by items 'F', when the coefficients read once instead of twice,
+    // the ones of U for a low-rank block, are enough to pay off
+    bool is_fused_block(const IMatrix<T> &block) const {
+        int local_offset_s = cluster_tree_s->get_masteroffset(rankWorld).first;
+        int local_size_s   = cluster_tree_s->get_masteroffset(rankWorld).second;
+        if (symmetry == 'N' || !fused_symmetric_products || block.get_offset_i() == block.get_offset_j() || block.get_offset_j() < local_offset_s || block.get_offset_j() >= local_offset_s + local_size_s) {
+            return false;
+        }
+        const LowRankMatrix<T> *lrmat = dynamic_cast<const LowRankMatrix<T> *>(&block);
+        return std::size_t(block.nb_rows()) * (lrmat ? lrmat->rank_of() : block.nb_cols()) * sizeof(T) >= fused_symmetric_products_min_bytes;
+    }
+    // Product by a block of the schedules, low-rank blocks use the scratch of the plan when there is one
+    static void add_item_mvprod(const IMatrix<T> &M, const LowRankMatrix<T> *lrmat, T *lrmat_work, const T *const in, T *const out, int mu, char transb, char op) {
+        if (lrmat != nullptr && lrmat_work != nullptr) {
+            lrmat->add_mvprod_row_major(in, out, mu, transb, op, lrmat_work);
+        } else {
+            M.add_mvprod_row_major(in, out, mu, transb, op);
+        }
+    }
+    // Item 'F' with one right-hand side, the scratch holds 2*rank coefficients
+    static void add_item_mvprod_and_transp(const IMatrix<T> &M, const LowRankMatrix<T> *lrmat, T *lrmat_work, const T *const in_c, T *const out_r, const T *const in_r, T *const out_c, char op) {
+        if (lrmat != nullptr && lrmat_work != nullptr) {
+            lrmat->add_mvprod_and_transp(in_c, out_r, in_r, out_c, op, lrmat_work);
+        } else {
+            M.add_mvprod_and_transp(in_c, out_r, in_r, out_c, op);
+        }
+    }
+    void add_packed_row_mvprod(const PackedRow &row, T *lrmat_work, const T *const in, int in_offset, T *const out, int mu, char transb) const;
+    // Products by the items of a forward schedule, in holds the source from the column in_offset
+    void run_matvec_items(const MatvecSchedule &schedule, const std::vector<MatvecItem> &items, const T *const in, int in_offset, T *const out, MatvecPlan<T> &plan) const;
+    // Same with column-major panels, rows of the source are the ones of in from in_offset
+    static void add_item_mvprod_col_major(const IMatrix<T> &M, const LowRankMatrix<T> *lrmat, T *lrmat_work, const T *const in, int ldin, T *const out, int ldout, int mu, char op) {
+        if (lrmat != nullptr && lrmat_work != nullptr) {
+            lrmat->add_mvprod_col_major(in, ldin, out, ldout, mu, op, lrmat_work);
+        } else {
+            M.add_mvprod_col_major(in, ldin, out, ldout, mu, op);
+        }
+    }
+    void add_packed_row_mvprod_col_major(const PackedRow &row, T *lrmat_work, const T *const in, int in_offset, int ldin, T *const out, int ldout, int mu) const;
+    void run_matvec_items_col_major(const MatvecSchedule &schedule, const std::vector<MatvecItem> &items, const T *const in, int in_offset, int ldin, T *const out, int ldout, MatvecPlan<T> &plan) const;
+    // Posts the exchange of the halo of the source in work, completed by the requests of the plan
+    int post_halo_exchange(const T *const in, T *work, MatvecPlan<T> &plan) const;
+    void add_mat_vec_prod_time(double time) const {
+        nb_mat_vec_prod++;
+        total_time_mat_vec_prod += time;
+    }
+    void update_mat_vec_prod_infos() const {
+        if (nb_mat_vec_prod > 0) {
+            infos["nb_mat_vec_prod"]         = NbrToStr(nb_mat_vec_prod);
+            infos["total_time_mat_vec_prod"] = NbrToStr(total_time_mat_vec_prod);
+        }
+    }
     void ComputeInfos(const std::vector<double> &mytimes);
+    void add_busy_time(double time) {
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+        thread_busy_time[omp_get_thread_num()] += time;
+#else
+        thread_busy_time[0] += time;
+#endif
+    }
 
     // Check arguments
     void check_arguments(VirtualGenerator<T> &mat, const std::vector<R3> &xt, const std::vector<R3> &xs) const;
@@ -109,10 +300,10 @@ class HMatrix : public VirtualHMatrix<T> {
   public:
     // Special constructor for hand-made build (for MultiHMatrix for example)
 
-    HMatrix(int space_dim0, int nr0, int nc0, const std::shared_ptr<VirtualCluster> &cluster_tree_t0, const std::shared_ptr<VirtualCluster> &cluster_tree_s0, char symmetry0 = 'N', char UPLO = 'N', const MPI_Comm comm0 = MPI_COMM_WORLD) : nr(nr0), nc(nc0), space_dim(space_dim0), symmetry(symmetry0), UPLO(UPLO), use_permutation(true), delay_dense_computation(false), cluster_tree_t(cluster_tree_t0), cluster_tree_s(cluster_tree_s0), comm(comm0){};
+    HMatrix(int space_dim0, int nr0, int nc0, const std::shared_ptr<VirtualCluster> &cluster_tree_t0, const std::shared_ptr<VirtualCluster> &cluster_tree_s0, char symmetry0 = 'N', char UPLO = 'N', const MPI_Comm comm0 = MPI_COMM_WORLD) : nr(nr0), nc(nc0), space_dim(space_dim0), symmetry(symmetry0), UPLO(UPLO), use_permutation(true), delay_dense_computation(false), use_arena(false), fused_symmetric_products(false), fused_symmetric_products_min_bytes(0), arena_chunk_size(std::size_t(1) << 22), dense_blocks_batch_size(16), kernel_cache_budget(0), matvec_nb_bands(32), cluster_tree_t(cluster_tree_t0), cluster_tree_s(cluster_tree_s0), comm(comm0), kernel_cache_hits(0), kernel_cache_misses(0), frozen_layout(false), matvec_max_rank(0), nb_mat_vec_prod(0), total_time_mat_vec_prod(0){};
 
     // Constructor
-    HMatrix(const std::shared_ptr<VirtualCluster> &cluster_tree_t0, const std::shared_ptr<VirtualCluster> &cluster_tree_s0, double epsilon0 = 1e-6, double eta0 = 10, char Symmetry = 'N', char UPLO = 'N', const int &reqrank0 = -1, const MPI_Comm comm0 = MPI_COMM_WORLD) : nr(0), nc(0), space_dim(cluster_tree_t0->get_space_dim()), dimension(1), reqrank(reqrank0), local_size(0), local_offset(0), symmetry(Symmetry), UPLO(UPLO), false_positive(0), use_permutation(true), delay_dense_computation(false), epsilon(epsilon0), eta(eta0), maxblocksize(1e6), minsourcedepth(0), mintargetdepth(0), cluster_tree_t(cluster_tree_t0), cluster_tree_s(cluster_tree_s0), comm(comm0) {
+    HMatrix(const std::shared_ptr<VirtualCluster> &cluster_tree_t0, const std::shared_ptr<VirtualCluster> &cluster_tree_s0, double epsilon0 = 1e-6, double eta0 = 10, char Symmetry = 'N', char UPLO = 'N', const int &reqrank0 = -1, const MPI_Comm comm0 = MPI_COMM_WORLD) : nr(0), nc(0), space_dim(cluster_tree_t0->get_space_dim()), dimension(1), reqrank(reqrank0), local_size(0), local_offset(0), symmetry(Symmetry), UPLO(UPLO), false_positive(0), use_permutation(true), delay_dense_computation(false), use_arena(false), fused_symmetric_products(false), fused_symmetric_products_min_bytes(0), arena_chunk_size(std::size_t(1) << 22), dense_blocks_batch_size(16), kernel_cache_budget(0), matvec_nb_bands(32), epsilon(epsilon0), eta(eta0), maxblocksize(1e6), minsourcedepth(0), mintargetdepth(0), cluster_tree_t(cluster_tree_t0), cluster_tree_s(cluster_tree_s0), comm(comm0), kernel_cache_hits(0), kernel_cache_misses(0), frozen_layout(false), matvec_max_rank(0), nb_mat_vec_prod(0), total_time_mat_vec_prod(0) {
         if (!((symmetry == 'N' || symmetry == 'H' || symmetry == 'S')
               && (UPLO == 'N' || UPLO == 'L' || UPLO == 'U')
               && ((symmetry == 'N' && UPLO == 'N') || (symmetry != 'N' && UPLO != 'N'))
@@ -203,6 +394,8 @@ class HMatrix : public VirtualHMatrix<T> {
     void copy_local_interaction(T *, bool = true) const;
     void copy_local_diagonal_block(T *, bool = true) const;
     std::pair<int, int> get_max_size_blocks() const;
+    std::size_t get_arena_bytes() const { return arena ? arena->get_allocated_bytes() : 0; }
+    std::size_t get_payload_bytes() const;
 
     double get_epsilon() const { return this->epsilon; };
     double get_eta() const { return this->eta; };
@@ -217,11 +410,61 @@ class HMatrix : public VirtualHMatrix<T> {
     void set_maxblocksize(unsigned int maxblocksize0) { this->maxblocksize = maxblocksize0; };
     void set_use_permutation(bool choice) { this->use_permutation = choice; };
     void set_delay_dense_computation(bool choice) { this->delay_dense_computation = choice; };
+    void set_use_arena(bool choice) { this->use_arena = choice; };
+    void set_arena_chunk_size(std::size_t chunk_size) { this->arena_chunk_size = chunk_size; };
+    bool get_use_arena() const { return this->use_arena; };
+    std::size_t get_arena_chunk_size() const { return this->arena_chunk_size; };
+    void set_dense_blocks_batch_size(int batch_size) {
+        if (batch_size < 1) {
+            throw std::invalid_argument("[Htool error] Batch size of dense blocks must be positive"); // LCOV_EXCL_LINE
+        }
+        this->dense_blocks_batch_size = batch_size;
+    };
+    int get_dense_blocks_batch_size() const { return this->dense_blocks_batch_size; };
+    // Maximum number of bytes of kernel rows and columns kept during the compression, 0 disables the cache
+    void set_kernel_cache_budget(std::size_t budget) { this->kernel_cache_budget = budget; };
+    std::size_t get_kernel_cache_budget() const { return this->kernel_cache_budget; };
+    std::size_t get_kernel_cache_hits() const { return this->kernel_cache_hits; };
+    std::size_t get_kernel_cache_misses() const { return this->kernel_cache_misses; };
     void set_compression(std::shared_ptr<VirtualLowRankGenerator<T>> ptr) { LowRankGenerator = ptr; };
+    // Symmetric products apply the blocks of the local diagonal part with their transpose in one pass for one right-hand side,
+    // blocks saving less than min_bytes of reads are left to two products. Fused blocks are not packed by freeze_layout.
+    void set_fused_symmetric_products(bool choice, std::size_t min_bytes = 0) {
+        if (frozen_layout) {
+            throw std::logic_error("[Htool error] Fused symmetric products cannot be changed once the layout is frozen"); // LCOV_EXCL_LINE
+        }
+        this->fused_symmetric_products           = choice;
+        this->fused_symmetric_products_min_bytes = min_bytes;
+        if (!MyComputedBlocks.empty()) {
+            ComputeMatvecSchedules();
+        }
+    };
+    bool get_fused_symmetric_products() const { return this->fused_symmetric_products; };
+    // Outputs of the products are split in about nb_bands bands, each computed by one thread. It does not depend on the number of threads, so that neither do the results
+    void set_matvec_nb_bands(int nb_bands) {
+        if (nb_bands < 1) {
+            throw std::invalid_argument("[Htool error] Number of bands of the products must be positive"); // LCOV_EXCL_LINE
+        }
+        this->matvec_nb_bands = nb_bands;
+        if (!MyComputedBlocks.empty()) {
+            ComputeMatvecSchedules();
+        }
+    };
+    int get_matvec_nb_bands() const { return this->matvec_nb_bands; };
+    // Packs the blocks after the build, see PackedRow, plans created before have to be recreated
+    void freeze_layout();
+    bool get_frozen_layout() const { return this->frozen_layout; };
+    std::size_t get_frozen_layout_bytes() const { return this->packed_storage.get_capacity() * sizeof(T); };
 
     // Infos
-    const std::map<std::string, std::string> &get_infos() const { return infos; }
-    std::string get_infos(const std::string &key) const { return infos[key]; }
+    const std::map<std::string, std::string> &get_infos() const {
+        update_mat_vec_prod_infos();
+        return infos;
+    }
+    std::string get_infos(const std::string &key) const {
+        update_mat_vec_prod_infos();
+        return infos[key];
+    }
     void add_info(const std::string &keyname, const std::string &value) const { infos[keyname] = value; }
     void print_infos() const;
     void save_infos(const std::string &outputname, std::ios_base::openmode mode = std::ios_base::app, const std::string &sep = " = ") const;
@@ -230,17 +473,99 @@ class HMatrix : public VirtualHMatrix<T> {
     double space_saving() const;
     friend underlying_type<T> Frobenius_absolute_error<T>(const HMatrix<T> &B, const VirtualGenerator<T> &A);
 
-    // Mat vec prod
-    void mvprod_global_to_global(const T *const in, T *const out, const int &mu = 1) const;
-    void mvprod_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const;
+    // Mat vec prod, products without plan create one for each call, give a plan to reuse its buffers
+    void mvprod_global_to_global(const T *const in, T *const out, const int &mu = 1) const { MatvecPlan<T> plan = create_matvec_plan(mu); mvprod_global_to_global(in, out, plan); }
+    void mvprod_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const { MatvecPlan<T> plan = create_matvec_plan(mu); mvprod_local_to_local(in, out, plan, work); }
+
+    void mvprod_transp_global_to_global(const T *const in, T *const out, const int &mu = 1) const { MatvecPlan<T> plan = create_matvec_plan(mu); mvprod_transp_global_to_global(in, out, plan); }
+    void mvprod_transp_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const { MatvecPlan<T> plan = create_matvec_plan(mu); mvprod_transp_local_to_local(in, out, plan, work); }
+
+    void mymvprod_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const { MatvecPlan<T> plan = create_matvec_plan(mu); mymvprod_local_to_local(in, out, plan, work); }
+    void mymvprod_global_to_local(const T *const in, T *const out, const int &mu = 1) const { MatvecPlan<T> plan = create_matvec_plan(mu); mymvprod_global_to_local(in, out, plan); }
+    void mymvprod_transp_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const { MatvecPlan<T> plan = create_matvec_plan(mu); mymvprod_transp_local_to_local(in, out, plan, work); }
+    void mymvprod_transp_local_to_global(const T *const in, T *const out, const int &mu = 1) const { MatvecPlan<T> plan = create_matvec_plan(mu); mymvprod_transp_local_to_global(in, out, plan); }
+
+    void mvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu = 1) const { MatvecPlan<T> plan = create_matvec_plan(mu); mvprod_local_to_local_col_major(in, ldin, out, ldout, plan); }
+    void mymvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu = 1) const { MatvecPlan<T> plan = create_matvec_plan(mu); mymvprod_local_to_local_col_major(in, ldin, out, ldout, plan); }
+
+    // Mat vec prod with a plan created by create_matvec_plan, which gives mu and the buffers, work is used instead of the buffer of the plan if given
+    MatvecPlan<T> create_matvec_plan(int mu) const;
+    void mvprod_global_to_global(const T *const in, T *const out, MatvecPlan<T> &plan) const;
+    void mvprod_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work = nullptr) const;
+
+    void mvprod_transp_global_to_global(const T *const in, T *const out, MatvecPlan<T> &plan) const;
+    void mvprod_transp_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work = nullptr) const;
+
+    void mymvprod_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work = nullptr) const;
+    void mymvprod_global_to_local(const T *const in, T *const out, MatvecPlan<T> &plan) const;
+    void mymvprod_transp_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work = nullptr) const;
+    void mymvprod_transp_local_to_global(const T *const in, T *const out, MatvecPlan<T> &plan) const;
+
+    // Mat vec prod with column-major panels of mu columns and leading dimensions ldin and ldout, without transposition
+    void mvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, MatvecPlan<T> &plan) const;
+    void mymvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, MatvecPlan<T> &plan) const;
+
+    // Product started by mvprod_async, completed by test, wait or the destructor. The output and the plan are in use until then
+    class MatvecRequest {
+        friend class HMatrix;
+        const HMatrix *hmatrix; // nullptr once completed
+        MatvecPlan<T> *plan;
+        T *out;
+        T *out_perm;
+        T *work;
+        int nb_requests;
+        double time;
+        std::future<void> local_products;
+
+        // Blocks needing the halo and permutation of the output
+        void finish();
+
+      public:
+        MatvecRequest() : hmatrix(nullptr), plan(nullptr), out(nullptr), out_perm(nullptr), work(nullptr), nb_requests(0), time(0) {}
+        MatvecRequest(const MatvecRequest &) = delete;
+        MatvecRequest &operator=(const MatvecRequest &) = delete;
+        MatvecRequest(MatvecRequest &&other) : hmatrix(other.hmatrix), plan(other.plan), out(other.out), out_perm(other.out_perm), work(other.work), nb_requests(other.nb_requests), time(other.time), local_products(std::move(other.local_products)) { other.hmatrix = nullptr; }
+        MatvecRequest &operator=(MatvecRequest &&other) {
+            if (this != &other) {
+                wait();
+                hmatrix        = other.hmatrix;
+                plan           = other.plan;
+                out            = other.out;
+                out_perm       = other.out_perm;
+                work           = other.work;
+                nb_requests    = other.nb_requests;
+                time           = other.time;
+                local_products = std::move(other.local_products);
+                other.hmatrix  = nullptr;
+            }
+            return *this;
+        }
+        ~MatvecRequest() { wait(); }
 
-    void mvprod_transp_global_to_global(const T *const in, T *const out, const int &mu = 1) const;
-    void mvprod_transp_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const;
+        // Completes the product if the halo is received and the local blocks are computed, returns whether it is completed
+        bool test() {
+            if (hmatrix == nullptr) {
+                return true;
+            }
+            int flag = 0;
+            MPI_Testall(nb_requests, plan->get_requests(nb_requests), &flag, MPI_STATUSES_IGNORE);
+            if (!flag || local_products.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                return false;
+            }
+            finish();
+            return true;
+        }
+        void wait() {
+            if (hmatrix != nullptr) {
+                finish();
+            }
+        }
+    };
 
-    void mymvprod_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const;
-    void mymvprod_global_to_local(const T *const in, T *const out, const int &mu = 1) const;
-    void mymvprod_transp_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const;
-    void mymvprod_transp_local_to_global(const T *const in, T *const out, const int &mu = 1) const;
+    // Starts mvprod_local_to_local and returns while the blocks that only need the local part of the source are computed by
+    // a thread team of their own and the halo is exchanged, the other blocks are computed when the request is completed.
+    // in can be reused once it returns, MPI is only called by the calling thread
+    MatvecRequest mvprod_async(const T *const in, T *const out, MatvecPlan<T> &plan) const;
 
     void mvprod_subrhs(const T *const in, T *const out, const int &mu, const int &offset, const int &size, const int &margin) const;
     std::vector<T> operator*(const std::vector<T> &x) const;
@@ -322,7 +647,9 @@ void HMatrix<T>::build(VirtualGenerator<T> &mat, const double *const xt, const d
 
     // Construction arbre des blocs
     double time = MPI_Wtime();
-    this->BlockTree.reset(new Block(this->AdmissibilityCondition.get(), *cluster_tree_t, *cluster_tree_s));
+    this->flat_cluster_tree_t = std::make_shared<FlatCluster>(*cluster_tree_t);
+    this->flat_cluster_tree_s = (cluster_tree_s == cluster_tree_t) ? flat_cluster_tree_t : std::make_shared<FlatCluster>(*cluster_tree_s);
+    this->BlockTree.reset(new Block(this->AdmissibilityCondition.get(), *flat_cluster_tree_t, *flat_cluster_tree_s));
     this->BlockTree->set_mintargetdepth(this->mintargetdepth);
     this->BlockTree->set_minsourcedepth(this->minsourcedepth);
     this->BlockTree->set_maxblocksize(this->maxblocksize);
@@ -382,7 +709,9 @@ void HMatrix<T>::build(VirtualGenerator<T> &mat, const double *const xt) {
     // Construction arbre des blocs
     double time = MPI_Wtime();
 
-    this->BlockTree.reset(new Block(this->AdmissibilityCondition.get(), *cluster_tree_t, *cluster_tree_s));
+    this->flat_cluster_tree_t = std::make_shared<FlatCluster>(*cluster_tree_t);
+    this->flat_cluster_tree_s = (cluster_tree_s == cluster_tree_t) ? flat_cluster_tree_t : std::make_shared<FlatCluster>(*cluster_tree_s);
+    this->BlockTree.reset(new Block(this->AdmissibilityCondition.get(), *flat_cluster_tree_t, *flat_cluster_tree_s));
     this->BlockTree->set_mintargetdepth(this->mintargetdepth);
     this->BlockTree->set_minsourcedepth(this->minsourcedepth);
     this->BlockTree->set_maxblocksize(this->maxblocksize);
@@ -418,103 +747,104 @@ void HMatrix<T>::build_dense_blocks(VirtualDenseBlocksGenerator<T> &dense_block_
 }
 
 // Compute blocks recursively
-// TODO: recursivity -> stack for compute blocks
 template <typename T>
 void HMatrix<T>::ComputeBlocks(VirtualGenerator<T> &mat, const double *const xt, const double *const xs) {
-#if _OPENMP && !defined(PYTHON_INTERFACE)
-#    pragma omp parallel
-#endif
-    {
-        std::vector<SubMatrix<T> *> MyNearFieldMats_local;
-        std::vector<LowRankMatrix<T> *> MyFarFieldMats_local;
-        std::vector<std::unique_ptr<IMatrix<T>>> MyComputedBlocks_local;
-        std::vector<Block *> local_tasks = BlockTree->get_local_tasks();
+    std::vector<Block *> local_tasks = BlockTree->get_local_tasks();
 
-        int false_positive_local = 0;
-#if _OPENMP && !defined(PYTHON_INTERFACE)
-#    pragma omp for schedule(guided)
-#endif
-        for (int p = 0; p < local_tasks.size(); p++) {
-            if (!local_tasks[p]->IsAdmissible()) {
-                AddNearFieldMat(mat, *(local_tasks[p]), MyComputedBlocks_local, MyNearFieldMats_local);
-            } else {
-                bool not_pushed;
-                if (symmetry == 'H' || symmetry == 'S') {
-                    not_pushed = ComputeAdmissibleBlocksSym(mat, *(local_tasks[p]), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-                } else {
-                    not_pushed = ComputeAdmissibleBlock(mat, *(local_tasks[p]), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-                }
+    // Largest blocks are spawned first so that small ones fill the gaps at the end
+    std::vector<int> task_order(local_tasks.size());
+    std::iota(task_order.begin(), task_order.end(), int(0));
+    std::stable_sort(task_order.begin(), task_order.end(), [&local_tasks](int a, int b) {
+        return local_tasks[a]->get_size() > local_tasks[b]->get_size();
+    });
 
-                if (not_pushed) {
-                    AddNearFieldMat(mat, *(local_tasks[p]), MyComputedBlocks_local, MyNearFieldMats_local);
-                }
-            }
-        }
 #if _OPENMP && !defined(PYTHON_INTERFACE)
-#    pragma omp critical
+    thread_busy_time.assign(omp_get_max_threads(), 0);
+#else
+    thread_busy_time.assign(1, 0);
 #endif
-        {
-            MyComputedBlocks.insert(MyComputedBlocks.end(), std::make_move_iterator(MyComputedBlocks_local.begin()), std::make_move_iterator(MyComputedBlocks_local.end()));
-
-            MyFarFieldMats.insert(MyFarFieldMats.end(), std::make_move_iterator(MyFarFieldMats_local.begin()), std::make_move_iterator(MyFarFieldMats_local.end()));
 
-            MyNearFieldMats.insert(MyNearFieldMats.end(), std::make_move_iterator(MyNearFieldMats_local.begin()), std::make_move_iterator(MyNearFieldMats_local.end()));
+    if (use_arena && arena == nullptr) {
+        arena.reset(new Arena(arena_chunk_size));
+    }
 
-            false_positive += false_positive_local;
-        }
+    // Rows and columns computed by the compressors are kept to be reused by the sons of false positives
+    std::unique_ptr<KernelCache<T>> kernel_cache;
+    if (kernel_cache_budget > 0) {
+        const int *perm_t = use_permutation ? cluster_tree_t->get_perm().data() : no_permutation_target.data();
+        const int *perm_s = use_permutation ? cluster_tree_s->get_perm().data() : no_permutation_source.data();
+        kernel_cache.reset(new KernelCache<T>(mat, kernel_cache_budget, *cluster_tree_t, perm_t, *cluster_tree_s, perm_s));
     }
+    VirtualGenerator<T> &compression_generator = kernel_cache ? *kernel_cache : mat;
 
+    // Each task collects its blocks in its own buffers so that the final ordering only depends on local_tasks
+    std::vector<LocalBlocks> tasks_blocks(local_tasks.size());
     int local_offset_s = cluster_tree_s->get_local_offset();
     int local_size_s   = cluster_tree_s->get_local_size();
 
-    // Build vectors of pointers for diagonal blocks
-    for (int i = 0; i < MyComputedBlocks.size(); i++) {
-        if (local_offset_s <= MyComputedBlocks[i]->get_offset_j() && MyComputedBlocks[i]->get_offset_j() < local_offset_s + local_size_s) {
-            MyDiagComputedBlocks.push_back(MyComputedBlocks[i].get());
-            // if (MyComputedBlocks[i]->get_offset_j() == MyComputedBlocks[i]->get_offset_i())
-            //     MyStrictlyDiagFarFieldMats.push_back(MyComputedBlocks[i]);
+    double time = MPI_Wtime();
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp parallel
+#    pragma omp single
+#endif
+    {
+        for (int q = 0; q < task_order.size(); q++) {
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp task default(shared) firstprivate(q)
+#endif
+            {
+                Block &task               = *(local_tasks[task_order[q]]);
+                LocalBlocks &local_blocks = tasks_blocks[task_order[q]];
+                if (!task.IsAdmissible()) {
+                    AddNearFieldMat(mat, task, local_blocks);
+                } else if (ComputeAdmissibleBlock(compression_generator, task, xt, xs, local_blocks)) {
+                    AddNearFieldMat(mat, task, local_blocks);
+                }
+                local_blocks.classify(local_offset_s, local_size_s);
+            }
         }
     }
 
-    for (int i = 0; i < MyFarFieldMats.size(); i++) {
-        if (local_offset_s <= MyFarFieldMats[i]->get_offset_j() && MyFarFieldMats[i]->get_offset_j() < local_offset_s + local_size_s) {
-            MyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
-            if (MyFarFieldMats[i]->get_offset_j() == MyFarFieldMats[i]->get_offset_i())
-                MyStrictlyDiagFarFieldMats.push_back(MyFarFieldMats[i]);
-        }
+    // Concatenation in task order
+    std::size_t nb_near_field_mats = MyNearFieldMats.size();
+    merge_local_blocks(tasks_blocks, &LocalBlocks::ComputedBlocks, MyComputedBlocks);
+    merge_local_blocks(tasks_blocks, &LocalBlocks::FarFieldMats, MyFarFieldMats);
+    merge_local_blocks(tasks_blocks, &LocalBlocks::NearFieldMats, MyNearFieldMats);
+    merge_local_blocks(tasks_blocks, &LocalBlocks::DiagComputedBlocks, MyDiagComputedBlocks);
+    merge_local_blocks(tasks_blocks, &LocalBlocks::DiagFarFieldMats, MyDiagFarFieldMats);
+    merge_local_blocks(tasks_blocks, &LocalBlocks::DiagNearFieldMats, MyDiagNearFieldMats);
+    merge_local_blocks(tasks_blocks, &LocalBlocks::StrictlyDiagFarFieldMats, MyStrictlyDiagFarFieldMats);
+    merge_local_blocks(tasks_blocks, &LocalBlocks::StrictlyDiagNearFieldMats, MyStrictlyDiagNearFieldMats);
+
+    // Near field blocks have only been allocated so far
+    ComputeDenseBlocks(mat, nb_near_field_mats);
+    blocks_wall_time = MPI_Wtime() - time;
+
+    for (int p = 0; p < tasks_blocks.size(); p++) {
+        false_positive += tasks_blocks[p].false_positive;
     }
-    for (int i = 0; i < MyNearFieldMats.size(); i++) {
-        if (local_offset_s <= MyNearFieldMats[i]->get_offset_j() && MyNearFieldMats[i]->get_offset_j() < local_offset_s + local_size_s) {
-            MyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
-            if (MyNearFieldMats[i]->get_offset_j() == MyNearFieldMats[i]->get_offset_i())
-                MyStrictlyDiagNearFieldMats.push_back(MyNearFieldMats[i]);
-        }
+    if (kernel_cache) {
+        kernel_cache_hits += kernel_cache->get_hits();
+        kernel_cache_misses += kernel_cache->get_misses();
     }
 
-    std::sort(MyComputedBlocks.begin(), MyComputedBlocks.end(), [](const std::unique_ptr<IMatrix<T>> &a, const std::unique_ptr<IMatrix<T>> &b) {
-        if (a->get_offset_i() == b->get_offset_i()) {
-            return a->get_offset_j() < b->get_offset_j();
-        } else {
-            return a->get_offset_i() < b->get_offset_i();
-        }
-    });
+    ComputeMatvecSchedules();
+    ComputeMatvecHalo();
 }
 
+// Returns true when neither the block nor its sons have been pushed, the caller then decides what to do with it.
+// Sons are assembled as independent tasks so that a false positive on a large block does not serialize its subtree.
 template <typename T>
-bool HMatrix<T>::ComputeAdmissibleBlock(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, std::vector<std::unique_ptr<IMatrix<T>>> &MyComputedBlocks_local, std::vector<SubMatrix<T> *> &MyNearFieldMats_local, std::vector<LowRankMatrix<T> *> &MyFarFieldMats_local, int &false_positive_local) {
+bool HMatrix<T>::ComputeAdmissibleBlock(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, LocalBlocks &local_blocks) {
     if (task.IsAdmissible()) { // When called recursively, it may not be admissible
-        AddFarFieldMat(mat, task, xt, xs, MyComputedBlocks_local, MyFarFieldMats_local, reqrank);
-        if (MyFarFieldMats_local.back()->rank_of() != -1) {
+        if (AddFarFieldMat(mat, task, xt, xs, local_blocks, reqrank)) {
             return false;
-        } else {
-            MyFarFieldMats_local.pop_back();
-            MyComputedBlocks_local.pop_back();
-            false_positive_local += 1;
         }
+        local_blocks.false_positive += 1;
     }
     // We could compute a dense block if its size is small enough, we focus on improving compression for now
     // else if (task.get_size()<maxblocksize){
-    //     AddNearFieldMat(mat,task,MyComputedBlocks_local, MyNearFieldMats_local);
+    //     AddNearFieldMat(mat,task,local_blocks);
     //     return false;
     // }
 
@@ -522,216 +852,531 @@ bool HMatrix<T>::ComputeAdmissibleBlock(VirtualGenerator<T> &mat, Block &task, c
     const VirtualCluster &t = task.get_target_cluster();
     const VirtualCluster &s = task.get_source_cluster();
 
-    if (s.IsLeaf()) {
-        if (t.IsLeaf()) {
-            return true;
-        } else {
-            std::vector<bool> Blocks_not_pushed(t.get_nb_sons());
-            for (int p = 0; p < t.get_nb_sons(); p++) {
-                task.build_son(t.get_son(p), s);
-
-                Blocks_not_pushed[p] = ComputeAdmissibleBlock(mat, task.get_son(p), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-            }
+    if (s.IsLeaf() && t.IsLeaf()) {
+        return true;
+    }
 
-            if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](bool i) { return i; })) {
-                task.clear_sons();
-                return true;
-            } else {
-                for (int p = 0; p < t.get_nb_sons(); p++) {
-                    if (Blocks_not_pushed[p]) {
-                        AddNearFieldMat(mat, task.get_son(p), MyComputedBlocks_local, MyNearFieldMats_local);
-                    }
-                }
-                return false;
+    if ((symmetry == 'H' || symmetry == 'S') && !s.IsLeaf() && !t.IsLeaf()) {
+        for (int l = 0; l < s.get_nb_sons(); l++) {
+            for (int p = 0; p < t.get_nb_sons(); p++) {
+                task.build_son(t.get_son(p), s.get_son(l));
             }
         }
+    } else if (s.IsLeaf() || (!t.IsLeaf() && t.get_size() > s.get_size())) {
+        for (int p = 0; p < t.get_nb_sons(); p++) {
+            task.build_son(t.get_son(p), s);
+        }
     } else {
-        if (t.IsLeaf()) {
-            std::vector<bool> Blocks_not_pushed(s.get_nb_sons());
-            for (int p = 0; p < s.get_nb_sons(); p++) {
-                task.build_son(t, s.get_son(p));
-                Blocks_not_pushed[p] = ComputeAdmissibleBlock(mat, task.get_son(p), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-            }
+        for (int p = 0; p < s.get_nb_sons(); p++) {
+            task.build_son(t, s.get_son(p));
+        }
+    }
 
-            if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](bool i) { return i; })) {
-                task.clear_sons();
-                return true;
-            } else {
-                for (int p = 0; p < s.get_nb_sons(); p++) {
-                    if (Blocks_not_pushed[p]) {
-                        AddNearFieldMat(mat, task.get_son(p), MyComputedBlocks_local, MyNearFieldMats_local);
-                    }
-                }
-                return false;
-            }
-        } else {
-            if (t.get_size() > s.get_size()) {
-                std::vector<bool> Blocks_not_pushed(t.get_nb_sons());
-                for (int p = 0; p < t.get_nb_sons(); p++) {
-                    task.build_son(t.get_son(p), s);
-                    Blocks_not_pushed[p] = ComputeAdmissibleBlock(mat, task.get_son(p), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-                }
+    // char instead of bool since sons write concurrently
+    int nb_sons = task.get_nb_sons();
+    std::vector<char> Blocks_not_pushed(nb_sons);
+    std::vector<LocalBlocks> sons_blocks(nb_sons);
+    for (int p = 0; p < nb_sons; p++) {
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp task default(shared) firstprivate(p)
+#endif
+        Blocks_not_pushed[p] = ComputeAdmissibleBlock(mat, task.get_son(p), xt, xs, sons_blocks[p]);
+    }
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp taskwait
+#endif
 
-                if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](bool i) { return i; })) {
-                    task.clear_sons();
-                    return true;
-                } else {
-                    for (int p = 0; p < t.get_nb_sons(); p++) {
-                        if (Blocks_not_pushed[p]) {
-                            AddNearFieldMat(mat, task.get_son(p), MyComputedBlocks_local, MyNearFieldMats_local);
-                        }
-                    }
-                    return false;
-                }
-            } else {
-                std::vector<bool> Blocks_not_pushed(s.get_nb_sons());
-                for (int p = 0; p < s.get_nb_sons(); p++) {
-                    task.build_son(t, s.get_son(p));
-                    Blocks_not_pushed[p] = ComputeAdmissibleBlock(mat, task.get_son(p), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-                }
+    for (int p = 0; p < nb_sons; p++) {
+        local_blocks.false_positive += sons_blocks[p].false_positive;
+    }
 
-                if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](bool i) { return i; })) {
-                    task.clear_sons();
-                    return true;
-                } else {
-                    for (int p = 0; p < s.get_nb_sons(); p++) {
-                        if (Blocks_not_pushed[p]) {
-                            AddNearFieldMat(mat, task.get_son(p), MyComputedBlocks_local, MyNearFieldMats_local);
-                        }
-                    }
-                    return false;
-                }
+    if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](char i) { return i; })) {
+        task.clear_sons();
+        return true;
+    } else {
+        for (int p = 0; p < nb_sons; p++) {
+            if (Blocks_not_pushed[p]) {
+                AddNearFieldMat(mat, task.get_son(p), local_blocks);
+            } else {
+                local_blocks.append(sons_blocks[p]);
             }
         }
+        return false;
     }
 }
 
+// Allocate a dense block, its coefficients are computed afterwards by ComputeDenseBlocks
 template <typename T>
-bool HMatrix<T>::ComputeAdmissibleBlocksSym(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, std::vector<std::unique_ptr<IMatrix<T>>> &MyComputedBlocks_local, std::vector<SubMatrix<T> *> &MyNearFieldMats_local, std::vector<LowRankMatrix<T> *> &MyFarFieldMats_local, int &false_positive_local) {
+void HMatrix<T>::AddNearFieldMat(VirtualGenerator<T> &mat, Block &task, LocalBlocks &local_blocks) {
+    double time = MPI_Wtime();
 
-    if (task.IsAdmissible()) {
+    const VirtualCluster &t = task.get_target_cluster();
+    const VirtualCluster &s = task.get_source_cluster();
 
-        AddFarFieldMat(mat, task, xt, xs, MyComputedBlocks_local, MyFarFieldMats_local, reqrank);
-        if (MyFarFieldMats_local.back()->rank_of() != -1) {
-            return false;
-        } else {
-            MyFarFieldMats_local.pop_back();
-            MyComputedBlocks_local.pop_back();
-            false_positive_local += 1;
-            // AddNearFieldMat(mat, task,MyComputedBlocks_local, MyNearFieldMats_local);
-            // return false;
+    const int *perm_t = (use_permutation || delay_dense_computation) ? cluster_tree_t->get_perm().data() : no_permutation_target.data();
+    const int *perm_s = (use_permutation || delay_dense_computation) ? cluster_tree_s->get_perm().data() : no_permutation_source.data();
+    int M             = mat.get_dimension() * t.get_size();
+    int N             = mat.get_dimension() * s.get_size();
+
+    SubMatrix<T> *submat;
+    if (arena) {
+        submat = new SubMatrix<T>(ReferenceIndices(), M, N, perm_t + t.get_offset(), perm_s + s.get_offset(), t.get_offset(), s.get_offset(), arena->allocate<T>(std::size_t(M) * N));
+    } else {
+        submat = new SubMatrix<T>(ReferenceIndices(), M, N, perm_t + t.get_offset(), perm_s + s.get_offset(), t.get_offset(), s.get_offset());
+    }
+    local_blocks.ComputedBlocks.emplace_back(submat);
+    local_blocks.NearFieldMats.push_back(submat);
+
+    add_busy_time(MPI_Wtime() - time);
+}
+
+// Compute the dense blocks from first_block by batches of consecutive blocks, each batch is one call to copy_submatrices
+template <typename T>
+void HMatrix<T>::ComputeDenseBlocks(VirtualGenerator<T> &mat, std::size_t first_block) {
+    const VirtualGenerator<T> &generator = delay_dense_computation ? *zerogenerator : mat;
+    int nb_blocks                        = MyNearFieldMats.size() - first_block;
+    int nb_batches                       = (nb_blocks + dense_blocks_batch_size - 1) / dense_blocks_batch_size;
+
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp parallel for schedule(dynamic)
+#endif
+    for (int b = 0; b < nb_batches; b++) {
+        double time = MPI_Wtime();
+        int begin   = first_block + b * dense_blocks_batch_size;
+        int end     = std::min(begin + dense_blocks_batch_size, int(MyNearFieldMats.size()));
+
+        std::vector<int> row_sizes(end - begin), col_sizes(end - begin);
+        std::vector<const int *> rows(end - begin), cols(end - begin);
+        std::vector<T *> ptr(end - begin);
+        for (int i = begin; i < end; i++) {
+            row_sizes[i - begin] = MyNearFieldMats[i]->nb_rows();
+            col_sizes[i - begin] = MyNearFieldMats[i]->nb_cols();
+            rows[i - begin]      = MyNearFieldMats[i]->data_ir();
+            cols[i - begin]      = MyNearFieldMats[i]->data_ic();
+            ptr[i - begin]       = MyNearFieldMats[i]->data();
         }
+        generator.copy_submatrices(row_sizes, col_sizes, rows, cols, ptr);
+
+        add_busy_time(MPI_Wtime() - time);
     }
-    // We could compute a dense block if its size is small enough, we focus on improving compression for now
-    // else if (task.get_size()<maxblocksize){
-    //     AddNearFieldMat(mat,task,MyComputedBlocks_local, MyNearFieldMats_local);
-    //     return false;
-    // }
+}
+
+// Build a low rank block, returns false and discards it when the compression failed
+template <typename T>
+bool HMatrix<T>::AddFarFieldMat(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, LocalBlocks &local_blocks, const int &reqrank) {
+    double time = MPI_Wtime();
 
-    std::size_t bsize       = task.get_size();
     const VirtualCluster &t = task.get_target_cluster();
     const VirtualCluster &s = task.get_source_cluster();
 
-    if (s.IsLeaf()) {
-        if (t.IsLeaf()) {
-            return true;
-        } else {
-            std::vector<bool> Blocks_not_pushed(t.get_nb_sons());
-            for (int p = 0; p < t.get_nb_sons(); p++) {
-                task.build_son(t.get_son(p), s);
-                Blocks_not_pushed[p] = ComputeAdmissibleBlocksSym(mat, task.get_son(p), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-            }
+    // Indices point to the permutations, which live as long as the HMatrix
+    const int *perm_t = use_permutation ? cluster_tree_t->get_perm().data() : no_permutation_target.data();
+    const int *perm_s = use_permutation ? cluster_tree_s->get_perm().data() : no_permutation_source.data();
+    std::unique_ptr<LowRankMatrix<T>> lrmat(new LowRankMatrix<T>(ReferenceIndices(), mat.get_dimension(), t.get_size(), s.get_size(), perm_t + t.get_offset(), perm_s + s.get_offset(), t.get_offset(), s.get_offset(), reqrank, this->epsilon));
 
-            if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](bool i) { return i; })) {
-                task.clear_sons();
-                return true;
-            } else {
-                for (int p = 0; p < t.get_nb_sons(); p++) {
-                    if (Blocks_not_pushed[p]) {
-                        AddNearFieldMat(mat, task.get_son(p), MyComputedBlocks_local, MyNearFieldMats_local);
-                    }
+    lrmat->build(mat, *LowRankGenerator, t, xt, s, xs, arena.get());
+
+    bool pushed = lrmat->rank_of() != -1;
+    if (pushed) {
+        local_blocks.FarFieldMats.push_back(lrmat.get());
+        local_blocks.ComputedBlocks.emplace_back(lrmat.release());
+    }
+
+    add_busy_time(MPI_Wtime() - time);
+    return pushed;
+}
+
+// Schedules of the products, with about matvec_nb_bands bands
+template <typename T>
+void HMatrix<T>::ComputeMatvecSchedules() {
+    auto cost = [](const IMatrix<T> &block, const LowRankMatrix<T> *lrmat) {
+        return lrmat ? double(lrmat->rank_of()) * (block.nb_rows() + block.nb_cols()) : double(block.nb_rows()) * block.nb_cols();
+    };
+
+    int local_offset_s = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int local_size_s   = cluster_tree_s->get_masteroffset(rankWorld).second;
+    auto is_local      = [&](const IMatrix<T> &block) { return local_offset_s <= block.get_offset_j() && block.get_offset_j() + block.nb_cols() <= local_offset_s + local_size_s; };
+
+    std::vector<MatvecItem> items;
+    std::vector<bool> local_items;
+    transp_matvec_items.clear();
+    matvec_max_rank = 0;
+    std::vector<int> begins, sizes, begins2, sizes2, transp_begins, transp_sizes; // second intervals are written by items 'F' only
+    std::vector<double> costs, transp_costs;
+    for (int b = 0; b < MyComputedBlocks.size(); b++) {
+        const IMatrix<T> &block       = *(MyComputedBlocks[b]);
+        const LowRankMatrix<T> *lrmat = dynamic_cast<const LowRankMatrix<T> *>(&block);
+        if (lrmat) {
+            matvec_max_rank = std::max(matvec_max_rank, lrmat->rank_of());
+        }
+        if (symmetry == 'N' || block.get_offset_i() != block.get_offset_j()) { // remove strictly diagonal blocks
+            if (!frozen_layout && !is_fused_block(block)) {
+                items.push_back({'N', b, lrmat});
+                local_items.push_back(is_local(block));
+                begins.push_back(block.get_offset_i());
+                sizes.push_back(block.nb_rows());
+                begins2.push_back(0);
+                sizes2.push_back(0);
+                costs.push_back(cost(block, lrmat));
+            }
+            transp_matvec_items.push_back({'N', b, lrmat});
+            transp_begins.push_back(block.get_offset_j());
+            transp_sizes.push_back(block.nb_cols());
+            transp_costs.push_back(cost(block, lrmat));
+        }
+    }
+    if (symmetry != 'N') {
+        for (int b = 0; b < MyDiagComputedBlocks.size(); b++) {
+            const IMatrix<T> &block       = *(MyDiagComputedBlocks[b]);
+            const LowRankMatrix<T> *lrmat = dynamic_cast<const LowRankMatrix<T> *>(&block);
+            if (is_fused_block(block)) { // writes the rows and the columns of the block, the scratch holds both products by V
+                items.push_back({'F', b, lrmat});
+                local_items.push_back(true);
+                begins.push_back(block.get_offset_i());
+                sizes.push_back(block.nb_rows());
+                begins2.push_back(block.get_offset_j());
+                sizes2.push_back(block.nb_cols());
+                costs.push_back(2 * cost(block, lrmat));
+                if (lrmat) {
+                    matvec_max_rank = std::max(matvec_max_rank, 2 * lrmat->rank_of());
                 }
-                return false;
+            } else if (block.get_offset_i() != block.get_offset_j()) {
+                items.push_back({'S', b, lrmat});
+                local_items.push_back(true);
+                begins.push_back(block.get_offset_j());
+                sizes.push_back(block.nb_cols());
+                begins2.push_back(0);
+                sizes2.push_back(0);
+                costs.push_back(cost(block, lrmat));
             }
         }
-    } else {
-        if (t.IsLeaf()) {
-            std::vector<bool> Blocks_not_pushed(s.get_nb_sons());
-            for (int p = 0; p < s.get_nb_sons(); p++) {
-                task.build_son(t, s.get_son(p));
-                Blocks_not_pushed[p] = ComputeAdmissibleBlocksSym(mat, task.get_son(p), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
+        for (int b = 0; b < MyStrictlyDiagNearFieldMats.size(); b++) {
+            const IMatrix<T> &block = *(MyStrictlyDiagNearFieldMats[b]);
+            items.push_back({'D', b, nullptr});
+            local_items.push_back(true);
+            begins.push_back(block.get_offset_i());
+            sizes.push_back(block.nb_rows());
+            begins2.push_back(0);
+            sizes2.push_back(0);
+            costs.push_back(cost(block, nullptr));
+        }
+    }
+    for (int r = 0; r < packed_rows.size(); r++) {
+        items.push_back({'P', r, nullptr});
+        local_items.push_back(packed_rows[r].local_source);
+        begins.push_back(packed_rows[r].offset_i);
+        sizes.push_back(packed_rows[r].nb_rows);
+        begins2.push_back(0);
+        sizes2.push_back(0);
+        costs.push_back(packed_rows[r].cost);
+        matvec_max_rank = std::max(matvec_max_rank, packed_rows[r].rank);
+    }
+
+    for (bool local : {true, false}) {
+        std::vector<MatvecItem> &part_items = local ? local_matvec_items : matvec_items;
+        std::vector<int> part_begins, part_sizes, part_begins2, part_sizes2;
+        std::vector<double> part_costs;
+        part_items.clear();
+        for (int i = 0; i < items.size(); i++) {
+            if (local_items[i] == local) {
+                part_items.push_back(items[i]);
+                part_begins.push_back(begins[i]);
+                part_sizes.push_back(sizes[i]);
+                part_begins2.push_back(begins2[i]);
+                part_sizes2.push_back(sizes2[i]);
+                part_costs.push_back(costs[i]);
             }
+        }
+        (local ? local_matvec_schedule : matvec_schedule) = MatvecSchedule(part_begins, part_sizes, part_begins2, part_sizes2, part_costs, std::max(local_size / matvec_nb_bands, 1));
+    }
+    transp_matvec_schedule = MatvecSchedule(transp_begins, transp_sizes, transp_costs, std::max(nc / matvec_nb_bands, 1));
+}
 
-            if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](bool i) { return i; })) {
-                task.clear_sons();
-                return true;
-            } else {
-                for (int p = 0; p < s.get_nb_sons(); p++) {
-                    if (Blocks_not_pushed[p]) {
-                        AddNearFieldMat(mat, task.get_son(p), MyComputedBlocks_local, MyNearFieldMats_local);
-                    }
-                }
-                return false;
-            }
+// Intervals of the source exchanged by the products, only depends on the blocks so that freezing the layout keeps it
+template <typename T>
+void HMatrix<T>::ComputeMatvecHalo() {
+    int local_offset_s = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int local_size_s   = cluster_tree_s->get_masteroffset(rankWorld).second;
+
+    // Union of the columns of the blocks not only needing the local part of the source
+    std::vector<std::pair<int, int>> columns;
+    for (int b = 0; b < MyComputedBlocks.size(); b++) {
+        const IMatrix<T> &block       = *(MyComputedBlocks[b]);
+        const LowRankMatrix<T> *lrmat = dynamic_cast<const LowRankMatrix<T> *>(&block);
+        if ((lrmat && lrmat->rank_of() == 0) || (local_offset_s <= block.get_offset_j() && block.get_offset_j() + block.nb_cols() <= local_offset_s + local_size_s)) {
+            continue;
+        }
+        columns.emplace_back(block.get_offset_j(), block.get_offset_j() + block.nb_cols());
+    }
+    std::sort(columns.begin(), columns.end());
+    std::vector<std::pair<int, int>> intervals;
+    for (const auto &interval : columns) {
+        if (!intervals.empty() && interval.first <= intervals.back().second) {
+            intervals.back().second = std::max(intervals.back().second, interval.second);
         } else {
-            std::vector<bool> Blocks_not_pushed(t.get_nb_sons() * s.get_nb_sons());
-            for (int l = 0; l < s.get_nb_sons(); l++) {
-                for (int p = 0; p < t.get_nb_sons(); p++) {
-                    task.build_son(t.get_son(p), s.get_son(l));
-                    Blocks_not_pushed[p + l * t.get_nb_sons()] = ComputeAdmissibleBlocksSym(mat, task.get_son(p + l * t.get_nb_sons()), xt, xs, MyComputedBlocks_local, MyNearFieldMats_local, MyFarFieldMats_local, false_positive_local);
-                }
-            }
-            if ((bsize <= maxblocksize) && std::all_of(Blocks_not_pushed.begin(), Blocks_not_pushed.end(), [](bool i) { return i; })) {
-                task.clear_sons();
-                return true;
-            } else {
-                for (int p = 0; p < Blocks_not_pushed.size(); p++) {
-                    if (Blocks_not_pushed[p]) {
-                        AddNearFieldMat(mat, task.get_son(p), MyComputedBlocks_local, MyNearFieldMats_local);
-                    }
-                }
-                return false;
+            intervals.push_back(interval);
+        }
+    }
+
+    // Intervals received from every other process
+    halo_recvs.clear();
+    std::vector<int> nb_recvs(sizeWorld, 0), nb_sends(sizeWorld, 0);
+    for (int r = 0; r < sizeWorld; r++) {
+        int begin = cluster_tree_s->get_masteroffset(r).first;
+        int end   = begin + cluster_tree_s->get_masteroffset(r).second;
+        for (int i = 0; i < intervals.size() && r != rankWorld; i++) {
+            int first = std::max(intervals[i].first, begin);
+            int last  = std::min(intervals[i].second, end);
+            if (first < last) {
+                halo_recvs.push_back({r, first, last - first});
+                nb_recvs[r]++;
             }
         }
     }
+
+    // Intervals sent to every other process
+    MPI_Alltoall(nb_recvs.data(), 1, MPI_INT, nb_sends.data(), 1, MPI_INT, comm);
+    std::vector<int> recv_counts(sizeWorld), recv_displs(sizeWorld, 0), send_counts(sizeWorld), send_displs(sizeWorld, 0);
+    for (int r = 0; r < sizeWorld; r++) {
+        recv_counts[r] = 2 * nb_recvs[r];
+        send_counts[r] = 2 * nb_sends[r];
+        if (r > 0) {
+            recv_displs[r] = recv_displs[r - 1] + recv_counts[r - 1];
+            send_displs[r] = send_displs[r - 1] + send_counts[r - 1];
+        }
+    }
+    std::vector<int> recv_intervals(2 * halo_recvs.size()), send_intervals(send_displs.back() + send_counts.back());
+    for (int i = 0; i < halo_recvs.size(); i++) {
+        recv_intervals[2 * i]     = halo_recvs[i].offset;
+        recv_intervals[2 * i + 1] = halo_recvs[i].size;
+    }
+    MPI_Alltoallv(recv_intervals.data(), recv_counts.data(), recv_displs.data(), MPI_INT, send_intervals.data(), send_counts.data(), send_displs.data(), MPI_INT, comm);
+
+    halo_sends.clear();
+    for (int r = 0; r < sizeWorld; r++) {
+        for (int i = 0; i < nb_sends[r]; i++) {
+            halo_sends.push_back({r, send_intervals[send_displs[r] + 2 * i], send_intervals[send_displs[r] + 2 * i + 1]});
+        }
+    }
 }
 
-// Build a dense block
 template <typename T>
-void HMatrix<T>::AddNearFieldMat(VirtualGenerator<T> &mat, Block &task, std::vector<std::unique_ptr<IMatrix<T>>> &MyComputedBlocks_local, std::vector<SubMatrix<T> *> &MyNearFieldMats_local) {
+void HMatrix<T>::freeze_layout() {
+    if (frozen_layout) {
+        return;
+    }
 
-    const VirtualCluster &t = task.get_target_cluster();
-    const VirtualCluster &s = task.get_source_cluster();
+    // Blocks of the products grouped by rows and by whether they only need the local part of the source, in the order of MyComputedBlocks
+    int local_offset_s = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int local_size_s   = cluster_tree_s->get_masteroffset(rankWorld).second;
+    std::map<std::tuple<int, int, bool>, int> rows_index;
+    packed_rows.clear();
+    for (int b = 0; b < MyComputedBlocks.size(); b++) {
+        IMatrix<T> &block = *(MyComputedBlocks[b]);
+        if ((symmetry != 'N' && block.get_offset_i() == block.get_offset_j()) || is_fused_block(block)) { // strictly diagonal blocks are products with symmetry, fused blocks are items 'F'
+            continue;
+        }
+        bool local_source = local_offset_s <= block.get_offset_j() && block.get_offset_j() + block.nb_cols() <= local_offset_s + local_size_s;
+        auto key          = std::make_tuple(block.get_offset_i(), block.nb_rows(), local_source);
+        auto row          = rows_index.find(key);
+        if (row == rows_index.end()) {
+            row = rows_index.emplace(key, packed_rows.size()).first;
+            packed_rows.push_back({block.get_offset_i(), block.nb_rows(), 0, nullptr, 0, local_source, {}, {}});
+        }
+        PackedRow &packed_row   = packed_rows[row->second];
+        LowRankMatrix<T> *lrmat = dynamic_cast<LowRankMatrix<T> *>(&block);
+        if (lrmat) {
+            if (lrmat->rank_of() > 0) {
+                packed_row.lrmats.push_back(lrmat);
+                packed_row.rank += lrmat->rank_of();
+                packed_row.cost += double(lrmat->rank_of()) * (block.nb_rows() + block.nb_cols());
+            }
+        } else {
+            SubMatrix<T> *dense = dynamic_cast<SubMatrix<T> *>(&block);
+            if (dense == nullptr) {
+                throw std::logic_error("[Htool error] Block of unknown type, the layout cannot be frozen"); // LCOV_EXCL_LINE
+            }
+            packed_row.dense_blocks.push_back(dense);
+            packed_row.cost += double(block.nb_rows()) * block.nb_cols();
+        }
+    }
+    std::sort(packed_rows.begin(), packed_rows.end(), [](const PackedRow &a, const PackedRow &b) { return std::make_tuple(a.offset_i, -a.nb_rows, !a.local_source) < std::make_tuple(b.offset_i, -b.nb_rows, !b.local_source); });
 
-    if (use_permutation && !delay_dense_computation) {
-        MyComputedBlocks_local.emplace_back(new SubMatrix<T>(mat, mat.get_dimension() * t.get_size(), mat.get_dimension() * s.get_size(), cluster_tree_t->get_perm().data() + t.get_offset(), cluster_tree_s->get_perm().data() + s.get_offset(), t.get_offset(), s.get_offset()));
-    } else if (!delay_dense_computation) {
-        MyComputedBlocks_local.emplace_back(new SubMatrix<T>(mat, mat.get_dimension() * t.get_size(), mat.get_dimension() * s.get_size(), no_permutation_target.data() + t.get_offset(), no_permutation_source.data() + s.get_offset(), t.get_offset(), s.get_offset()));
-    } else {
-        std::cout << mat.get_dimension() * t.get_size() << " " << mat.get_dimension() * s.get_size() << std::endl;
-        MyComputedBlocks_local.emplace_back(new SubMatrix<T>(*zerogenerator, mat.get_dimension() * t.get_size(), mat.get_dimension() * s.get_size(), cluster_tree_t->get_perm().data() + t.get_offset(), cluster_tree_s->get_perm().data() + s.get_offset(), t.get_offset(), s.get_offset()));
+    // Rows are stored one after the other, each one starting on a cache line
+    std::size_t alignment_size = std::max(packed_storage.get_alignment() / sizeof(T), std::size_t(1));
+    std::vector<std::size_t> positions(packed_rows.size() + 1, 0);
+    for (int r = 0; r < packed_rows.size(); r++) {
+        std::size_t size = std::size_t(packed_rows[r].nb_rows) * packed_rows[r].rank;
+        for (const LowRankMatrix<T> *lrmat : packed_rows[r].lrmats) {
+            size += std::size_t(lrmat->rank_of()) * lrmat->nb_cols();
+        }
+        for (const SubMatrix<T> *dense : packed_rows[r].dense_blocks) {
+            size += std::size_t(dense->nb_rows()) * dense->nb_cols();
+        }
+        positions[r + 1] = positions[r] + (size + alignment_size - 1) / alignment_size * alignment_size;
     }
+    T *storage = packed_storage.reserve(positions.back());
 
-    MyNearFieldMats_local.push_back(dynamic_cast<SubMatrix<T> *>(MyComputedBlocks_local.back().get()));
+    // Rows are copied in parallel so that their pages are first touched by the threads computing products
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp parallel for schedule(dynamic)
+#endif
+    for (int r = 0; r < packed_rows.size(); r++) {
+        PackedRow &packed_row = packed_rows[r];
+        packed_row.U          = storage + positions[r];
+        T *u                  = packed_row.U;
+        T *ptr                = packed_row.U + std::size_t(packed_row.nb_rows) * packed_row.rank;
+        for (LowRankMatrix<T> *lrmat : packed_row.lrmats) {
+            lrmat->relocate(u, ptr);
+            u += std::size_t(packed_row.nb_rows) * lrmat->rank_of();
+            ptr += std::size_t(lrmat->rank_of()) * lrmat->nb_cols();
+        }
+        for (SubMatrix<T> *dense : packed_row.dense_blocks) {
+            dense->relocate(ptr);
+            ptr += std::size_t(dense->nb_rows()) * dense->nb_cols();
+        }
+    }
+
+    frozen_layout = true;
+    ComputeMatvecSchedules();
 }
 
-// Build a low rank block
+// Products by the V of every low-rank block of the row, then by the U of the row at once
 template <typename T>
-void HMatrix<T>::AddFarFieldMat(VirtualGenerator<T> &mat, Block &task, const double *const xt, const double *const xs, std::vector<std::unique_ptr<IMatrix<T>>> &MyComputedBlocks_local, std::vector<LowRankMatrix<T> *> &MyFarFieldMats_local, const int &reqrank) {
+void HMatrix<T>::add_packed_row_mvprod(const PackedRow &row, T *lrmat_work, const T *const in, int in_offset, T *const out, int mu, char transb) const {
+    if (lrmat_work == nullptr) {
+        for (const LowRankMatrix<T> *lrmat : row.lrmats) {
+            lrmat->add_mvprod_row_major(in + (lrmat->get_offset_j() - in_offset) * mu, out, mu, transb, 'N');
+        }
+    } else if (row.rank > 0) {
+        T *a = lrmat_work;
+        for (const LowRankMatrix<T> *lrmat : row.lrmats) {
+            lrmat->get_V_matrix().mvprod_row_major(in + (lrmat->get_offset_j() - in_offset) * mu, a, mu, transb, 'N');
+            a += lrmat->rank_of() * mu;
+        }
+        Matrix<T> U;
+        U.assign(row.nb_rows, row.rank, row.U, false);
+        U.add_mvprod_row_major(lrmat_work, out, mu, transb, 'N');
+    }
+    for (const SubMatrix<T> *dense : row.dense_blocks) {
+        dense->add_mvprod_row_major(in + (dense->get_offset_j() - in_offset) * mu, out, mu, transb, 'N');
+    }
+}
 
-    const VirtualCluster &t = task.get_target_cluster();
-    const VirtualCluster &s = task.get_source_cluster();
+template <typename T>
+void HMatrix<T>::run_matvec_items(const MatvecSchedule &schedule, const std::vector<MatvecItem> &items, const T *const in, int in_offset, T *const out, MatvecPlan<T> &plan) const {
+    int mu = plan.get_mu();
 
-    if (use_permutation) {
-        MyComputedBlocks_local.emplace_back(new LowRankMatrix<T>(mat.get_dimension(), std::vector<int>(cluster_tree_t->get_perm_start() + t.get_offset(), cluster_tree_t->get_perm_start() + t.get_offset() + t.get_size()), std::vector<int>(cluster_tree_s->get_perm_start() + s.get_offset(), cluster_tree_s->get_perm_start() + s.get_offset() + s.get_size()), t.get_offset(), s.get_offset(), reqrank, this->epsilon));
+    // To localize the rhs with multiple rhs, it is transpose. So instead of A*B, we do transpose(B)*transpose(A)
+    char transb = 'T';
+    char op_sym = 'T';
+    // In case of a hermitian matrix, the rhs is conjugate transpose
+    if (symmetry == 'H') {
+        transb = 'C';
+        op_sym = 'C';
     }
 
-    else {
-        MyComputedBlocks_local.emplace_back(new LowRankMatrix<T>(mat.get_dimension(), std::vector<int>(no_permutation_target.data() + t.get_offset(), no_permutation_target.data() + t.get_offset() + t.get_size()), std::vector<int>(no_permutation_source.data() + s.get_offset(), no_permutation_source.data() + s.get_offset() + s.get_size()), t.get_offset(), s.get_offset(), reqrank, this->epsilon));
+    // Every block adds its contribution directly to out, rows are written by one thread at a time
+#if _OPENMP
+#    pragma omp parallel
+#endif
+    {
+        T *lrmat_work = plan.get_lrmat_work();
+        schedule.run([&](int item) {
+            const MatvecItem &matvec_item = items[item];
+            if (matvec_item.type == 'N') {
+                const IMatrix<T> &M = *(MyComputedBlocks[matvec_item.index]);
+                add_item_mvprod(M, matvec_item.lrmat, lrmat_work, in + (M.get_offset_j() - in_offset) * mu, out + (M.get_offset_i() - local_offset) * mu, mu, transb, 'N');
+            } else if (matvec_item.type == 'S') { // Symmetry part of the diagonal part
+                const IMatrix<T> &M = *(MyDiagComputedBlocks[matvec_item.index]);
+                add_item_mvprod(M, matvec_item.lrmat, lrmat_work, in + (M.get_offset_i() - in_offset) * mu, out + (M.get_offset_j() - local_offset) * mu, mu, 'N', op_sym);
+            } else if (matvec_item.type == 'F') { // Diagonal part and its symmetry, fused with one right-hand side, two products by gemm otherwise
+                const IMatrix<T> &M = *(MyDiagComputedBlocks[matvec_item.index]);
+                if (mu == 1) {
+                    add_item_mvprod_and_transp(M, matvec_item.lrmat, lrmat_work, in + M.get_offset_j() - in_offset, out + M.get_offset_i() - local_offset, in + M.get_offset_i() - in_offset, out + M.get_offset_j() - local_offset, op_sym);
+                } else {
+                    add_item_mvprod(M, matvec_item.lrmat, lrmat_work, in + (M.get_offset_j() - in_offset) * mu, out + (M.get_offset_i() - local_offset) * mu, mu, transb, 'N');
+                    add_item_mvprod(M, matvec_item.lrmat, lrmat_work, in + (M.get_offset_i() - in_offset) * mu, out + (M.get_offset_j() - local_offset) * mu, mu, 'N', op_sym);
+                }
+            } else if (matvec_item.type == 'P') {
+                const PackedRow &row = packed_rows[matvec_item.index];
+                add_packed_row_mvprod(row, lrmat_work, in, in_offset, out + (row.offset_i - local_offset) * mu, mu, transb);
+            } else {
+                const SubMatrix<T> &M = *(MyStrictlyDiagNearFieldMats[matvec_item.index]);
+                M.add_mvprod_row_major_sym(in + (M.get_offset_i() - in_offset) * mu, out + (M.get_offset_j() - local_offset) * mu, mu, this->UPLO, this->symmetry);
+            }
+        });
     }
+}
 
-    MyFarFieldMats_local.push_back(dynamic_cast<LowRankMatrix<T> *>(MyComputedBlocks_local.back().get()));
-    MyFarFieldMats_local.back()->build(mat, *LowRankGenerator, t, xt, s, xs);
+// Same as add_packed_row_mvprod, the scratch holds the column-major rank x mu products by the V
+template <typename T>
+void HMatrix<T>::add_packed_row_mvprod_col_major(const PackedRow &row, T *lrmat_work, const T *const in, int in_offset, int ldin, T *const out, int ldout, int mu) const {
+    if (lrmat_work == nullptr) {
+        for (const LowRankMatrix<T> *lrmat : row.lrmats) {
+            lrmat->add_mvprod_col_major(in + lrmat->get_offset_j() - in_offset, ldin, out, ldout, mu, 'N');
+        }
+    } else if (row.rank > 0) {
+        T *a = lrmat_work;
+        for (const LowRankMatrix<T> *lrmat : row.lrmats) {
+            lrmat->get_V_matrix().mvprod_col_major(in + lrmat->get_offset_j() - in_offset, ldin, a, row.rank, mu, 'N');
+            a += lrmat->rank_of();
+        }
+        Matrix<T> U;
+        U.assign(row.nb_rows, row.rank, row.U, false);
+        U.add_mvprod_col_major(lrmat_work, row.rank, out, ldout, mu, 'N');
+    }
+    for (const SubMatrix<T> *dense : row.dense_blocks) {
+        dense->add_mvprod_col_major(in + dense->get_offset_j() - in_offset, ldin, out, ldout, mu, 'N');
+    }
+}
+
+template <typename T>
+void HMatrix<T>::run_matvec_items_col_major(const MatvecSchedule &schedule, const std::vector<MatvecItem> &items, const T *const in, int in_offset, int ldin, T *const out, int ldout, MatvecPlan<T> &plan) const {
+    int mu = plan.get_mu();
+
+    // No transposition, blocks of the symmetric part are applied with their adjoint for a hermitian matrix
+    char op_sym = (symmetry == 'H') ? 'C' : 'T';
+
+    // Every block adds its contribution directly to out, rows are written by one thread at a time
+#if _OPENMP
+#    pragma omp parallel
+#endif
+    {
+        T *lrmat_work = plan.get_lrmat_work();
+        schedule.run([&](int item) {
+            const MatvecItem &matvec_item = items[item];
+            if (matvec_item.type == 'N') {
+                const IMatrix<T> &M = *(MyComputedBlocks[matvec_item.index]);
+                add_item_mvprod_col_major(M, matvec_item.lrmat, lrmat_work, in + M.get_offset_j() - in_offset, ldin, out + M.get_offset_i() - local_offset, ldout, mu, 'N');
+            } else if (matvec_item.type == 'S') { // Symmetry part of the diagonal part
+                const IMatrix<T> &M = *(MyDiagComputedBlocks[matvec_item.index]);
+                add_item_mvprod_col_major(M, matvec_item.lrmat, lrmat_work, in + M.get_offset_i() - in_offset, ldin, out + M.get_offset_j() - local_offset, ldout, mu, op_sym);
+            } else if (matvec_item.type == 'F') {
+                const IMatrix<T> &M = *(MyDiagComputedBlocks[matvec_item.index]);
+                if (mu == 1) {
+                    add_item_mvprod_and_transp(M, matvec_item.lrmat, lrmat_work, in + M.get_offset_j() - in_offset, out + M.get_offset_i() - local_offset, in + M.get_offset_i() - in_offset, out + M.get_offset_j() - local_offset, op_sym);
+                } else {
+                    add_item_mvprod_col_major(M, matvec_item.lrmat, lrmat_work, in + M.get_offset_j() - in_offset, ldin, out + M.get_offset_i() - local_offset, ldout, mu, 'N');
+                    add_item_mvprod_col_major(M, matvec_item.lrmat, lrmat_work, in + M.get_offset_i() - in_offset, ldin, out + M.get_offset_j() - local_offset, ldout, mu, op_sym);
+                }
+            } else if (matvec_item.type == 'P') {
+                const PackedRow &row = packed_rows[matvec_item.index];
+                add_packed_row_mvprod_col_major(row, lrmat_work, in, in_offset, ldin, out + row.offset_i - local_offset, ldout, mu);
+            } else {
+                const SubMatrix<T> &M = *(MyStrictlyDiagNearFieldMats[matvec_item.index]);
+                M.add_mvprod_col_major_sym(in + M.get_offset_i() - in_offset, ldin, out + M.get_offset_j() - local_offset, ldout, mu, this->UPLO, this->symmetry);
+            }
+        });
+    }
+}
+
+template <typename T>
+MatvecPlan<T> HMatrix<T>::create_matvec_plan(int mu) const {
+    if (mu < 1) {
+        throw std::invalid_argument("[Htool error] Number of right-hand sides of a matvec plan must be positive"); // LCOV_EXCL_LINE
+    }
+    return MatvecPlan<T>(mu, cluster_tree_t->get_masteroffset(), cluster_tree_s->get_masteroffset(), rankWorld, matvec_max_rank);
 }
 
 // Compute infos
@@ -789,12 +1434,80 @@ void HMatrix<T>::ComputeInfos(const std::vector<double> &mytime) {
     MPI_Reduce(&(mytime[0]), &(maxtime[0]), 2, MPI_DOUBLE, MPI_MAX, 0, comm);
     MPI_Reduce(&(mytime[0]), &(meantime[0]), 2, MPI_DOUBLE, MPI_SUM, 0, comm);
 
-    meantime /= sizeWorld;
+    meantime /= sizeWorld;
+
+    infos["Block_tree_mean"] = NbrToStr(meantime[0]);
+    infos["Block_tree_max"]  = NbrToStr(maxtime[0]);
+    infos["Blocks_mean"]     = NbrToStr(meantime[1]);
+    infos["Blocks_max"]      = NbrToStr(maxtime[1]);
+
+    // Load balance of the assembly: busy time spent computing blocks and idle time per thread
+    // 0 : busy ; 1 : idle ; 2 : number of threads (only summed)
+    std::vector<double> maxthreadinfos(2, 0), meanthreadinfos(3, 0);
+    for (int i = 0; i < thread_busy_time.size(); i++) {
+        double idle       = std::max(blocks_wall_time - thread_busy_time[i], 0.);
+        maxthreadinfos[0] = std::max(maxthreadinfos[0], thread_busy_time[i]);
+        maxthreadinfos[1] = std::max(maxthreadinfos[1], idle);
+        meanthreadinfos[0] += thread_busy_time[i];
+        meanthreadinfos[1] += idle;
+    }
+    meanthreadinfos[2] = thread_busy_time.size();
+    if (rankWorld == 0) {
+        MPI_Reduce(MPI_IN_PLACE, &(maxthreadinfos[0]), 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+        MPI_Reduce(MPI_IN_PLACE, &(meanthreadinfos[0]), 3, MPI_DOUBLE, MPI_SUM, 0, comm);
+    } else {
+        MPI_Reduce(&(maxthreadinfos[0]), &(maxthreadinfos[0]), 2, MPI_DOUBLE, MPI_MAX, 0, comm);
+        MPI_Reduce(&(meanthreadinfos[0]), &(meanthreadinfos[0]), 3, MPI_DOUBLE, MPI_SUM, 0, comm);
+    }
+
+    infos["Blocks_thread_busy_max"]  = NbrToStr(maxthreadinfos[0]);
+    infos["Blocks_thread_busy_mean"] = NbrToStr(meanthreadinfos[0] / meanthreadinfos[2]);
+    infos["Blocks_thread_idle_max"]  = NbrToStr(maxthreadinfos[1]);
+    infos["Blocks_thread_idle_mean"] = NbrToStr(meanthreadinfos[1] / meanthreadinfos[2]);
+
+    // Memory of the blocks: 0 : coefficients ; 1 : arena
+    std::vector<std::size_t> memoryinfos{this->get_payload_bytes(), this->get_arena_bytes()};
+    if (rankWorld == 0) {
+        MPI_Reduce(MPI_IN_PLACE, &(memoryinfos[0]), 2, my_MPI_SIZE_T, MPI_SUM, 0, comm);
+    } else {
+        MPI_Reduce(&(memoryinfos[0]), &(memoryinfos[0]), 2, my_MPI_SIZE_T, MPI_SUM, 0, comm);
+    }
+
+    infos["Payload_bytes"] = NbrToStr(memoryinfos[0]);
+    infos["Arena_bytes"]   = NbrToStr(memoryinfos[1]);
+
+    // Kernel cache: 0 : hits ; 1 : misses
+    std::vector<std::size_t> cacheinfos{kernel_cache_hits, kernel_cache_misses};
+    if (rankWorld == 0) {
+        MPI_Reduce(MPI_IN_PLACE, &(cacheinfos[0]), 2, my_MPI_SIZE_T, MPI_SUM, 0, comm);
+    } else {
+        MPI_Reduce(&(cacheinfos[0]), &(cacheinfos[0]), 2, my_MPI_SIZE_T, MPI_SUM, 0, comm);
+    }
+
+    infos["Kernel_cache_budget"] = NbrToStr(kernel_cache_budget);
+    infos["Kernel_cache_hits"]   = NbrToStr(cacheinfos[0]);
+    infos["Kernel_cache_misses"] = NbrToStr(cacheinfos[1]);
 
-    infos["Block_tree_mean"] = NbrToStr(meantime[0]);
-    infos["Block_tree_max"]  = NbrToStr(maxtime[0]);
-    infos["Blocks_mean"]     = NbrToStr(meantime[1]);
-    infos["Blocks_max"]      = NbrToStr(maxtime[1]);
+    // Halo of the products, per right-hand side: 0 : received coefficients ; 1 : number of neighbours
+    std::vector<std::size_t> haloinfos(2, 0);
+    for (int i = 0; i < halo_recvs.size(); i++) {
+        haloinfos[0] += halo_recvs[i].size;
+        haloinfos[1] += (i == 0 || halo_recvs[i].rank != halo_recvs[i - 1].rank);
+    }
+    std::vector<std::size_t> maxhaloinfos(haloinfos), meanhaloinfos(haloinfos);
+    if (rankWorld == 0) {
+        MPI_Reduce(MPI_IN_PLACE, &(maxhaloinfos[0]), 2, my_MPI_SIZE_T, MPI_MAX, 0, comm);
+        MPI_Reduce(MPI_IN_PLACE, &(meanhaloinfos[0]), 2, my_MPI_SIZE_T, MPI_SUM, 0, comm);
+    } else {
+        MPI_Reduce(&(maxhaloinfos[0]), &(maxhaloinfos[0]), 2, my_MPI_SIZE_T, MPI_MAX, 0, comm);
+        MPI_Reduce(&(meanhaloinfos[0]), &(meanhaloinfos[0]), 2, my_MPI_SIZE_T, MPI_SUM, 0, comm);
+    }
+
+    infos["Matvec_halo_size_max"]        = NbrToStr(maxhaloinfos[0]);
+    infos["Matvec_halo_size_mean"]       = NbrToStr(double(meanhaloinfos[0]) / sizeWorld);
+    infos["Matvec_halo_neighbours_max"]  = NbrToStr(maxhaloinfos[1]);
+    infos["Matvec_halo_neighbours_mean"] = NbrToStr(double(meanhaloinfos[1]) / sizeWorld);
+    infos["Matvec_allgather_size"]       = NbrToStr(this->nc);
 
     // Size
     infos["Source_size"]              = NbrToStr(this->nc);
@@ -841,103 +1554,31 @@ void HMatrix<T>::ComputeInfos(const std::vector<double> &mytime) {
 }
 
 template <typename T>
-void HMatrix<T>::mymvprod_global_to_local(const T *const in, T *const out, const int &mu) const {
-
+void HMatrix<T>::mymvprod_global_to_local(const T *const in, T *const out, MatvecPlan<T> &plan) const {
+    int mu = plan.get_mu();
     std::fill(out, out + local_size * mu, 0);
-    int incx(1), incy(1), local_size_rhs(local_size * mu);
-    T da(1);
-
-    // Contribution champ lointain
-#if _OPENMP
-#    pragma omp parallel
-#endif
-    {
-        std::vector<T> temp(local_size * mu, 0);
-        // To localize the rhs with multiple rhs, it is transpose. So instead of A*B, we do transpose(B)*transpose(A)
-        char transb = 'T';
-        // In case of a hermitian matrix, the rhs is conjugate transpose
-        if (symmetry == 'H') {
-            transb = 'C';
-        }
-
-        // Contribution champ lointain
-#if _OPENMP
-#    pragma omp for schedule(guided) nowait
-#endif
-        for (int b = 0; b < MyComputedBlocks.size(); b++) {
-            int offset_i = MyComputedBlocks[b]->get_offset_i();
-            int offset_j = MyComputedBlocks[b]->get_offset_j();
-            if (!(symmetry != 'N') || offset_i != offset_j) { // remove strictly diagonal blocks
-                MyComputedBlocks[b]->add_mvprod_row_major(in + offset_j * mu, temp.data() + (offset_i - local_offset) * mu, mu, transb);
-            }
-        }
-
-        // Symmetry part of the diagonal part
-        if (symmetry != 'N') {
-            transb      = 'N';
-            char op_sym = 'T';
-            if (symmetry == 'H') {
-                op_sym = 'C';
-            }
-
-#if _OPENMP
-#    pragma omp for schedule(guided) nowait
-#endif
-            for (int b = 0; b < MyDiagComputedBlocks.size(); b++) {
-                int offset_i = MyDiagComputedBlocks[b]->get_offset_j();
-                int offset_j = MyDiagComputedBlocks[b]->get_offset_i();
-
-                if (offset_i != offset_j) { // remove strictly diagonal blocks
-                    MyDiagComputedBlocks[b]->add_mvprod_row_major(in + offset_j * mu, temp.data() + (offset_i - local_offset) * mu, mu, transb, op_sym);
-                }
-            }
-
-#if _OPENMP
-#    pragma omp for schedule(guided) nowait
-#endif
-            for (int b = 0; b < MyStrictlyDiagNearFieldMats.size(); b++) {
-                const SubMatrix<T> &M = *(MyStrictlyDiagNearFieldMats[b]);
-                int offset_i          = M.get_offset_j();
-                int offset_j          = M.get_offset_i();
-                M.add_mvprod_row_major_sym(in + offset_j * mu, temp.data() + (offset_i - local_offset) * mu, mu, this->UPLO, this->symmetry);
-            }
-        }
 
-#if _OPENMP
-#    pragma omp critical
-#endif
-        Blas<T>::axpy(&local_size_rhs, &da, temp.data(), &incx, out, &incy);
-    }
+    // Same order of the blocks as mymvprod_local_to_local
+    run_matvec_items(local_matvec_schedule, local_matvec_items, in, 0, out, plan);
+    run_matvec_items(matvec_schedule, matvec_items, in, 0, out, plan);
 }
 
 template <typename T>
-void HMatrix<T>::mymvprod_transp_local_to_global(const T *const in, T *const out, const int &mu) const {
+void HMatrix<T>::mymvprod_transp_local_to_global(const T *const in, T *const out, MatvecPlan<T> &plan) const {
+    int mu = plan.get_mu();
     std::fill(out, out + this->nc * mu, 0);
-    int incx(1), incy(1);
-    int global_size_rhs = this->nc * mu;
-    T da(1);
 
-    // Contribution champ lointain
+    // Every block adds its contribution directly to out, columns are written by one thread at a time
 #if _OPENMP
 #    pragma omp parallel
 #endif
     {
-        std::vector<T> temp(this->nc * mu, 0);
-#if _OPENMP
-#    pragma omp for schedule(guided) nowait
-#endif
-        for (int b = 0; b < MyComputedBlocks.size(); b++) {
-            int offset_i = MyComputedBlocks[b]->get_offset_i();
-            int offset_j = MyComputedBlocks[b]->get_offset_j();
-            if (!(symmetry != 'N') || offset_i != offset_j) { // remove strictly diagonal blocks
-                MyComputedBlocks[b]->add_mvprod_row_major(in + (offset_i - local_offset) * mu, temp.data() + offset_j * mu, mu, 'T', 'T');
-            }
-        }
-
-#if _OPENMP
-#    pragma omp critical
-#endif
-        Blas<T>::axpy(&(global_size_rhs), &da, temp.data(), &incx, out, &incy);
+        T *lrmat_work = plan.get_lrmat_work();
+        transp_matvec_schedule.run([&](int item) {
+            const MatvecItem &matvec_item = transp_matvec_items[item];
+            const IMatrix<T> &M           = *(MyComputedBlocks[matvec_item.index]);
+            add_item_mvprod(M, matvec_item.lrmat, lrmat_work, in + (M.get_offset_i() - local_offset) * mu, out + M.get_offset_j() * mu, mu, 'T', 'T');
+        });
     }
 
     MPI_Allreduce(MPI_IN_PLACE, out, this->nc * mu, wrapper_mpi<T>::mpi_type(), MPI_SUM, comm);
@@ -976,482 +1617,452 @@ void HMatrix<T>::local_to_global_source(const T *const in, T *const out, const i
     MPI_Allgatherv(in, recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), out, &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
 }
 
+
 template <typename T>
-void HMatrix<T>::mymvprod_local_to_local(const T *const in, T *const out, const int &mu, T *work) const {
-    double time      = MPI_Wtime();
-    bool need_delete = false;
+void HMatrix<T>::mymvprod_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work) const {
+    double time = MPI_Wtime();
+    int mu      = plan.get_mu();
     if (work == nullptr) {
-        work        = new T[this->nc * mu];
-        need_delete = true;
+        work = plan.get_work(std::size_t(this->nc) * mu);
+    }
+
+    // Exchange of the halo, overlapped with the blocks that only need the local part of the source
+    int local_offset_s = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int local_size_s   = cluster_tree_s->get_masteroffset(rankWorld).second;
+    int nb_requests    = post_halo_exchange(in, work, plan);
+
+    std::fill(out, out + local_size * mu, 0);
+    run_matvec_items(local_matvec_schedule, local_matvec_items, in, local_offset_s, out, plan);
+
+    // Remote blocks may also need the local part of the source, the rest of work is not read
+    std::copy_n(in, std::size_t(local_size_s) * mu, work + std::size_t(local_offset_s) * mu);
+    MPI_Waitall(nb_requests, plan.get_requests(nb_requests), MPI_STATUSES_IGNORE);
+    run_matvec_items(matvec_schedule, matvec_items, work, 0, out, plan);
+
+    add_mat_vec_prod_time(MPI_Wtime() - time);
+}
+
+// Messages between two processes are matched in the order of their intervals, returns the number of requests
+template <typename T>
+int HMatrix<T>::post_halo_exchange(const T *const in, T *work, MatvecPlan<T> &plan) const {
+    int mu                = plan.get_mu();
+    int local_offset_s    = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int nb_requests       = halo_recvs.size() + halo_sends.size();
+    MPI_Request *requests = plan.get_requests(nb_requests);
+    for (int i = 0; i < halo_recvs.size(); i++) {
+        MPI_Irecv(work + std::size_t(halo_recvs[i].offset) * mu, halo_recvs[i].size * mu, wrapper_mpi<T>::mpi_type(), halo_recvs[i].rank, 0, comm, &(requests[i]));
+    }
+    for (int i = 0; i < halo_sends.size(); i++) {
+        MPI_Isend(in + std::size_t(halo_sends[i].offset - local_offset_s) * mu, halo_sends[i].size * mu, wrapper_mpi<T>::mpi_type(), halo_sends[i].rank, 0, comm, &(requests[halo_recvs.size() + i]));
+    }
+    return nb_requests;
+}
+
+template <typename T>
+typename HMatrix<T>::MatvecRequest HMatrix<T>::mvprod_async(const T *const in, T *const out, MatvecPlan<T> &plan) const {
+    if (!(cluster_tree_s->IsLocal()) || !(cluster_tree_t->IsLocal())) {
+        throw std::logic_error("[Htool error] Permutation is not local, mvprod_async cannot be used"); // LCOV_EXCL_LINE
     }
-    this->local_to_global_source(in, work, mu);
-    this->mymvprod_global_to_local(work, out, mu);
+    MatvecRequest request;
+    request.time          = MPI_Wtime();
+    int mu                = plan.get_mu();
+    int local_size_source = plan.get_local_source_size();
+    int local_offset_s    = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int local_size_s      = cluster_tree_s->get_masteroffset(rankWorld).second;
+
+    // Source in the numbering of the clusters, so that in is not read after returning
+    T *in_perm = plan.get_in_perm(std::size_t(local_size_source) * mu);
+    if (mu == 1) {
+        if (use_permutation) {
+            this->local_source_to_local_cluster(in, in_perm, comm);
+        } else {
+            std::copy_n(in, local_size_source, in_perm);
+        }
+    } else {
+        const int *local_perm = use_permutation ? cluster_tree_s->get_perm().data() + local_offset_s : nullptr;
+        gather_transpose(local_size_source, mu, local_perm, local_offset_s, in, local_size_source, in_perm, symmetry == 'H');
+    }
+
+    request.hmatrix     = this;
+    request.plan        = &plan;
+    request.out         = out;
+    request.out_perm    = plan.get_out_perm(std::size_t(local_size) * mu);
+    request.work        = plan.get_work(std::size_t(this->nc) * mu);
+    request.nb_requests = post_halo_exchange(in_perm, request.work, plan);
+
+    // Same blocks as mymvprod_local_to_local before waiting for the halo
+    T *out_perm            = request.out_perm;
+    T *work                = request.work;
+    request.local_products = std::async(std::launch::async, [=, &plan]() {
+        std::fill_n(out_perm, std::size_t(local_size) * mu, T(0));
+        run_matvec_items(local_matvec_schedule, local_matvec_items, in_perm, local_offset_s, out_perm, plan);
+        std::copy_n(in_perm, std::size_t(local_size_s) * mu, work + std::size_t(local_offset_s) * mu);
+    });
+    return request;
+}
+
+template <typename T>
+void HMatrix<T>::MatvecRequest::finish() {
+    const HMatrix &H = *hmatrix;
+    int mu           = plan->get_mu();
+    hmatrix          = nullptr;
+    local_products.get();
+    MPI_Waitall(nb_requests, plan->get_requests(nb_requests), MPI_STATUSES_IGNORE);
+    H.run_matvec_items(H.matvec_schedule, H.matvec_items, work, 0, out_perm, *plan);
 
-    if (need_delete) {
-        delete[] work;
-        work = nullptr;
+    if (mu == 1) {
+        if (H.use_permutation) {
+            H.local_cluster_to_local_target(out_perm, out, H.comm);
+        } else {
+            std::copy_n(out_perm, H.local_size, out);
+        }
+    } else {
+        const int *local_perm = H.use_permutation ? H.cluster_tree_t->get_perm().data() + H.local_offset : nullptr;
+        scatter_transpose(H.local_size, mu, local_perm, H.local_offset, out_perm, out, H.local_size, H.symmetry == 'H');
     }
-    infos["nb_mat_vec_prod"]         = NbrToStr(1 + StrToNbr<int>(infos["nb_mat_vec_prod"]));
-    infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime() - time + StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+    H.add_mat_vec_prod_time(MPI_Wtime() - time);
 }
 
+// Same exchange of the halo as mymvprod_local_to_local, the mu columns of each interval are packed in the halo buffer of the plan
 template <typename T>
-void HMatrix<T>::mymvprod_transp_local_to_local(const T *const in, T *const out, const int &mu, T *work) const {
-    int local_size_source = cluster_tree_s->get_masteroffset(rankWorld).second;
+void HMatrix<T>::mymvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, MatvecPlan<T> &plan) const {
+    double time        = MPI_Wtime();
+    int mu             = plan.get_mu();
+    int local_offset_s = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int local_size_s   = cluster_tree_s->get_masteroffset(rankWorld).second;
 
+    // Halo received in rbuf and local intervals packed in sbuf, interval after interval
+    std::size_t recv_size = 0, send_size = 0;
+    for (const HaloInterval &interval : halo_recvs) {
+        recv_size += interval.size;
+    }
+    for (const HaloInterval &interval : halo_sends) {
+        send_size += interval.size;
+    }
+    T *work               = plan.get_work(std::size_t(this->nc) * mu);
+    T *rbuf               = plan.get_halo((recv_size + send_size) * mu);
+    T *sbuf               = rbuf + recv_size * mu;
+    MPI_Request *requests = plan.get_requests(halo_recvs.size() + halo_sends.size());
+    T *rbuf_interval      = rbuf;
+    for (int i = 0; i < halo_recvs.size(); i++) {
+        MPI_Irecv(rbuf_interval, halo_recvs[i].size * mu, wrapper_mpi<T>::mpi_type(), halo_recvs[i].rank, 0, comm, &(requests[i]));
+        rbuf_interval += std::size_t(halo_recvs[i].size) * mu;
+    }
+    T *sbuf_interval = sbuf;
+    for (int i = 0; i < halo_sends.size(); i++) {
+        for (int k = 0; k < mu; k++) {
+            std::copy_n(in + std::size_t(k) * ldin + halo_sends[i].offset - local_offset_s, halo_sends[i].size, sbuf_interval + std::size_t(k) * halo_sends[i].size);
+        }
+        MPI_Isend(sbuf_interval, halo_sends[i].size * mu, wrapper_mpi<T>::mpi_type(), halo_sends[i].rank, 0, comm, &(requests[halo_recvs.size() + i]));
+        sbuf_interval += std::size_t(halo_sends[i].size) * mu;
+    }
+
+    for (int i = 0; i < mu; i++) {
+        std::fill_n(out + std::size_t(i) * ldout, local_size, T(0));
+    }
+    run_matvec_items_col_major(local_matvec_schedule, local_matvec_items, in, local_offset_s, ldin, out, ldout, plan);
+
+    for (int i = 0; i < mu; i++) {
+        std::copy_n(in + std::size_t(i) * ldin, local_size_s, work + std::size_t(i) * this->nc + local_offset_s);
+    }
+    MPI_Waitall(halo_recvs.size() + halo_sends.size(), requests, MPI_STATUSES_IGNORE);
+    rbuf_interval = rbuf;
+    for (int i = 0; i < halo_recvs.size(); i++) {
+        for (int k = 0; k < mu; k++) {
+            std::copy_n(rbuf_interval + std::size_t(k) * halo_recvs[i].size, halo_recvs[i].size, work + std::size_t(k) * this->nc + halo_recvs[i].offset);
+        }
+        rbuf_interval += std::size_t(halo_recvs[i].size) * mu;
+    }
+    run_matvec_items_col_major(matvec_schedule, matvec_items, work, 0, this->nc, out, ldout, plan);
+
+    add_mat_vec_prod_time(MPI_Wtime() - time);
+}
+
+template <typename T>
+void HMatrix<T>::mymvprod_transp_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work) const {
     if (this->symmetry == 'S' || this->symmetry == 'H') {
-        this->mymvprod_local_to_local(in, out, mu, work);
+        this->mymvprod_local_to_local(in, out, plan, work);
         return;
     }
 
-    double time      = MPI_Wtime();
-    bool need_delete = false;
+    double time           = MPI_Wtime();
+    int mu                = plan.get_mu();
+    int local_offset_s    = cluster_tree_s->get_masteroffset(rankWorld).first;
+    int local_size_s      = cluster_tree_s->get_masteroffset(rankWorld).second;
+    std::size_t halo_size = 0;
+    for (const HaloInterval &interval : halo_sends) {
+        halo_size += interval.size;
+    }
     if (work == nullptr) {
-        work        = new T[(this->nc + local_size_source * sizeWorld) * mu];
-        need_delete = true;
+        work = plan.get_work(std::size_t(this->nc) * mu);
     }
+    T *rbuf = plan.get_halo(halo_size * mu);
 
-    std::fill(out, out + local_size_source * mu, 0);
-    int incx(1), incy(1);
-    int global_size_rhs = this->nc * mu;
-    T da(1);
-
-    std::fill(work, work + this->nc * mu, 0);
-    T *rbuf = work + this->nc * mu;
+    // Only the local part and the halo of the source are written by the blocks
+    std::fill(work + std::size_t(local_offset_s) * mu, work + std::size_t(local_offset_s + local_size_s) * mu, 0);
+    for (const HaloInterval &interval : halo_recvs) {
+        std::fill(work + std::size_t(interval.offset) * mu, work + std::size_t(interval.offset + interval.size) * mu, 0);
+    }
 
-    // Contribution champ lointain
+    // Every block adds its contribution directly to work, columns are written by one thread at a time
 #if _OPENMP
 #    pragma omp parallel
 #endif
     {
-        std::vector<T> temp(this->nc * mu, 0);
-#if _OPENMP
-#    pragma omp for schedule(guided) nowait
-#endif
-        for (int b = 0; b < MyComputedBlocks.size(); b++) {
-            int offset_i = MyComputedBlocks[b]->get_offset_i();
-            int offset_j = MyComputedBlocks[b]->get_offset_j();
-            if (!(symmetry != 'N') || offset_i != offset_j) { // remove strictly diagonal blocks
-                MyComputedBlocks[b]->add_mvprod_row_major(in + (offset_i - local_offset) * mu, temp.data() + offset_j * mu, mu, 'T', 'T');
-            }
-        }
-
-#if _OPENMP
-#    pragma omp critical
-#endif
-        Blas<T>::axpy(&(global_size_rhs), &da, temp.data(), &incx, work, &incy);
+        T *lrmat_work = plan.get_lrmat_work();
+        transp_matvec_schedule.run([&](int item) {
+            const MatvecItem &matvec_item = transp_matvec_items[item];
+            const IMatrix<T> &M           = *(MyComputedBlocks[matvec_item.index]);
+            add_item_mvprod(M, matvec_item.lrmat, lrmat_work, in + (M.get_offset_i() - local_offset) * mu, work + M.get_offset_j() * mu, mu, 'T', 'T');
+        });
     }
 
-    std::vector<int> scounts(sizeWorld), rcounts(sizeWorld);
-    std::vector<int> sdispls(sizeWorld), rdispls(sizeWorld);
-
-    sdispls[0] = 0;
-    rdispls[0] = 0;
-
-    for (int i = 0; i < sizeWorld; i++) {
-        scounts[i] = (cluster_tree_s->get_masteroffset(i).second) * mu;
-        rcounts[i] = (local_size_source)*mu;
-        if (i > 0) {
-            sdispls[i] = sdispls[i - 1] + scounts[i - 1];
-            rdispls[i] = rdispls[i - 1] + rcounts[i - 1];
-        }
+    // Sparse reduce-scatter: contributions to the halo go back to their owner, the reverse of mymvprod_local_to_local
+    MPI_Request *requests = plan.get_requests(halo_recvs.size() + halo_sends.size());
+    T *rbuf_interval      = rbuf;
+    for (int i = 0; i < halo_sends.size(); i++) {
+        MPI_Irecv(rbuf_interval, halo_sends[i].size * mu, wrapper_mpi<T>::mpi_type(), halo_sends[i].rank, 0, comm, &(requests[i]));
+        rbuf_interval += std::size_t(halo_sends[i].size) * mu;
     }
+    for (int i = 0; i < halo_recvs.size(); i++) {
+        MPI_Isend(work + std::size_t(halo_recvs[i].offset) * mu, halo_recvs[i].size * mu, wrapper_mpi<T>::mpi_type(), halo_recvs[i].rank, 0, comm, &(requests[halo_sends.size() + i]));
+    }
+    std::copy_n(work + std::size_t(local_offset_s) * mu, std::size_t(local_size_s) * mu, out);
+    MPI_Waitall(halo_recvs.size() + halo_sends.size(), requests, MPI_STATUSES_IGNORE);
 
-    MPI_Alltoallv(work, &(scounts[0]), &(sdispls[0]), wrapper_mpi<T>::mpi_type(), rbuf, &(rcounts[0]), &(rdispls[0]), wrapper_mpi<T>::mpi_type(), comm);
-
-    for (int i = 0; i < sizeWorld; i++)
-        std::transform(out, out + local_size_source * mu, rbuf + rdispls[i], out, std::plus<T>());
-
-    if (need_delete) {
-        delete[] work;
-        work = nullptr;
+    rbuf_interval = rbuf;
+    for (int i = 0; i < halo_sends.size(); i++) {
+        T *out_interval = out + std::size_t(halo_sends[i].offset - local_offset_s) * mu;
+        std::transform(out_interval, out_interval + std::size_t(halo_sends[i].size) * mu, rbuf_interval, out_interval, std::plus<T>());
+        rbuf_interval += std::size_t(halo_sends[i].size) * mu;
     }
-    infos["nb_mat_vec_prod"]         = NbrToStr(1 + StrToNbr<int>(infos["nb_mat_vec_prod"]));
-    infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime() - time + StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+
+    add_mat_vec_prod_time(MPI_Wtime() - time);
 }
 
 template <typename T>
-void HMatrix<T>::mvprod_global_to_global(const T *const in, T *const out, const int &mu) const {
+void HMatrix<T>::mvprod_global_to_global(const T *const in, T *const out, MatvecPlan<T> &plan) const {
     double time = MPI_Wtime();
+    int mu      = plan.get_mu();
+
+    // Allgather
+    const std::vector<int> &recvcounts = plan.get_target_counts();
+    const std::vector<int> &displs     = plan.get_target_displs();
 
     if (mu == 1) {
-        std::vector<T> out_perm(local_size);
-        std::vector<T> buffer(std::max(nc, nr));
+        T *out_perm = plan.get_out_perm(local_size);
+        T *buffer   = plan.get_buffer(std::max(nc, nr));
 
         // Permutation
         if (use_permutation) {
-            this->source_to_cluster_permutation(in, buffer.data());
-            mymvprod_global_to_local(buffer.data(), out_perm.data(), 1);
+            this->source_to_cluster_permutation(in, buffer);
+            mymvprod_global_to_local(buffer, out_perm, plan);
 
         } else {
-            mymvprod_global_to_local(in, out_perm.data(), 1);
-        }
-
-        // Allgather
-        std::vector<int> recvcounts(sizeWorld);
-        std::vector<int> displs(sizeWorld);
-
-        displs[0] = 0;
-
-        for (int i = 0; i < sizeWorld; i++) {
-            recvcounts[i] = cluster_tree_t->get_masteroffset(i).second * mu;
-            if (i > 0)
-                displs[i] = displs[i - 1] + recvcounts[i - 1];
+            mymvprod_global_to_local(in, out_perm, plan);
         }
 
         if (use_permutation) {
-            MPI_Allgatherv(out_perm.data(), recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), buffer.data(), &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
+            MPI_Allgatherv(out_perm, recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), buffer, recvcounts.data(), displs.data(), wrapper_mpi<T>::mpi_type(), comm);
 
             // Permutation
-            this->cluster_to_target_permutation(buffer.data(), out);
+            this->cluster_to_target_permutation(buffer, out);
         } else {
-            MPI_Allgatherv(out_perm.data(), recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), out, &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
+            MPI_Allgatherv(out_perm, recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), out, recvcounts.data(), displs.data(), wrapper_mpi<T>::mpi_type(), comm);
         }
 
     } else {
+        T *in_perm  = plan.get_in_perm(std::size_t(nc) * mu);
+        T *out_perm = plan.get_out_perm(std::size_t(local_size) * mu);
+        T *buffer   = plan.get_buffer(std::size_t(nr) * mu);
 
-        std::vector<T> in_perm(std::max(nr, nc) * mu * 2);
-        std::vector<T> out_perm(local_size * mu);
-        std::vector<T> buffer(nc);
-
-        for (int i = 0; i < mu; i++) {
-            // Permutation
-            if (use_permutation) {
-                this->source_to_cluster_permutation(in + i * nc, buffer.data());
-                // Transpose
-                for (int j = 0; j < nc; j++) {
-                    in_perm[i + j * mu] = buffer[j];
-                }
-            } else {
-                // Transpose
-                for (int j = 0; j < nc; j++) {
-                    in_perm[i + j * mu] = in[j + i * nc];
-                }
-            }
-        }
-
-        if (symmetry == 'H') {
-            conj_if_complex(in_perm.data(), nc * mu);
-        }
-
-        mymvprod_global_to_local(in_perm.data(), in_perm.data() + nc * mu, mu);
-
-        // Tranpose
-        for (int i = 0; i < mu; i++) {
-            for (int j = 0; j < local_size; j++) {
-                out_perm[i * local_size + j] = in_perm[i + j * mu + nc * mu];
-            }
-        }
-
-        if (symmetry == 'H') {
-            conj_if_complex(out_perm.data(), out_perm.size());
-        }
-
-        // Allgather
-        std::vector<int> recvcounts(sizeWorld);
-        std::vector<int> displs(sizeWorld);
-
-        displs[0] = 0;
-
-        for (int i = 0; i < sizeWorld; i++) {
-            recvcounts[i] = cluster_tree_t->get_masteroffset(i).second * mu;
-            if (i > 0)
-                displs[i] = displs[i - 1] + recvcounts[i - 1];
-        }
-
-        MPI_Allgatherv(out_perm.data(), recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), in_perm.data() + mu * nr, &(recvcounts[0]), &(displs[0]), wrapper_mpi<T>::mpi_type(), comm);
-
-        for (int i = 0; i < mu; i++) {
-            if (use_permutation) {
-                for (int j = 0; j < sizeWorld; j++) {
-                    std::copy_n(in_perm.data() + mu * nr + displs[j] + i * recvcounts[j] / mu, recvcounts[j] / mu, in_perm.data() + i * nr + displs[j] / mu);
-                }
-
-                // Permutation
-                this->cluster_to_target_permutation(in_perm.data() + i * nr, out + i * nr);
-            } else {
-                for (int j = 0; j < sizeWorld; j++) {
-                    std::copy_n(in_perm.data() + mu * nr + displs[j] + i * recvcounts[j] / mu, recvcounts[j] / mu, out + i * nr + displs[j] / mu);
-                }
-            }
-        }
+        // Permutation and transpose, the local results gathered in order form the whole row-major result
+        gather_transpose(nc, mu, use_permutation ? cluster_tree_s->get_perm().data() : nullptr, 0, in, nc, in_perm, symmetry == 'H');
+        mymvprod_global_to_local(in_perm, out_perm, plan);
+        MPI_Allgatherv(out_perm, recvcounts[rankWorld], wrapper_mpi<T>::mpi_type(), buffer, recvcounts.data(), displs.data(), wrapper_mpi<T>::mpi_type(), comm);
+        scatter_transpose(nr, mu, use_permutation ? cluster_tree_t->get_perm().data() : nullptr, 0, buffer, out, nr, symmetry == 'H');
     }
     // Timing
-    infos["nb_mat_vec_prod"]         = NbrToStr(1 + StrToNbr<int>(infos["nb_mat_vec_prod"]));
-    infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime() - time + StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+    add_mat_vec_prod_time(MPI_Wtime() - time);
 }
 
 template <typename T>
-void HMatrix<T>::mvprod_local_to_local(const T *const in, T *const out, const int &mu, T *work) const {
-    double time      = MPI_Wtime();
-    bool need_delete = false;
-    if (work == nullptr) {
-        work        = new T[this->nc * mu];
-        need_delete = true;
-    }
-
-    int local_size_source = cluster_tree_s->get_masteroffset(rankWorld).second;
+void HMatrix<T>::mvprod_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work) const {
+    double time           = MPI_Wtime();
+    int mu                = plan.get_mu();
+    int local_size_source = plan.get_local_source_size();
 
     if (!(cluster_tree_s->IsLocal()) || !(cluster_tree_t->IsLocal())) {
         throw std::logic_error("[Htool error] Permutation is not local, mvprod_local_to_local cannot be used"); // LCOV_EXCL_LINE
     }
     if (mu == 1) {
-        std::vector<T> in_perm(local_size_source), out_perm(local_size);
+        T *in_perm  = plan.get_in_perm(local_size_source);
+        T *out_perm = plan.get_out_perm(local_size);
 
         // local permutation
         if (use_permutation) {
             // permutation
-            this->local_source_to_local_cluster(in, in_perm.data());
+            this->local_source_to_local_cluster(in, in_perm);
 
             // prod
-            mymvprod_local_to_local(in_perm.data(), out_perm.data(), 1, work);
+            mymvprod_local_to_local(in_perm, out_perm, plan, work);
 
             // permutation
-            this->local_cluster_to_local_target(out_perm.data(), out, comm);
+            this->local_cluster_to_local_target(out_perm, out, comm);
 
         } else {
-            mymvprod_local_to_local(in, out, 1, work);
+            mymvprod_local_to_local(in, out, plan, work);
         }
 
     } else {
+        T *in_perm            = plan.get_in_perm(std::size_t(local_size_source) * mu);
+        T *out_perm           = plan.get_out_perm(std::size_t(local_size) * mu);
+        int local_offset_s    = cluster_tree_s->get_masteroffset(rankWorld).first;
+        const int *local_perm = use_permutation ? cluster_tree_s->get_perm().data() + local_offset_s : nullptr;
+        gather_transpose(local_size_source, mu, local_perm, local_offset_s, in, local_size_source, in_perm, symmetry == 'H');
 
-        std::vector<T> in_perm(local_size_source * mu);
-        std::vector<T> out_perm(local_size * mu);
-        std::vector<T> buffer(std::max(local_size_source, local_size));
+        mymvprod_local_to_local(in_perm, out_perm, plan, work);
 
-        for (int i = 0; i < mu; i++) {
-            // local permutation
-            if (use_permutation) {
-                this->local_source_to_local_cluster(in + i * local_size_source, buffer.data());
+        local_perm = use_permutation ? cluster_tree_t->get_perm().data() + local_offset : nullptr;
+        scatter_transpose(local_size, mu, local_perm, local_offset, out_perm, out, local_size, symmetry == 'H');
+    }
 
-                // Transpose
-                for (int j = 0; j < local_size_source; j++) {
-                    in_perm[i + j * mu] = buffer[j];
-                }
-            } else {
-                // Transpose
-                for (int j = 0; j < local_size_source; j++) {
-                    in_perm[i + j * mu] = in[j + i * local_size_source];
-                }
-            }
-        }
+    // Timing
+    add_mat_vec_prod_time(MPI_Wtime() - time);
+}
 
-        if (symmetry == 'H') {
-            conj_if_complex(in_perm.data(), local_size_source * mu);
-        }
+// Only the permutations are copies, without permutation in and out are used directly
+template <typename T>
+void HMatrix<T>::mvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, MatvecPlan<T> &plan) const {
+    int mu                = plan.get_mu();
+    int local_size_source = plan.get_local_source_size();
 
-        mymvprod_local_to_local(in_perm.data(), out_perm.data(), mu, work);
+    if (!(cluster_tree_s->IsLocal()) || !(cluster_tree_t->IsLocal())) {
+        throw std::logic_error("[Htool error] Permutation is not local, mvprod_local_to_local_col_major cannot be used"); // LCOV_EXCL_LINE
+    }
 
+    if (use_permutation) {
+        T *in_perm  = plan.get_in_perm(std::size_t(local_size_source) * mu);
+        T *out_perm = plan.get_out_perm(std::size_t(local_size) * mu);
         for (int i = 0; i < mu; i++) {
-            if (use_permutation) {
-                // Tranpose
-                for (int j = 0; j < local_size; j++) {
-                    buffer[j] = out_perm[i + j * mu];
-                }
-
-                // local permutation
-                this->local_cluster_to_local_target(buffer.data(), out + i * local_size);
-            } else {
-                // Tranpose
-                for (int j = 0; j < local_size; j++) {
-                    out[j + i * local_size] = out_perm[i + j * mu];
-                }
-            }
+            this->local_source_to_local_cluster(in + std::size_t(i) * ldin, in_perm + std::size_t(i) * local_size_source, comm);
         }
 
-        if (symmetry == 'H') {
-            conj_if_complex(out, out_perm.size());
-        }
-    }
+        mymvprod_local_to_local_col_major(in_perm, local_size_source, out_perm, local_size, plan);
 
-    if (need_delete) {
-        delete[] work;
-        work = nullptr;
+        for (int i = 0; i < mu; i++) {
+            this->local_cluster_to_local_target(out_perm + std::size_t(i) * local_size, out + std::size_t(i) * ldout, comm);
+        }
+    } else {
+        mymvprod_local_to_local_col_major(in, ldin, out, ldout, plan);
     }
-    // Timing
-    infos["nb_mat_vec_prod"]         = NbrToStr(1 + StrToNbr<int>(infos["nb_mat_vec_prod"]));
-    infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime() - time + StrToNbr<double>(infos["total_time_mat_vec_prod"]));
 }
 
 template <typename T>
-void HMatrix<T>::mvprod_transp_global_to_global(const T *const in, T *const out, const int &mu) const {
+void HMatrix<T>::mvprod_transp_global_to_global(const T *const in, T *const out, MatvecPlan<T> &plan) const {
     double time = MPI_Wtime();
+    int mu      = plan.get_mu();
     if (this->symmetry == 'S') {
-        this->mvprod_global_to_global(in, out, mu);
+        this->mvprod_global_to_global(in, out, plan);
         return;
     } else if (this->symmetry == 'H') {
-        std::vector<T> in_conj(in, in + nr * mu);
-        conj_if_complex(in_conj.data(), nr * mu);
-        this->mvprod_global_to_global(in_conj.data(), out, mu);
+        T *in_conj = plan.get_in_conj(std::size_t(nr) * mu);
+        std::copy_n(in, nr * mu, in_conj);
+        conj_if_complex(in_conj, nr * mu);
+        this->mvprod_global_to_global(in_conj, out, plan);
         conj_if_complex(out, mu * nc);
         return;
     }
     if (mu == 1) {
 
         if (use_permutation) {
-            std::vector<T> in_perm(nr), out_perm(nc);
+            T *in_perm  = plan.get_in_perm(nr);
+            T *out_perm = plan.get_out_perm(nc);
 
             // permutation
-            this->target_to_cluster_permutation(in, in_perm.data());
+            this->target_to_cluster_permutation(in, in_perm);
 
-            mymvprod_transp_local_to_global(in_perm.data() + local_offset, out_perm.data(), 1);
+            mymvprod_transp_local_to_global(in_perm + local_offset, out_perm, plan);
 
             // permutation
-            this->cluster_to_source_permutation(out_perm.data(), out);
+            this->cluster_to_source_permutation(out_perm, out);
         } else {
-            mymvprod_transp_local_to_global(in + local_offset, out, 1);
+            mymvprod_transp_local_to_global(in + local_offset, out, plan);
         }
 
     } else {
+        T *in_perm  = plan.get_in_perm(std::size_t(local_size) * mu);
+        T *out_perm = plan.get_out_perm(std::size_t(nc) * mu);
 
-        std::vector<T> out_perm(mu * nc);
-        std::vector<T> in_perm(local_size * mu + mu * nc);
-        std::vector<T> buffer(nr);
-
-        for (int i = 0; i < mu; i++) {
-            // Permutation
-            if (use_permutation) {
-                this->target_to_cluster_permutation(in + i * nr, buffer.data());
-                // Transpose
-                for (int j = local_offset; j < local_offset + local_size; j++) {
-                    in_perm[i + (j - local_offset) * mu] = buffer[j];
-                }
-            } else {
-                // Transpose
-                for (int j = local_offset; j < local_offset + local_size; j++) {
-                    in_perm[i + (j - local_offset) * mu] = in[j + i * nr];
-                }
-            }
-        }
-
-        if (symmetry == 'H') {
-            conj_if_complex(in_perm.data(), local_size * mu);
+        // Local rows of the target only
+        if (use_permutation) {
+            gather_transpose(local_size, mu, cluster_tree_t->get_perm().data() + local_offset, 0, in, nr, in_perm, symmetry == 'H');
+        } else {
+            gather_transpose(local_size, mu, nullptr, 0, in + local_offset, nr, in_perm, symmetry == 'H');
         }
 
-        mymvprod_transp_local_to_global(in_perm.data(), in_perm.data() + local_size * mu, mu);
-
-        for (int i = 0; i < mu; i++) {
-            if (use_permutation) {
-                // Transpose
-                for (int j = 0; j < nc; j++) {
-                    out_perm[i * nc + j] = in_perm[i + j * mu + local_size * mu];
-                }
-                cluster_to_source_permutation(out_perm.data() + i * nc, out + i * nc);
-            } else {
-                for (int j = 0; j < nc; j++) {
-                    out[i * nc + j] = in_perm[i + j * mu + local_size * mu];
-                }
-            }
-        }
+        mymvprod_transp_local_to_global(in_perm, out_perm, plan);
 
-        if (symmetry == 'H') {
-            conj_if_complex(out, nc * mu);
-        }
+        scatter_transpose(nc, mu, use_permutation ? cluster_tree_s->get_perm().data() : nullptr, 0, out_perm, out, nc, symmetry == 'H');
     }
     // Timing
-    infos["nb_mat_vec_prod"]         = NbrToStr(1 + StrToNbr<int>(infos["nb_mat_vec_prod"]));
-    infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime() - time + StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+    add_mat_vec_prod_time(MPI_Wtime() - time);
 }
 
 template <typename T>
-void HMatrix<T>::mvprod_transp_local_to_local(const T *const in, T *const out, const int &mu, T *work) const {
+void HMatrix<T>::mvprod_transp_local_to_local(const T *const in, T *const out, MatvecPlan<T> &plan, T *work) const {
     double time           = MPI_Wtime();
-    int local_size_source = cluster_tree_s->get_masteroffset(rankWorld).second;
+    int mu                = plan.get_mu();
+    int local_size_source = plan.get_local_source_size();
     if (this->symmetry == 'S') {
-        this->mvprod_local_to_local(in, out, mu);
+        this->mvprod_local_to_local(in, out, plan);
         return;
     } else if (this->symmetry == 'H') {
-        std::vector<T> in_conj(in, in + local_size * mu);
-        conj_if_complex(in_conj.data(), local_size * mu);
-        this->mvprod_local_to_local(in_conj.data(), out, mu);
+        T *in_conj = plan.get_in_conj(std::size_t(local_size) * mu);
+        std::copy_n(in, local_size * mu, in_conj);
+        conj_if_complex(in_conj, local_size * mu);
+        this->mvprod_local_to_local(in_conj, out, plan);
         conj_if_complex(out, mu * local_size_source);
         return;
     }
-    bool need_delete = false;
-    if (work == nullptr) {
-        work        = new T[(this->nc + sizeWorld * this->get_source_cluster()->get_local_size()) * mu];
-        need_delete = true;
-    }
 
     if (!(cluster_tree_s->IsLocal()) || !(cluster_tree_t->IsLocal())) {
         throw std::logic_error("[Htool error] Permutation is not local, mvprod_local_to_local cannot be used"); // LCOV_EXCL_LINE
     }
 
     if (mu == 1) {
-        std::vector<T> in_perm(local_size), out_perm(local_size_source);
+        T *in_perm  = plan.get_in_perm(local_size);
+        T *out_perm = plan.get_out_perm(local_size_source);
 
         // local permutation
         if (use_permutation) {
-            this->local_target_to_local_cluster(in, in_perm.data());
+            this->local_target_to_local_cluster(in, in_perm);
 
             // prod
-            mymvprod_transp_local_to_local(in_perm.data(), out_perm.data(), 1, work);
+            mymvprod_transp_local_to_local(in_perm, out_perm, plan, work);
 
             // permutation
-            this->local_cluster_to_local_source(out_perm.data(), out, comm);
+            this->local_cluster_to_local_source(out_perm, out, comm);
 
         } else {
-            mymvprod_transp_local_to_local(in, out, 1, work);
+            mymvprod_transp_local_to_local(in, out, plan, work);
         }
 
     } else {
+        T *in_perm            = plan.get_in_perm(std::size_t(local_size) * mu);
+        T *out_perm           = plan.get_out_perm(std::size_t(local_size_source) * mu);
+        const int *local_perm = use_permutation ? cluster_tree_t->get_perm().data() + local_offset : nullptr;
+        gather_transpose(local_size, mu, local_perm, local_offset, in, local_size, in_perm, symmetry == 'H');
 
-        std::vector<T> in_perm(local_size * mu);
-        std::vector<T> out_perm(local_size_source * mu);
-        std::vector<T> buffer(std::max(local_size_source, local_size));
-
-        for (int i = 0; i < mu; i++) {
-            // local permutation
-            if (use_permutation) {
-                this->local_target_to_local_cluster(in + i * local_size, buffer.data());
-
-                // Transpose
-                for (int j = 0; j < local_size; j++) {
-                    in_perm[i + j * mu] = buffer[j];
-                }
-            } else {
-                // Transpose
-                for (int j = 0; j < local_size; j++) {
-                    in_perm[i + j * mu] = in[j + i * local_size];
-                }
-            }
-        }
-
-        if (symmetry == 'H') {
-            conj_if_complex(in_perm.data(), local_size_source * mu);
-        }
-
-        mymvprod_transp_local_to_local(in_perm.data(), out_perm.data(), mu, work);
-
-        for (int i = 0; i < mu; i++) {
-            if (use_permutation) {
-                // Tranpose
-                for (int j = 0; j < local_size_source; j++) {
-                    buffer[j] = out_perm[i + j * mu];
-                }
-
-                // local permutation
-                this->local_cluster_to_local_source(buffer.data(), out + i * local_size_source);
-            } else {
-                // Tranpose
-                for (int j = 0; j < local_size_source; j++) {
-                    out[j + i * local_size_source] = out_perm[i + j * mu];
-                }
-            }
-        }
+        mymvprod_transp_local_to_local(in_perm, out_perm, plan, work);
 
-        if (symmetry == 'H') {
-            conj_if_complex(out, out_perm.size());
-        }
+        int local_offset_s = cluster_tree_s->get_masteroffset(rankWorld).first;
+        local_perm         = use_permutation ? cluster_tree_s->get_perm().data() + local_offset_s : nullptr;
+        scatter_transpose(local_size_source, mu, local_perm, local_offset_s, out_perm, out, local_size_source, symmetry == 'H');
     }
 
-    if (need_delete) {
-        delete[] work;
-        work = nullptr;
-    }
     // Timing
-    infos["nb_mat_vec_prod"]         = NbrToStr(1 + StrToNbr<int>(infos["nb_mat_vec_prod"]));
-    infos["total_time_mat_vec_prod"] = NbrToStr(MPI_Wtime() - time + StrToNbr<double>(infos["total_time_mat_vec_prod"]));
+    add_mat_vec_prod_time(MPI_Wtime() - time);
 }
 
 template <typename T>
@@ -1665,6 +2276,7 @@ template <typename T>
 void HMatrix<T>::print_infos() const {
     int rankWorld;
     MPI_Comm_rank(comm, &rankWorld);
+    update_mat_vec_prod_infos();
 
     if (rankWorld == 0) {
         for (std::map<std::string, std::string>::const_iterator it = infos.begin(); it != infos.end(); ++it) {
@@ -1678,6 +2290,7 @@ template <typename T>
 void HMatrix<T>::save_infos(const std::string &outputname, std::ios_base::openmode mode, const std::string &sep) const {
     int rankWorld;
     MPI_Comm_rank(comm, &rankWorld);
+    update_mat_vec_prod_infos();
 
     if (rankWorld == 0) {
         std::ofstream outputfile(outputname, mode);
@@ -1700,10 +2313,10 @@ void HMatrix<T>::save_plot(const std::string &outputname) const {
     if (outputfile) {
         outputfile << nr << "," << nc << std::endl;
         for (typename std::vector<SubMatrix<T> *>::const_iterator it = MyNearFieldMats.begin(); it != MyNearFieldMats.end(); ++it) {
-            outputfile << (*it)->get_offset_i() << "," << (*it)->get_ir().size() << "," << (*it)->get_offset_j() << "," << (*it)->get_ic().size() << "," << -1 << std::endl;
+            outputfile << (*it)->get_offset_i() << "," << (*it)->nb_rows() << "," << (*it)->get_offset_j() << "," << (*it)->nb_cols() << "," << -1 << std::endl;
         }
         for (typename std::vector<LowRankMatrix<T> *>::const_iterator it = MyFarFieldMats.begin(); it != MyFarFieldMats.end(); ++it) {
-            outputfile << (*it)->get_offset_i() << "," << (*it)->get_ir().size() << "," << (*it)->get_offset_j() << "," << (*it)->get_ic().size() << "," << (*it)->rank_of() << std::endl;
+            outputfile << (*it)->get_offset_i() << "," << (*it)->nb_rows() / dimension << "," << (*it)->get_offset_j() << "," << (*it)->nb_cols() / dimension << "," << (*it)->rank_of() << std::endl;
         }
         outputfile.close();
     } else {
@@ -2002,6 +2615,21 @@ std::pair<int, int> HMatrix<T>::get_max_size_blocks() const {
     return std::pair<int, int>(local_max_size_i, local_max_size_j);
 }
 
+// Bytes of the local dense and low rank blocks coefficients
+template <typename T>
+std::size_t HMatrix<T>::get_payload_bytes() const {
+    std::size_t payload = 0;
+    for (int i = 0; i < MyFarFieldMats.size(); i++) {
+        // a zero rank block stores one column and one row
+        std::size_t rank = std::max(MyFarFieldMats[i]->rank_of(), 1);
+        payload += rank * (MyFarFieldMats[i]->nb_rows() + MyFarFieldMats[i]->nb_cols()) * sizeof(T);
+    }
+    for (int i = 0; i < MyNearFieldMats.size(); i++) {
+        payload += std::size_t(MyNearFieldMats[i]->nb_rows()) * MyNearFieldMats[i]->nb_cols() * sizeof(T);
+    }
+    return payload;
+}
+
 template <typename T>
 void HMatrix<T>::apply_dirichlet(const std::vector<int> &boundary) {
     // Renum
@@ -0,0 +1,243 @@
+#ifndef HTOOL_KERNEL_CACHE_HPP
+#define HTOOL_KERNEL_CACHE_HPP
+
+#include "../clustering/virtual_cluster.hpp"
+#include "virtual_generator.hpp"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+
+namespace htool {
+
+//=================================================================//
+//                       CLASS KERNEL CACHE
+//*****************************************************************//
+// Generator forwarding to another one and keeping the single rows and single
+// columns it computed, as requested by ACA compressors. Indices are expected
+// to point to the permutations given at construction, so that a row is stored
+// with its global index and the range of the source permutation it was computed
+// on, e.g. a source cluster. It then serves requests overlapping this range,
+// e.g. on a son of this cluster when an admissible block is refined after a
+// failed compression, and only the missing coefficients are computed (and
+// similarly for columns).
+// Rows are stored in the cache of the target leaf containing them, columns in
+// the cache of the source leaf, each with its own lock. Oldest rows and columns
+// of a leaf are evicted when the coefficients stored exceed the budget. Other
+// requests are forwarded.
+template <typename T>
+class KernelCache : public VirtualGenerator<T> {
+  private:
+    struct Entry {
+        int offset; // first position in the permutation the values were computed on
+        std::vector<T> values;
+    };
+    typedef std::multimap<int, Entry> Entries;
+
+    // Entries of a given index never overlap
+    struct Shard {
+        std::mutex mutex;
+        Entries entries;
+        std::deque<typename Entries::iterator> insertion_order;
+    };
+
+    const VirtualGenerator<T> &generator;
+    std::size_t budget;
+    const int *perm_t;
+    const int *perm_s;
+    std::vector<int> leaves_offsets_t, leaves_offsets_s;
+
+    // Storing is not part of the logical state of the generator
+    // rows are indexed by their global row index, columns by their global column index
+    mutable std::vector<Shard> rows_shards, cols_shards;
+    mutable std::atomic<std::size_t> stored_bytes;
+    mutable std::atomic<std::size_t> hits;
+    mutable std::atomic<std::size_t> misses;
+
+    static std::vector<int> leaves_offsets(const VirtualCluster &cluster) {
+        std::vector<int> offsets;
+        std::vector<const VirtualCluster *> stack{cluster.get_root()};
+        while (!stack.empty()) {
+            const VirtualCluster *current = stack.back();
+            stack.pop_back();
+            if (current->IsLeaf()) {
+                offsets.push_back(current->get_offset());
+            } else {
+                for (int p = current->get_nb_sons() - 1; p >= 0; p--) {
+                    stack.push_back(&(current->get_son(p)));
+                }
+            }
+        }
+        std::sort(offsets.begin(), offsets.end());
+        return offsets;
+    }
+
+    // Position of [indices, indices+size) in perm, -1 if it is not inside
+    static int position(const int *perm, int perm_size, const int *indices, int size) {
+        std::less<const int *> less;
+        if (less(indices, perm) || less(perm + perm_size, indices + size)) {
+            return -1;
+        }
+        return indices - perm;
+    }
+
+    static Shard &leaf_shard(std::vector<Shard> &shards, const std::vector<int> &offsets, int position) {
+        return shards[std::upper_bound(offsets.begin(), offsets.end(), position) - offsets.begin() - 1];
+    }
+
+    void evaluate(bool row, int index, int size, const int *indices, T *ptr) const {
+        if (row) {
+            generator.copy_submatrix(1, size, &index, indices, ptr);
+        } else {
+            generator.copy_submatrix(size, 1, indices, &index, ptr);
+        }
+    }
+
+    // Copies the stored values of index on the positions [offset, offset+size) and returns the positions missing
+    std::vector<std::pair<int, int>> lookup(const Entries &entries, int index, int offset, int size, T *ptr) const {
+        std::vector<std::pair<int, int>> covered;
+        auto range = entries.equal_range(index);
+        for (auto it = range.first; it != range.second; ++it) {
+            const Entry &entry = it->second;
+            int begin          = std::max(offset, entry.offset);
+            int end            = std::min(offset + size, entry.offset + int(entry.values.size()));
+            if (begin < end) {
+                std::copy(entry.values.begin() + (begin - entry.offset), entry.values.begin() + (end - entry.offset), ptr + (begin - offset));
+                covered.push_back(std::make_pair(begin, end));
+            }
+        }
+        std::sort(covered.begin(), covered.end());
+
+        std::vector<std::pair<int, int>> missing;
+        int current = offset;
+        for (auto &interval : covered) {
+            if (current < interval.first) {
+                missing.push_back(std::make_pair(current, interval.first));
+            }
+            current = interval.second;
+        }
+        if (current < offset + size) {
+            missing.push_back(std::make_pair(current, offset + size));
+        }
+        return missing;
+    }
+
+    // Reserves bytes in the budget, evicting the oldest entries of shard if needed
+    bool reserve(Shard &shard, std::size_t bytes) const {
+        std::size_t current = stored_bytes.load();
+        while (true) {
+            if (current + bytes <= budget) {
+                if (stored_bytes.compare_exchange_weak(current, current + bytes)) {
+                    return true;
+                }
+            } else if (!shard.insertion_order.empty()) {
+                auto oldest = shard.insertion_order.front();
+                stored_bytes -= oldest->second.values.size() * sizeof(T);
+                shard.entries.erase(oldest);
+                shard.insertion_order.pop_front();
+                current = stored_bytes.load();
+            } else {
+                return false;
+            }
+        }
+    }
+
+    void store(Shard &shard, int index, int offset, int size, const T *ptr) const {
+        std::size_t bytes = std::size_t(size) * sizeof(T);
+        if (bytes > budget) {
+            return;
+        }
+        // a concurrent miss may have stored it in the meantime
+        auto range = shard.entries.equal_range(index);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.offset < offset + size && offset < it->second.offset + int(it->second.values.size())) {
+                return;
+            }
+        }
+        if (reserve(shard, bytes)) {
+            auto it = shard.entries.insert(std::make_pair(index, Entry{offset, std::vector<T>(ptr, ptr + size)}));
+            shard.insertion_order.push_back(it);
+        }
+    }
+
+    // Values of index on the positions [offset, offset+size) of perm
+    void copy_cached(bool row, Shard &shard, int index, const int *perm, int offset, int size, T *ptr) const {
+        std::vector<std::pair<int, int>> missing;
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            missing = lookup(shard.entries, index, offset, size, ptr);
+        }
+        if (missing.empty()) {
+            hits++;
+            return;
+        }
+        misses++;
+
+        // evaluation is done outside the lock, in one call on the missing positions
+        if (missing.size() == 1) {
+            evaluate(row, index, missing[0].second - missing[0].first, perm + missing[0].first, ptr + (missing[0].first - offset));
+        } else {
+            std::vector<int> indices;
+            for (auto &interval : missing) {
+                indices.insert(indices.end(), perm + interval.first, perm + interval.second);
+            }
+            std::vector<T> values(indices.size());
+            evaluate(row, index, indices.size(), indices.data(), values.data());
+            auto value = values.begin();
+            for (auto &interval : missing) {
+                std::copy_n(value, interval.second - interval.first, ptr + (interval.first - offset));
+                value += interval.second - interval.first;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto &interval : missing) {
+            store(shard, index, interval.first, interval.second - interval.first, ptr + (interval.first - offset));
+        }
+    }
+
+  public:
+    // budget is the maximum number of bytes of coefficients stored, rows (resp. columns) are cached when their indices
+    // point to perm_t0 (resp. perm_s0), which is the permutation of cluster_tree_t0 (resp. cluster_tree_s0) or the identity
+    KernelCache(const VirtualGenerator<T> &generator0, std::size_t budget0, const VirtualCluster &cluster_tree_t0, const int *perm_t0, const VirtualCluster &cluster_tree_s0, const int *perm_s0) : VirtualGenerator<T>(generator0.nb_rows(), generator0.nb_cols(), generator0.get_dimension()), generator(generator0), budget(budget0), perm_t(perm_t0), perm_s(perm_s0), leaves_offsets_t(leaves_offsets(cluster_tree_t0)), leaves_offsets_s(leaves_offsets(cluster_tree_s0)), rows_shards(leaves_offsets_t.size()), cols_shards(leaves_offsets_s.size()), stored_bytes(0), hits(0), misses(0) {}
+
+    KernelCache(const KernelCache &) = delete;
+    KernelCache &operator=(const KernelCache &) = delete;
+
+    void copy_submatrix(int M, int N, const int *const rows, const int *const cols, T *ptr) const override {
+        if (budget > 0 && this->dimension == 1) {
+            if (M == 1) {
+                int row_position = position(perm_t, this->nr, rows, 1);
+                int cols_offset  = position(perm_s, this->nc, cols, N);
+                if (row_position >= 0 && cols_offset >= 0) {
+                    copy_cached(true, leaf_shard(rows_shards, leaves_offsets_t, row_position), rows[0], perm_s, cols_offset, N, ptr);
+                    return;
+                }
+            } else if (N == 1) {
+                int col_position = position(perm_s, this->nc, cols, 1);
+                int rows_offset  = position(perm_t, this->nr, rows, M);
+                if (col_position >= 0 && rows_offset >= 0) {
+                    copy_cached(false, leaf_shard(cols_shards, leaves_offsets_s, col_position), cols[0], perm_t, rows_offset, M, ptr);
+                    return;
+                }
+            }
+        }
+        generator.copy_submatrix(M, N, rows, cols, ptr);
+    }
+
+    void copy_submatrices(const std::vector<int> &M, const std::vector<int> &N, const std::vector<const int *> &rows, const std::vector<const int *> &cols, std::vector<T *> &ptr) const override {
+        generator.copy_submatrices(M, N, rows, cols, ptr);
+    }
+
+    // Getters
+    std::size_t get_budget() const { return budget; }
+    std::size_t get_stored_bytes() const { return stored_bytes; }
+    std::size_t get_hits() const { return hits; }
+    std::size_t get_misses() const { return misses; }
+};
+
+} // namespace htool
+
+#endif
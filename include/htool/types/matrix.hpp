@@ -32,6 +32,12 @@ class IMatrix {
 
     virtual void add_mvprod_row_major(const T *const in, T *const out, const int &mu, char transb = 'T', char op = 'N') const = 0;
 
+    // out += op(A) in, with in and out column-major panels of mu columns and leading dimensions ldin and ldout
+    virtual void add_mvprod_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu, char op = 'N') const = 0;
+
+    // out_r += A in_c and out_c += op(A) in_r for one right-hand side, op is 'T' or 'C'
+    virtual void add_mvprod_and_transp(const T *const in_c, T *const out_r, const T *const in_r, T *const out_c, char op) const = 0;
+
     virtual ~IMatrix(){};
 };
 
@@ -40,14 +46,104 @@ class Matrix : public IMatrix<T> {
 
   protected:
     T *mat;
+    bool is_owning; // false when mat is a view on memory managed elsewhere, an arena for example
+
+    void gemm_col_major(const T *const in, int ldin, T *const out, int ldout, int mu, char op, T beta) const {
+        int M = (op == 'N') ? this->nr : this->nc;
+        int K = (op == 'N') ? this->nc : this->nr;
+        if (M == 0 || mu == 0) {
+            return;
+        } else if (K == 0) {
+            if (beta == T(0)) {
+                for (int i = 0; i < mu; i++) {
+                    std::fill_n(out + std::size_t(i) * ldout, M, T(0));
+                }
+            }
+            return;
+        }
+
+        int nr  = this->nr;
+        int nc  = this->nc;
+        int lda = nr;
+        T alpha = 1;
+        if (mu == 1) {
+            int incx = 1;
+            int incy = 1;
+            Blas<T>::gemv(&op, &nr, &nc, &alpha, mat, &lda, in, &incx, &beta, out, &incy);
+        } else {
+            char transb = 'N';
+            Blas<T>::gemm(&op, &transb, &M, &mu, &K, &alpha, mat, &lda, in, &ldin, &beta, out, &ldout);
+        }
+    }
+
+    // Four columns at a time are used for both products while they are in cache, the reductions on real coefficients vectorize
+    template <typename Q = T, typename std::enable_if<!is_complex_t<Q>::value, int>::type = 0>
+    void add_mvprod_and_transp_kernel(const T *const in_c, T *const out_r, const T *const in_r, T *const out_c, char) const {
+        int nr = this->nr;
+        int nc = this->nc;
+        int j  = 0;
+        for (; j + 4 <= nc; j += 4) {
+            const T *c0 = mat + std::size_t(j) * nr;
+            const T *c1 = c0 + nr;
+            const T *c2 = c1 + nr;
+            const T *c3 = c2 + nr;
+            T x0 = in_c[j], x1 = in_c[j + 1], x2 = in_c[j + 2], x3 = in_c[j + 3];
+            T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+#if _OPENMP
+#    pragma omp simd reduction(+ : s0, s1, s2, s3)
+#endif
+            for (int i = 0; i < nr; i++) {
+                T y = in_r[i];
+                out_r[i] += c0[i] * x0 + c1[i] * x1 + c2[i] * x2 + c3[i] * x3;
+                s0 += c0[i] * y;
+                s1 += c1[i] * y;
+                s2 += c2[i] * y;
+                s3 += c3[i] * y;
+            }
+            out_c[j] += s0;
+            out_c[j + 1] += s1;
+            out_c[j + 2] += s2;
+            out_c[j + 3] += s3;
+        }
+        for (; j < nc; j++) {
+            const T *c0 = mat + std::size_t(j) * nr;
+            T x0        = in_c[j];
+            T s0        = 0;
+#if _OPENMP
+#    pragma omp simd reduction(+ : s0)
+#endif
+            for (int i = 0; i < nr; i++) {
+                out_r[i] += c0[i] * x0;
+                s0 += c0[i] * in_r[i];
+            }
+            out_c[j] += s0;
+        }
+    }
+
+    template <typename Q = T, typename std::enable_if<is_complex_t<Q>::value, int>::type = 0>
+    void add_mvprod_and_transp_kernel(const T *const in_c, T *const out_r, const T *const in_r, T *const out_c, char op) const {
+        int nr         = this->nr;
+        int nc         = this->nc;
+        bool conjugate = (op == 'C');
+        for (int j = 0; j < nc; j++) {
+            const T *c0 = mat + std::size_t(j) * nr;
+            T x0        = in_c[j];
+            T s0        = 0;
+            for (int i = 0; i < nr; i++) {
+                out_r[i] += c0[i] * x0;
+                s0 += (conjugate ? std::conj(c0[i]) : c0[i]) * in_r[i];
+            }
+            out_c[j] += s0;
+        }
+    }
 
   public:
-    Matrix() : IMatrix<T>(0, 0), mat(nullptr) {}
-    Matrix(const int &nbr, const int &nbc) : IMatrix<T>(nbr, nbc) {
+    Matrix() : IMatrix<T>(0, 0), mat(nullptr), is_owning(true) {}
+    Matrix(const int &nbr, const int &nbc) : IMatrix<T>(nbr, nbc), is_owning(true) {
         this->mat = new T[nbr * nbc];
         std::fill_n(this->mat, nbr * nbc, 0);
     }
-    Matrix(const Matrix &rhs) : IMatrix<T>(rhs.nb_rows(), rhs.nb_cols()) {
+    Matrix(const Matrix &rhs) : IMatrix<T>(rhs.nb_rows(), rhs.nb_cols()), is_owning(true) {
         mat = new T[rhs.nb_rows() * rhs.nb_cols()]();
 
         std::copy_n(rhs.mat, rhs.nb_rows() * rhs.nb_cols(), mat);
@@ -63,29 +159,33 @@ class Matrix : public IMatrix<T> {
         } else {
             this->nr = rhs.nr;
             this->nc = rhs.nc;
-            delete[] mat;
-            mat = new T[this->nr * this->nc]();
+            if (is_owning)
+                delete[] mat;
+            mat       = new T[this->nr * this->nc]();
+            is_owning = true;
             std::copy_n(rhs.mat, this->nr * this->nc, mat);
         }
         return *this;
     }
-    Matrix(Matrix &&rhs) : IMatrix<T>(rhs.nb_rows(), rhs.nb_cols()), mat(rhs.mat) {
+    Matrix(Matrix &&rhs) : IMatrix<T>(rhs.nb_rows(), rhs.nb_cols()), mat(rhs.mat), is_owning(rhs.is_owning) {
         rhs.mat = nullptr;
     }
 
     Matrix &operator=(Matrix &&rhs) {
         if (this != &rhs) {
-            delete[] this->mat;
-            this->nr  = rhs.nr;
-            this->nc  = rhs.nc;
-            this->mat = rhs.mat;
-            rhs.mat   = nullptr;
+            if (this->is_owning)
+                delete[] this->mat;
+            this->nr        = rhs.nr;
+            this->nc        = rhs.nc;
+            this->mat       = rhs.mat;
+            this->is_owning = rhs.is_owning;
+            rhs.mat         = nullptr;
         }
         return *this;
     }
 
     ~Matrix() {
-        if (mat != nullptr)
+        if (mat != nullptr && is_owning)
             delete[] mat;
     }
 
@@ -122,14 +222,28 @@ class Matrix : public IMatrix<T> {
     T *data() { return this->mat; }
     T *data() const { return this->mat; }
 
-    void assign(int nr, int nc, T *ptr) {
-        if (this->nr * this->nc > 0)
+    //! ### Assign data
+    /*!
+    Replaces the data of _A_ by _ptr_, which must have been allocated with new[] when _owning_ is true.
+    Otherwise, _A_ is a view on _ptr_ which has to outlive it.
+    */
+    void assign(int nr, int nc, T *ptr, bool owning = true) {
+        if (this->nr * this->nc > 0 && this->is_owning)
             delete[] this->mat;
 
         this->nr = nr;
         this->nc = nc;
 
-        this->mat = ptr;
+        this->mat       = ptr;
+        this->is_owning = owning;
+    }
+
+    bool is_owning_data() const { return this->is_owning; }
+
+    // Moves the coefficients to ptr, which is not owned and has to outlive the matrix
+    void relocate(T *ptr) {
+        std::copy_n(this->mat, std::size_t(this->nr) * this->nc, ptr);
+        this->assign(this->nr, this->nc, ptr, false);
     }
 
     //! ### Access operator
@@ -382,6 +496,80 @@ class Matrix : public IMatrix<T> {
         }
     }
 
+    //! ### Products with column-major panels
+    /*!
+    out = op(A) in and out += op(A) in, in and out have mu columns with leading dimensions ldin and ldout.
+    */
+    void mvprod_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu, char op = 'N') const {
+        this->gemm_col_major(in, ldin, out, ldout, mu, op, T(0));
+    }
+
+    void add_mvprod_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu, char op = 'N') const {
+        this->gemm_col_major(in, ldin, out, ldout, mu, op, T(1));
+    }
+
+    //! ### Products by the matrix and its transpose in one pass
+    /*!
+    out_r += A in_c and out_c += op(A) in_r for one right-hand side, op is 'T' or 'C'. The coefficients are read once from memory instead of twice with two products, which only pays off when the matrix does not fit in cache.
+    */
+    void add_mvprod_and_transp(const T *const in_c, T *const out_r, const T *const in_r, T *const out_c, char op) const {
+        this->add_mvprod_and_transp_kernel(in_c, out_r, in_r, out_c, op);
+    }
+
+    // see https://stackoverflow.com/questions/6972368/stdenable-if-to-conditionally-compile-a-member-function for why  Q template parameter
+    template <typename Q = T, typename std::enable_if<!is_complex_t<Q>::value, int>::type = 0>
+    void add_mvprod_col_major_sym(const T *const in, int ldin, T *const out, int ldout, const int &mu, char UPLO, char) const {
+        int nr  = this->nr;
+        T alpha = 1;
+        T beta  = 1;
+
+        if (nr) {
+            if (mu == 1) {
+                int lda  = nr;
+                int incx = 1;
+                int incy = 1;
+                Blas<T>::symv(&UPLO, &nr, &alpha, mat, &lda, in, &incx, &beta, out, &incy);
+            } else {
+                int lda   = nr;
+                char side = 'L';
+                int N     = mu;
+                Blas<T>::symm(&side, &UPLO, &nr, &N, &alpha, mat, &lda, in, &ldin, &beta, out, &ldout);
+            }
+        }
+    }
+
+    template <typename Q = T, typename std::enable_if<is_complex_t<Q>::value, int>::type = 0>
+    void add_mvprod_col_major_sym(const T *const in, int ldin, T *const out, int ldout, const int &mu, char UPLO, char symmetry) const {
+        int nr  = this->nr;
+        T alpha = 1;
+        T beta  = 1;
+
+        if (nr) {
+            if (symmetry != 'S' && symmetry != 'H') {
+                throw std::invalid_argument("[Htool error] Invalid arguments for add_mvprod_col_major_sym"); // LCOV_EXCL_LINE
+            }
+            if (mu == 1) {
+                int lda  = nr;
+                int incx = 1;
+                int incy = 1;
+                if (symmetry == 'S') {
+                    Blas<T>::symv(&UPLO, &nr, &alpha, mat, &lda, in, &incx, &beta, out, &incy);
+                } else {
+                    Blas<T>::hemv(&UPLO, &nr, &alpha, mat, &lda, in, &incx, &beta, out, &incy);
+                }
+            } else {
+                int lda   = nr;
+                char side = 'L';
+                int N     = mu;
+                if (symmetry == 'S') {
+                    Blas<T>::symm(&side, &UPLO, &nr, &N, &alpha, mat, &lda, in, &ldin, &beta, out, &ldout);
+                } else {
+                    Blas<T>::hemm(&side, &UPLO, &nr, &N, &alpha, mat, &lda, in, &ldin, &beta, out, &ldout);
+                }
+            }
+        }
+    }
+
     // see https://stackoverflow.com/questions/6972368/stdenable-if-to-conditionally-compile-a-member-function for why  Q template parameter
     template <typename Q = T, typename std::enable_if<!is_complex_t<Q>::value, int>::type = 0>
     void add_mvprod_row_major_sym(const T *const in, T *const out, const int &mu, char UPLO, char) const {
@@ -497,11 +685,12 @@ class Matrix : public IMatrix<T> {
         int rows = 0, cols = 0;
         in.read((char *)(&rows), sizeof(int));
         in.read((char *)(&cols), sizeof(int));
-        if (this->nr != 0 && this->nc != 0)
+        if (this->nr != 0 && this->nc != 0 && is_owning)
             delete[] mat;
-        mat      = new T[rows * cols];
-        this->nr = rows;
-        this->nc = cols;
+        mat       = new T[rows * cols];
+        is_owning = true;
+        this->nr  = rows;
+        this->nc  = cols;
         in.read((char *)&(mat[0]), rows * cols * sizeof(T));
 
         in.close();
@@ -553,41 +742,79 @@ double normFrob(const Matrix<T> &A) {
     return sqrt(norm);
 }
 
+// Tag of the constructors of SubMatrix and LowRankMatrix which keep a pointer to their row and column indices instead of copying them
+struct ReferenceIndices {};
+
 //================================//
 //      CLASSE SOUS-MATRICE       //
 //================================//
 template <typename T>
 class SubMatrix : public Matrix<T> {
-    // TODO: remove ir and ic
-    std::vector<int> ir;
-    std::vector<int> ic;
+    // Owned copy of the indices, empty when they are referenced
+    std::vector<int> ir_storage;
+    std::vector<int> ic_storage;
+    // Point to ir_storage and ic_storage, or to external storage (usually a cluster permutation) which has to outlive the SubMatrix
+    const int *ir;
+    const int *ic;
     int offset_i;
     int offset_j;
 
   public:
     // C style
-    SubMatrix(int M, int N, const int *const rows, const int *const cols, int offset_i0 = 0, int offset_j0 = 0) : Matrix<T>(M, N), ir(rows, rows + M), ic(cols, cols + N), offset_i(offset_i0), offset_j(offset_j0) {
+    SubMatrix(int M, int N, const int *const rows, const int *const cols, int offset_i0 = 0, int offset_j0 = 0) : Matrix<T>(M, N), ir_storage(rows, rows + M), ic_storage(cols, cols + N), ir(ir_storage.data()), ic(ic_storage.data()), offset_i(offset_i0), offset_j(offset_j0) {
     }
 
     SubMatrix(const VirtualGenerator<T> &mat0, int M, int N, const int *const rows, const int *const cols, int offset_i0 = 0, int offset_j0 = 0) : SubMatrix(M, N, rows, cols, offset_i0, offset_j0) {
         mat0.copy_submatrix(M, N, rows, cols, this->mat);
     }
 
+    // Coefficients are stored in ptr, which is not owned and has to outlive the SubMatrix
+    SubMatrix(int M, int N, const int *const rows, const int *const cols, int offset_i0, int offset_j0, T *ptr) : Matrix<T>(), ir_storage(rows, rows + M), ic_storage(cols, cols + N), ir(ir_storage.data()), ic(ic_storage.data()), offset_i(offset_i0), offset_j(offset_j0) {
+        this->assign(M, N, ptr, false);
+    }
+
+    SubMatrix(const VirtualGenerator<T> &mat0, int M, int N, const int *const rows, const int *const cols, int offset_i0, int offset_j0, T *ptr) : SubMatrix(M, N, rows, cols, offset_i0, offset_j0, ptr) {
+        mat0.copy_submatrix(M, N, rows, cols, this->mat);
+    }
+
+    // Used by HMatrix, rows and cols are not copied and have to outlive the SubMatrix
+    SubMatrix(ReferenceIndices, int M, int N, const int *const rows, const int *const cols, int offset_i0 = 0, int offset_j0 = 0) : Matrix<T>(M, N), ir(rows), ic(cols), offset_i(offset_i0), offset_j(offset_j0) {
+    }
+
+    SubMatrix(ReferenceIndices tag, const VirtualGenerator<T> &mat0, int M, int N, const int *const rows, const int *const cols, int offset_i0 = 0, int offset_j0 = 0) : SubMatrix(tag, M, N, rows, cols, offset_i0, offset_j0) {
+        mat0.copy_submatrix(M, N, rows, cols, this->mat);
+    }
+
+    SubMatrix(ReferenceIndices, int M, int N, const int *const rows, const int *const cols, int offset_i0, int offset_j0, T *ptr) : Matrix<T>(), ir(rows), ic(cols), offset_i(offset_i0), offset_j(offset_j0) {
+        this->assign(M, N, ptr, false);
+    }
+
+    SubMatrix(ReferenceIndices tag, const VirtualGenerator<T> &mat0, int M, int N, const int *const rows, const int *const cols, int offset_i0, int offset_j0, T *ptr) : SubMatrix(tag, M, N, rows, cols, offset_i0, offset_j0, ptr) {
+        mat0.copy_submatrix(M, N, rows, cols, this->mat);
+    }
+
     // C++ style
-    SubMatrix(std::vector<int>::const_iterator first_ir, std::vector<int>::const_iterator last_ir, std::vector<int>::const_iterator first_ic, std::vector<int>::const_iterator last_ic, int offset_i0 = 0, int offset_j0 = 0) : Matrix<T>(std::distance(first_ir, last_ir), std::distance(first_ic, last_ic)), ir(first_ir, last_ir), ic(first_ic, last_ic), offset_i(offset_i0), offset_j(offset_j0) {}
+    SubMatrix(std::vector<int>::const_iterator first_ir, std::vector<int>::const_iterator last_ir, std::vector<int>::const_iterator first_ic, std::vector<int>::const_iterator last_ic, int offset_i0 = 0, int offset_j0 = 0) : Matrix<T>(std::distance(first_ir, last_ir), std::distance(first_ic, last_ic)), ir_storage(first_ir, last_ir), ic_storage(first_ic, last_ic), ir(ir_storage.data()), ic(ic_storage.data()), offset_i(offset_i0), offset_j(offset_j0) {}
 
     SubMatrix(const std::vector<int> &ir0, const std::vector<int> &ic0) : SubMatrix(ir0.begin(), ir0.end(), ic0.begin(), ic0.end(), 0, 0) {}
 
     SubMatrix(const std::vector<int> &ir0, const std::vector<int> &ic0, const int &offset_i0, const int &offset_j0) : SubMatrix(ir0.begin(), ir0.end(), ic0.begin(), ic0.end(), offset_i0, offset_j0) {}
 
-    SubMatrix(const SubMatrix &m) {
-        this->mat      = m.mat;
-        this->ir       = m.ir;
-        this->ic       = m.ic;
-        this->offset_i = m.offset_i;
-        this->offset_j = m.offset_j;
-        this->nr       = m.nr;
-        this->nc       = m.nc;
+    // Deep copy, so that copying a view does not alias its storage, referenced indices stay referenced
+    SubMatrix(const SubMatrix &m) : Matrix<T>(m), ir_storage(m.ir_storage), ic_storage(m.ic_storage), ir(m.ir_storage.empty() ? m.ir : ir_storage.data()), ic(m.ic_storage.empty() ? m.ic : ic_storage.data()), offset_i(m.offset_i), offset_j(m.offset_j) {}
+
+    SubMatrix &operator=(const SubMatrix &m) {
+        if (&m == this) {
+            return *this;
+        }
+        Matrix<T>::operator=(m);
+        ir_storage = m.ir_storage;
+        ic_storage = m.ic_storage;
+        ir         = m.ir_storage.empty() ? m.ir : ir_storage.data();
+        ic         = m.ic_storage.empty() ? m.ic : ic_storage.data();
+        offset_i   = m.offset_i;
+        offset_j   = m.offset_j;
+        return *this;
     }
 
     // Mostly same operators as in Matrix, need CRTP to factorize
@@ -615,10 +842,10 @@ class SubMatrix : public Matrix<T> {
         return A * a;
     }
     // Getters
-    std::vector<int> get_ir() const { return this->ir; }
-    std::vector<int> get_ic() const { return this->ic; }
-    const int *data_ir() const { return this->ir.data(); }
-    const int *data_ic() const { return this->ic.data(); }
+    std::vector<int> get_ir() const { return std::vector<int>(this->ir, this->ir + this->nr); }
+    std::vector<int> get_ic() const { return std::vector<int>(this->ic, this->ic + this->nc); }
+    const int *data_ir() const { return this->ir; }
+    const int *data_ic() const { return this->ic; }
     int get_offset_i() const { return this->offset_i; }
     int get_offset_j() const { return this->offset_j; }
     void set_offset_i(int offset) { this->offset_i = offset; }
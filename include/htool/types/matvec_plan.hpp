@@ -0,0 +1,129 @@
+#ifndef HTOOL_MATVEC_PLAN_HPP
+#define HTOOL_MATVEC_PLAN_HPP
+
+#if _OPENMP
+#    include <omp.h>
+#endif
+
+#include "../misc/aligned_buffer.hpp"
+#include <algorithm>
+#include <mpi.h>
+#include <vector>
+
+namespace htool {
+
+//=================================================================//
+//                         MATVEC PLAN
+//*****************************************************************//
+// Communication counts and scratch buffers of the products of an HMatrix with
+// mu right-hand sides. Counts and the scratch of the low-rank blocks are
+// computed when the plan is created, the other buffers grow at the first
+// product, so that repeated products with the same plan do not allocate.
+// A plan is used by one product at a time, and must be recreated when the
+// HMatrix is rebuilt.
+template <typename T>
+class MatvecPlan {
+  private:
+    int mu;
+    int rankWorld;
+
+    // Allgatherv of the local parts of vectors, in number of coefficients
+    std::vector<int> target_counts, target_displs;
+    std::vector<int> source_counts, source_displs;
+
+    // Alltoallv of the transposed product, local source part from every process
+    std::vector<int> transp_counts, transp_displs;
+
+    // Scratch of the low-rank blocks, one slice per thread
+    AlignedBuffer<T> lrmat_work;
+    std::size_t lrmat_work_stride;
+    int nb_threads;
+
+    AlignedBuffer<T> work, in_perm, out_perm, buffer, in_conj, halo;
+    std::vector<MPI_Request> requests;
+
+    static void counts_and_displs(const std::vector<std::pair<int, int>> &masteroffset, int mu, std::vector<int> &counts, std::vector<int> &displs) {
+        counts.resize(masteroffset.size());
+        displs.resize(masteroffset.size());
+        for (int i = 0; i < masteroffset.size(); i++) {
+            counts[i] = masteroffset[i].second * mu;
+            displs[i] = (i == 0) ? 0 : displs[i - 1] + counts[i - 1];
+        }
+    }
+
+  public:
+    MatvecPlan() : mu(0), rankWorld(0), lrmat_work_stride(0), nb_threads(0) {}
+
+    // max_rank is the largest rank of the low-rank blocks
+    MatvecPlan(int mu0, const std::vector<std::pair<int, int>> &masteroffset_t, const std::vector<std::pair<int, int>> &masteroffset_s, int rankWorld0, int max_rank) : mu(mu0), rankWorld(rankWorld0) {
+        counts_and_displs(masteroffset_t, mu, target_counts, target_displs);
+        counts_and_displs(masteroffset_s, mu, source_counts, source_displs);
+        transp_counts.assign(masteroffset_s.size(), source_counts[rankWorld]);
+        transp_displs.resize(masteroffset_s.size());
+        for (int i = 0; i < masteroffset_s.size(); i++) {
+            transp_displs[i] = i * source_counts[rankWorld];
+        }
+
+#if _OPENMP
+        nb_threads = omp_get_max_threads();
+#else
+        nb_threads = 1;
+#endif
+        // Slices are padded to the alignment to avoid false sharing between threads
+        std::size_t alignment_size = std::max(lrmat_work.get_alignment() / sizeof(T), std::size_t(1));
+        lrmat_work_stride          = (std::size_t(std::max(max_rank, 0)) * mu + alignment_size - 1) / alignment_size * alignment_size;
+        lrmat_work.reserve(lrmat_work_stride * nb_threads);
+    }
+
+    MatvecPlan(const MatvecPlan &) = delete;
+    MatvecPlan &operator=(const MatvecPlan &) = delete;
+    MatvecPlan(MatvecPlan &&)                 = default;
+    MatvecPlan &operator=(MatvecPlan &&) = default;
+
+    // Getters
+    int get_mu() const { return mu; }
+    const std::vector<int> &get_target_counts() const { return target_counts; }
+    const std::vector<int> &get_target_displs() const { return target_displs; }
+    const std::vector<int> &get_source_counts() const { return source_counts; }
+    const std::vector<int> &get_source_displs() const { return source_displs; }
+    const std::vector<int> &get_transp_counts() const { return transp_counts; }
+    const std::vector<int> &get_transp_displs() const { return transp_displs; }
+    int get_local_target_size() const { return target_counts[rankWorld] / mu; }
+    int get_local_source_size() const { return source_counts[rankWorld] / mu; }
+
+    // Scratch of the calling thread for the low-rank blocks, nullptr if it has none (nested parallelism or more threads than when the plan was created)
+    T *get_lrmat_work() {
+#if _OPENMP
+        int id = omp_get_thread_num();
+        if (omp_get_level() > 1 || id >= nb_threads) {
+            return nullptr;
+        }
+#else
+        int id = 0;
+#endif
+        return lrmat_work.data() + lrmat_work_stride * id;
+    }
+
+    // Buffers of at least n coefficients, not to be called in a parallel region
+    T *get_work(std::size_t n) { return work.reserve(n); }
+    T *get_in_perm(std::size_t n) { return in_perm.reserve(n); }
+    T *get_out_perm(std::size_t n) { return out_perm.reserve(n); }
+    T *get_buffer(std::size_t n) { return buffer.reserve(n); }
+    T *get_in_conj(std::size_t n) { return in_conj.reserve(n); }
+    T *get_halo(std::size_t n) { return halo.reserve(n); }
+    MPI_Request *get_requests(std::size_t n) {
+        if (requests.size() < n) {
+            requests.resize(n);
+        }
+        return requests.data();
+    }
+
+    // Bytes of the buffers
+    std::size_t get_bytes() const {
+        return (lrmat_work.get_capacity() + work.get_capacity() + in_perm.get_capacity() + out_perm.get_capacity() + buffer.get_capacity() + in_conj.get_capacity() + halo.get_capacity()) * sizeof(T) + requests.capacity() * sizeof(MPI_Request);
+    }
+};
+
+} // namespace htool
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef HTOOL_MATVEC_SCHEDULE_HPP
+#define HTOOL_MATVEC_SCHEDULE_HPP
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+#include <vector>
+
+namespace htool {
+
+//=================================================================//
+//                       MATVEC SCHEDULE
+//*****************************************************************//
+// Owner-computes schedule of products by blocks, item i of the schedule
+// writing in the interval [begins[i], begins[i]+sizes[i]) of the output.
+// Intervals of size at most band_size are grouped in bands, the connected
+// components of their union, and each band is computed by one thread in the
+// order of its items, so that threads write disjoint slices of the output
+// without temporaries nor reduction. The order in which items write in the
+// output only depends on band_size, so that when band_size does not depend
+// on the number of threads, neither does the result. Items with the same
+// larger interval are grouped and groups are colored so that the intervals
+// of a color are disjoint, colors are computed one after the other after the
+// bands. An item can also write a second interval [begins2[i],
+// begins2[i]+sizes2[i]), it is then in a band if the hull of its two
+// intervals is small enough, and colored with both intervals otherwise so
+// that the gap between them is not a conflict.
+class MatvecSchedule {
+    std::vector<std::vector<int>> bands;               // items of each band
+    std::vector<std::vector<std::vector<int>>> colors; // items of each group of items with the same interval, for each color
+
+  public:
+    MatvecSchedule() {}
+
+    // costs are only used to start the most expensive bands and items first
+    MatvecSchedule(const std::vector<int> &begins, const std::vector<int> &sizes, const std::vector<double> &costs, int band_size) : MatvecSchedule(begins, sizes, std::vector<int>(begins.size(), 0), std::vector<int>(sizes.size(), 0), costs, band_size) {}
+
+    // Items writing two intervals, sizes2[i] is 0 for the ones writing only the first one
+    MatvecSchedule(const std::vector<int> &begins, const std::vector<int> &sizes, const std::vector<int> &begins2, const std::vector<int> &sizes2, const std::vector<double> &costs, int band_size) {
+        int nb_items = begins.size();
+        std::vector<int> hull_begins(begins), hull_ends(nb_items);
+        for (int i = 0; i < nb_items; i++) {
+            hull_ends[i] = begins[i] + sizes[i];
+            if (sizes2[i] > 0) {
+                hull_begins[i] = std::min(hull_begins[i], begins2[i]);
+                hull_ends[i]   = std::max(hull_ends[i], begins2[i] + sizes2[i]);
+            }
+        }
+        std::vector<int> small_items, large_items;
+        for (int i = 0; i < nb_items; i++) {
+            (hull_ends[i] - hull_begins[i] <= band_size ? small_items : large_items).push_back(i);
+        }
+
+        // Bands
+        std::stable_sort(small_items.begin(), small_items.end(), [&](int a, int b) { return hull_begins[a] < hull_begins[b]; });
+        std::vector<double> bands_costs;
+        int band_end = 0;
+        for (int i : small_items) {
+            if (bands.empty() || hull_begins[i] >= band_end) {
+                bands.emplace_back();
+                bands_costs.push_back(0);
+            }
+            band_end = std::max(band_end, hull_ends[i]);
+            bands.back().push_back(i);
+            bands_costs.back() += costs[i];
+        }
+        for (auto &band : bands) {
+            std::sort(band.begin(), band.end());
+        }
+        std::vector<int> bands_order(bands.size());
+        std::iota(bands_order.begin(), bands_order.end(), int(0));
+        std::stable_sort(bands_order.begin(), bands_order.end(), [&](int a, int b) { return bands_costs[a] > bands_costs[b]; });
+        std::vector<std::vector<int>> sorted_bands(bands.size());
+        for (int b = 0; b < bands.size(); b++) {
+            sorted_bands[b] = std::move(bands[bands_order[b]]);
+        }
+        bands = std::move(sorted_bands);
+
+        // Items with the same intervals are grouped, groups are colored greedily, largest first
+        auto key = [&](int i) { return std::make_tuple(-(sizes[i] + sizes2[i]), begins[i], sizes[i], begins2[i], sizes2[i]); };
+        std::stable_sort(large_items.begin(), large_items.end(), [&](int a, int b) { return key(a) < key(b); });
+        std::vector<std::vector<int>> groups;
+        std::vector<double> groups_costs;
+        for (int k = 0; k < large_items.size(); k++) {
+            int i = large_items[k];
+            if (k == 0 || key(i) != key(large_items[k - 1])) {
+                groups.emplace_back();
+                groups_costs.push_back(0);
+            }
+            groups.back().push_back(i);
+            groups_costs.back() += costs[i];
+        }
+        auto overlap_intervals = [](int begin_a, int size_a, int begin_b, int size_b) {
+            return size_a > 0 && size_b > 0 && begin_a < begin_b + size_b && begin_b < begin_a + size_a;
+        };
+        auto overlap = [&](int g, int h) {
+            int i = groups[g][0];
+            int j = groups[h][0];
+            return overlap_intervals(begins[i], sizes[i], begins[j], sizes[j]) || overlap_intervals(begins[i], sizes[i], begins2[j], sizes2[j]) || overlap_intervals(begins2[i], sizes2[i], begins[j], sizes[j]) || overlap_intervals(begins2[i], sizes2[i], begins2[j], sizes2[j]);
+        };
+        std::vector<std::vector<int>> colors_groups;
+        for (int g = 0; g < groups.size(); g++) {
+            int color = 0;
+            while (color < colors_groups.size() && std::any_of(colors_groups[color].begin(), colors_groups[color].end(), [&](int h) { return overlap(g, h); })) {
+                color++;
+            }
+            if (color == colors_groups.size()) {
+                colors_groups.emplace_back();
+            }
+            colors_groups[color].push_back(g);
+        }
+        for (auto &color_groups : colors_groups) {
+            std::stable_sort(color_groups.begin(), color_groups.end(), [&](int a, int b) { return groups_costs[a] > groups_costs[b]; });
+            colors.emplace_back();
+            for (int g : color_groups) {
+                std::sort(groups[g].begin(), groups[g].end());
+                colors.back().push_back(std::move(groups[g]));
+            }
+        }
+    }
+
+    // Getters
+    const std::vector<std::vector<int>> &get_bands() const { return bands; }
+    const std::vector<std::vector<std::vector<int>>> &get_colors() const { return colors; }
+
+    // Calls f on every item, it must be called by all the threads of a parallel region
+    template <typename F>
+    void run(F f) const {
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp for schedule(dynamic)
+#endif
+        for (int b = 0; b < bands.size(); b++) {
+            for (int i : bands[b]) {
+                f(i);
+            }
+        }
+        for (int c = 0; c < colors.size(); c++) {
+#if _OPENMP && !defined(PYTHON_INTERFACE)
+#    pragma omp for schedule(dynamic)
+#endif
+            for (int g = 0; g < colors[c].size(); g++) {
+                for (int i : colors[c][g]) {
+                    f(i);
+                }
+            }
+        }
+    }
+};
+
+} // namespace htool
+
+#endif
@@ -4,6 +4,7 @@
 #include "vector.hpp"
 #include <cassert>
 #include <iterator>
+#include <vector>
 
 namespace htool {
 
@@ -21,6 +22,14 @@ class VirtualGenerator {
     // C style
     virtual void copy_submatrix(int M, int N, const int *const rows, const int *const cols, T *ptr) const = 0;
 
+    // Batched version, the ith block has M[i] rows given by rows[i], N[i] columns given by cols[i] and is stored in ptr[i].
+    // Override it to share setup costs or vectorize across blocks, the default calls copy_submatrix on each block.
+    virtual void copy_submatrices(const std::vector<int> &M, const std::vector<int> &N, const std::vector<const int *> &rows, const std::vector<const int *> &cols, std::vector<T *> &ptr) const {
+        for (int i = 0; i < M.size(); i++) {
+            this->copy_submatrix(M[i], N[i], rows[i], cols[i], ptr[i]);
+        }
+    }
+
     int nb_rows() const { return nr; }
     int nb_cols() const { return nc; }
     int get_dimension() const { return dimension; }
@@ -61,6 +61,9 @@ class VirtualHMatrix {
     virtual void mymvprod_transp_local_to_local(const T *const in, T *const out, const int &mu = 1, T *work = nullptr) const = 0;
     virtual void mymvprod_transp_local_to_global(const T *const in, T *const out, const int &mu = 1) const                   = 0;
 
+    virtual void mvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu = 1) const   = 0;
+    virtual void mymvprod_local_to_local_col_major(const T *const in, int ldin, T *const out, int ldout, const int &mu = 1) const = 0;
+
     virtual void mvprod_subrhs(const T *const in, T *const out, const int &mu, const int &offset, const int &size, const int &margin) const = 0;
 
     // Infos
@@ -9,9 +9,15 @@
 #    define HTOOL_LAPACK_F77(func) func##_
 #endif
 
-#define HTOOL_GENERATE_EXTERN_LAPACK_COMPLEX(C, T, B, U)                                                                                                                       \
-    void HTOOL_LAPACK_F77(B##gesvd)(const char *, const char *, const int *, const int *, U *, const int *, U *, U *, const int *, U *, const int *, U *, const int *, int *); \
-    void HTOOL_LAPACK_F77(C##gesvd)(const char *, const char *, const int *, const int *, T *, const int *, U *, T *, const int *, T *, const int *, T *, const int *, U *, int *);
+#define HTOOL_GENERATE_EXTERN_LAPACK_COMPLEX(C, T, B, U)                                                                                                                              \
+    void HTOOL_LAPACK_F77(B##gesvd)(const char *, const char *, const int *, const int *, U *, const int *, U *, U *, const int *, U *, const int *, U *, const int *, int *);        \
+    void HTOOL_LAPACK_F77(C##gesvd)(const char *, const char *, const int *, const int *, T *, const int *, U *, T *, const int *, T *, const int *, T *, const int *, U *, int *);   \
+    void HTOOL_LAPACK_F77(B##gesdd)(const char *, const int *, const int *, U *, const int *, U *, U *, const int *, U *, const int *, U *, const int *, int *, int *);               \
+    void HTOOL_LAPACK_F77(C##gesdd)(const char *, const int *, const int *, T *, const int *, U *, T *, const int *, T *, const int *, T *, const int *, U *, int *, int *);          \
+    void HTOOL_LAPACK_F77(B##geqrf)(const int *, const int *, U *, const int *, U *, U *, const int *, int *);                                                                        \
+    void HTOOL_LAPACK_F77(C##geqrf)(const int *, const int *, T *, const int *, T *, T *, const int *, int *);                                                                        \
+    void HTOOL_LAPACK_F77(B##ormqr)(const char *, const char *, const int *, const int *, const int *, const U *, const int *, const U *, U *, const int *, U *, const int *, int *); \
+    void HTOOL_LAPACK_F77(C##unmqr)(const char *, const char *, const int *, const int *, const int *, const T *, const int *, const T *, T *, const int *, T *, const int *, int *);
 
 #if !defined(PETSC_HAVE_BLASLAPACK)
 #    ifndef _MKL_H_
@@ -40,6 +46,15 @@ struct Lapack {
     /* Function: gesvd
      *  computes the singular value decomposition (SVD). */
     static void gesvd(const char *, const char *, const int *, const int *, K *, const int *, underlying_type<K> *, K *, const int *, K *, const int *, K *, const int *, underlying_type<K> *, int *);
+    /* Function: gesdd
+     *  computes the singular value decomposition (SVD) with a divide and conquer method. */
+    static void gesdd(const char *, const int *, const int *, K *, const int *, underlying_type<K> *, K *, const int *, K *, const int *, K *, const int *, underlying_type<K> *, int *, int *);
+    /* Function: geqrf
+     *  computes a QR factorization of a general matrix. */
+    static void geqrf(const int *, const int *, K *, const int *, K *, K *, const int *, int *);
+    /* Function: mqr
+     *  multiplies a matrix by the orthogonal matrix Q of a QR factorization computed by geqrf (ormqr for real types, unmqr for complex types). */
+    static void mqr(const char *, const char *, const int *, const int *, const int *, const K *, const int *, const K *, K *, const int *, K *, const int *, int *);
 };
 
 #    define HTOOL_GENERATE_LAPACK_COMPLEX(C, T, B, U)                                                                                                                                                                             \
@@ -52,6 +67,36 @@ struct Lapack {
         inline void Lapack<T>::gesvd(const char *jobu, const char *jobvt, const int *m, const int *n, T *a, const int *lda, U *s, T *u, const int *ldu, T *vt, const int *ldvt, T *work, const int *lwork, U *rwork, int *info) { \
             HTOOL_LAPACK_F77(C##gesvd)                                                                                                                                                                                            \
             (jobu, jobvt, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, rwork, info);                                                                                                                                           \
+        }                                                                                                                                                                                                                         \
+        template <>                                                                                                                                                                                                               \
+        inline void Lapack<U>::gesdd(const char *jobz, const int *m, const int *n, U *a, const int *lda, U *s, U *u, const int *ldu, U *vt, const int *ldvt, U *work, const int *lwork, U *, int *iwork, int *info) {             \
+            HTOOL_LAPACK_F77(B##gesdd)                                                                                                                                                                                            \
+            (jobz, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, iwork, info);                                                                                                                                                  \
+        }                                                                                                                                                                                                                         \
+        template <>                                                                                                                                                                                                               \
+        inline void Lapack<T>::gesdd(const char *jobz, const int *m, const int *n, T *a, const int *lda, U *s, T *u, const int *ldu, T *vt, const int *ldvt, T *work, const int *lwork, U *rwork, int *iwork, int *info) {        \
+            HTOOL_LAPACK_F77(C##gesdd)                                                                                                                                                                                            \
+            (jobz, m, n, a, lda, s, u, ldu, vt, ldvt, work, lwork, rwork, iwork, info);                                                                                                                                           \
+        }                                                                                                                                                                                                                         \
+        template <>                                                                                                                                                                                                               \
+        inline void Lapack<U>::geqrf(const int *m, const int *n, U *a, const int *lda, U *tau, U *work, const int *lwork, int *info) {                                                                                            \
+            HTOOL_LAPACK_F77(B##geqrf)                                                                                                                                                                                            \
+            (m, n, a, lda, tau, work, lwork, info);                                                                                                                                                                               \
+        }                                                                                                                                                                                                                         \
+        template <>                                                                                                                                                                                                               \
+        inline void Lapack<T>::geqrf(const int *m, const int *n, T *a, const int *lda, T *tau, T *work, const int *lwork, int *info) {                                                                                            \
+            HTOOL_LAPACK_F77(C##geqrf)                                                                                                                                                                                            \
+            (m, n, a, lda, tau, work, lwork, info);                                                                                                                                                                               \
+        }                                                                                                                                                                                                                         \
+        template <>                                                                                                                                                                                                               \
+        inline void Lapack<U>::mqr(const char *side, const char *trans, const int *m, const int *n, const int *k, const U *a, const int *lda, const U *tau, U *c, const int *ldc, U *work, const int *lwork, int *info) {         \
+            HTOOL_LAPACK_F77(B##ormqr)                                                                                                                                                                                            \
+            (side, trans, m, n, k, a, lda, tau, c, ldc, work, lwork, info);                                                                                                                                                       \
+        }                                                                                                                                                                                                                         \
+        template <>                                                                                                                                                                                                               \
+        inline void Lapack<T>::mqr(const char *side, const char *trans, const int *m, const int *n, const int *k, const T *a, const int *lda, const T *tau, T *c, const int *ldc, T *work, const int *lwork, int *info) {         \
+            HTOOL_LAPACK_F77(C##unmqr)                                                                                                                                                                                            \
+            (side, trans, m, n, k, a, lda, tau, c, ldc, work, lwork, info);                                                                                                                                                       \
         }
 
 HTOOL_GENERATE_LAPACK_COMPLEX(c, std::complex<float>, s, float)
@@ -0,0 +1,135 @@
+#include <htool/clustering/bounding_box_1.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/testing/geometry.hpp>
+#include <iostream>
+
+using namespace std;
+using namespace htool;
+
+// Tree built from the points of each process against all the points, sons of the root follow the processes with
+// sizes of a regular splitting when regular is true
+template <typename ClusterType>
+bool test_distributed_build(int nb_pt, const vector<double> &p, const vector<double> &g, int nb_sons, bool regular, int rankWorld, int sizeWorld) {
+    bool test = 0;
+
+    // Each process only gives its points
+    int local_offset = rankWorld * (nb_pt / sizeWorld);
+    int local_nb_pt  = (rankWorld == sizeWorld - 1) ? nb_pt - local_offset : nb_pt / sizeWorld;
+    vector<double> local_p(p.begin() + 3 * local_offset, p.begin() + 3 * (local_offset + local_nb_pt)), local_r(local_nb_pt, 0);
+    vector<double> local_g(g.begin() + local_offset, g.begin() + local_offset + local_nb_pt);
+
+    ClusterType t;
+    t.build_distributed(local_nb_pt, local_p.data(), local_r.data(), local_g.data(), nb_sons);
+
+    // Permutation of all the points, the same on all processes
+    vector<int> perm(t.get_perm()), identity(nb_pt), perm_0(t.get_perm());
+    std::sort(perm.begin(), perm.end());
+    std::iota(identity.begin(), identity.end(), 0);
+    MPI_Bcast(perm_0.data(), perm_0.size(), MPI_INT, 0, MPI_COMM_WORLD);
+    test = test || !(perm == identity);
+    test = test || !(perm_0 == t.get_perm());
+
+    // One son of the root per process
+    const VirtualCluster &root = *t.get_root();
+    test                       = test || !(root.get_nb_sons() == sizeWorld && root.get_size() == nb_pt);
+    for (int q = 0; q < sizeWorld; q++) {
+        test = test || !(root.get_son(q).get_offset() == t.get_masteroffset(q).first && root.get_son(q).get_size() == t.get_masteroffset(q).second);
+        test = test || !(root.get_son(q).get_rank() == q && root.get_son(q).get_counter() == q);
+        if (regular) {
+            test = test || !(t.get_masteroffset(q).second == ((q == sizeWorld - 1) ? nb_pt - q * (nb_pt / sizeWorld) : nb_pt / sizeWorld));
+        }
+    }
+    test = test || !(t.get_local_offset() == t.get_masteroffset(rankWorld).first && t.get_local_size() == t.get_masteroffset(rankWorld).second);
+
+    // Sons partition their father, centers and radii are the ones of their points
+    vector<double> nodes;
+    int min_depth = -1, max_depth = 0;
+    std::stack<VirtualCluster const *> s;
+    s.push(&root);
+    while (!s.empty()) {
+        VirtualCluster const *curr = s.top();
+        s.pop();
+        nodes.insert(nodes.end(), {double(curr->get_offset()), double(curr->get_size()), curr->get_rad()});
+
+        if (curr->get_size() > 0) {
+            double mass = 0, rad = 0;
+            vector<double> ctr(3, 0);
+            for (int i = curr->get_offset(); i < curr->get_offset() + curr->get_size(); i++) {
+                mass += g[t.get_perm(i)];
+                for (int d = 0; d < 3; d++) {
+                    ctr[d] += g[t.get_perm(i)] * p[3 * t.get_perm(i) + d];
+                }
+            }
+            for (int d = 0; d < 3; d++) {
+                ctr[d] /= mass;
+            }
+            for (int i = curr->get_offset(); i < curr->get_offset() + curr->get_size(); i++) {
+                rad = std::max(rad, norm2(vector<double>(p.begin() + 3 * t.get_perm(i), p.begin() + 3 * t.get_perm(i) + 3) - vector<double>(curr->get_ctr_data(), curr->get_ctr_data() + 3)));
+            }
+            test = test || !(norm2(ctr - vector<double>(curr->get_ctr_data(), curr->get_ctr_data() + 3)) < 1e-10);
+            test = test || !(std::abs(rad - curr->get_rad()) < 1e-10);
+        }
+
+        if (curr->IsLeaf()) {
+            max_depth = std::max(max_depth, curr->get_depth());
+            min_depth = (min_depth < 0) ? curr->get_depth() : std::min(min_depth, curr->get_depth());
+        }
+        int count = 0;
+        for (int l = 0; l < curr->get_nb_sons(); l++) {
+            test = test || !(curr->get_son(l).get_offset() == curr->get_offset() + count);
+            test = test || !(curr->get_son(l).get_depth() == curr->get_depth() + 1 && curr->get_son(l).get_counter() == curr->get_counter() * curr->get_nb_sons() + l);
+            test = test || !(curr == &root || curr->get_son(l).get_rank() == curr->get_rank());
+            count += curr->get_son(l).get_size();
+            s.push(&(curr->get_son(l)));
+        }
+        test = test || !(curr->IsLeaf() || count == curr->get_size());
+    }
+    test = test || !(t.get_min_depth() == min_depth && t.get_max_depth() == max_depth);
+
+    // Same tree on all processes
+    int nb_nodes = nodes.size(), nb_nodes_0 = nodes.size();
+    MPI_Bcast(&nb_nodes_0, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    test = test || !(nb_nodes == nb_nodes_0);
+    if (nb_nodes == nb_nodes_0) {
+        vector<double> nodes_0(nodes);
+        MPI_Bcast(nodes_0.data(), nb_nodes, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        test = test || !(nodes == nodes_0);
+    }
+
+    int global_test = test;
+    MPI_Allreduce(MPI_IN_PLACE, &global_test, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    test = global_test;
+    if (rankWorld == 0) {
+        cout << "Number of sons : " << nb_sons << ", depths : " << min_depth << " " << max_depth << ", nodes : " << nodes.size() / 3 << ", test : " << test << endl;
+    }
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int rankWorld, sizeWorld;
+    MPI_Comm_size(MPI_COMM_WORLD, &sizeWorld);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+
+    int nb_pt = 20000;
+    vector<double> p(3 * nb_pt), g(nb_pt);
+    srand(1);
+    create_disk(3, 0, nb_pt, p.data());
+    for (int i = 0; i < nb_pt; i++) {
+        g[i] = 1 + i % 3;
+    }
+
+    bool test = 0;
+    for (int nb_sons : {2, 4}) {
+        test = test || test_distributed_build<Cluster<PCARegularClustering>>(nb_pt, p, g, nb_sons, true, rankWorld, sizeWorld);
+        test = test || test_distributed_build<Cluster<PCAGeometricClustering>>(nb_pt, p, g, nb_sons, false, rankWorld, sizeWorld);
+        test = test || test_distributed_build<Cluster<BoundingBox1RegularClustering>>(nb_pt, p, g, nb_sons, true, rankWorld, sizeWorld);
+        test = test || test_distributed_build<Cluster<BoundingBox1GeometricClustering>>(nb_pt, p, g, nb_sons, false, rankWorld, sizeWorld);
+    }
+
+    if (rankWorld == 0) {
+        cout << "test: " << test << endl;
+    }
+    MPI_Finalize();
+    return test;
+}
@@ -1,5 +1,6 @@
 #include <htool/clustering/bounding_box_1.hpp>
 #include <htool/clustering/pca.hpp>
+#include <htool/clustering/space_filling_curve.hpp>
 #include <htool/testing/geometry.hpp>
 #include <random>
 
@@ -98,11 +99,13 @@ int test_cluster_global(int argc, char *argv[]) {
             }
         }
 
-        // Testing save and read cluster
-        t.save_cluster("test_cluster");
+        // Testing save and read cluster, files are named after the test so that tests can run concurrently
+        string name   = argv[0];
+        string prefix = name.substr(name.find_last_of('/') + 1) + "_" + NbrToStr(sizeWorld) + "_" + NbrToStr(dim) + "_";
+        t.save_cluster(prefix + "cluster");
         MPI_Barrier(MPI_COMM_WORLD);
         Cluster_type copy_t(dim);
-        copy_t.read_cluster("test_cluster_permutation.csv", "test_cluster_tree.csv");
+        copy_t.read_cluster(prefix + "cluster_permutation.csv", prefix + "cluster_tree.csv");
 
         std::stack<VirtualCluster const *> s_save;
         std::stack<VirtualCluster const *> s_read;
@@ -1,5 +1,6 @@
 #include <htool/clustering/bounding_box_1.hpp>
 #include <htool/clustering/pca.hpp>
+#include <htool/clustering/space_filling_curve.hpp>
 #include <htool/testing/geometry.hpp>
 #include <random>
 
@@ -0,0 +1,85 @@
+#include <htool/clustering/bounding_box_1.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/clustering/space_filling_curve.hpp>
+#include <htool/testing/geometry.hpp>
+#include <iostream>
+#if _OPENMP
+#    include <omp.h>
+#endif
+
+using namespace std;
+using namespace htool;
+
+// Same nodes, in the same order
+bool same_tree(const VirtualCluster &a, const VirtualCluster &b) {
+    bool same = a.get_offset() == b.get_offset() && a.get_size() == b.get_size() && a.get_rank() == b.get_rank() && a.get_counter() == b.get_counter() && a.get_depth() == b.get_depth() && a.get_rad() == b.get_rad() && std::equal(a.get_ctr_data(), a.get_ctr_data() + a.get_space_dim(), b.get_ctr_data()) && a.get_nb_sons() == b.get_nb_sons();
+    for (int p = 0; same && p < a.get_nb_sons(); p++) {
+        same = same_tree(a.get_son(p), b.get_son(p));
+    }
+    return same;
+}
+
+// Trees built by OpenMP tasks against the build with one thread, with and without a given partition
+template <typename ClusterType>
+bool test_parallel_build(int nb_pt, const vector<double> &p, const vector<double> &r, const vector<double> &g, int nb_threads, int rankWorld, int sizeWorld) {
+    bool test = 0;
+    std::vector<int> MasterOffset;
+    for (int i = 0; i < sizeWorld; i++) {
+        MasterOffset.push_back(i * (nb_pt / sizeWorld));
+        MasterOffset.push_back(i == sizeWorld - 1 ? nb_pt - i * (nb_pt / sizeWorld) : nb_pt / sizeWorld);
+    }
+    for (bool local : {false, true}) {
+        ClusterType t_serial, t_parallel;
+#if _OPENMP
+        omp_set_num_threads(1);
+#endif
+        local ? t_serial.build(nb_pt, p.data(), r.data(), g.data(), MasterOffset.data(), 2) : t_serial.build(nb_pt, p.data(), r.data(), g.data(), 2);
+#if _OPENMP
+        omp_set_num_threads(nb_threads);
+#endif
+        double time = MPI_Wtime();
+        local ? t_parallel.build(nb_pt, p.data(), r.data(), g.data(), MasterOffset.data(), 2) : t_parallel.build(nb_pt, p.data(), r.data(), g.data(), 2);
+        time = MPI_Wtime() - time;
+
+        test = test || !(t_serial.get_perm() == t_parallel.get_perm());
+        test = test || !(same_tree(*t_serial.get_root(), *t_parallel.get_root()));
+        test = test || !(t_serial.get_min_depth() == t_parallel.get_min_depth() && t_serial.get_max_depth() == t_parallel.get_max_depth());
+        test = test || !(t_serial.get_masteroffset() == t_parallel.get_masteroffset());
+        test = test || !(t_serial.get_local_offset() == t_parallel.get_local_offset() && t_serial.get_local_size() == t_parallel.get_local_size());
+        if (rankWorld == 0) {
+            cout << "Local partition: " << local << ", depths: " << t_parallel.get_min_depth() << " " << t_parallel.get_max_depth() << ", time with " << nb_threads << " threads: " << time << ", test: " << test << endl;
+        }
+    }
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int rankWorld, sizeWorld;
+    MPI_Comm_size(MPI_COMM_WORLD, &sizeWorld);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+
+    // Large enough for tasks and chunked reductions
+    int nb_pt      = 100000;
+    int nb_threads = 4;
+    vector<double> p(3 * nb_pt), r(nb_pt, 0), g(nb_pt, 1);
+    srand(1);
+    create_disk(3, 0, nb_pt, p.data());
+    for (int i = 0; i < nb_pt; i++) {
+        g[i] = 1 + i % 3;
+    }
+
+    bool test = 0;
+    test      = test || test_parallel_build<Cluster<PCARegularClustering>>(nb_pt, p, r, g, nb_threads, rankWorld, sizeWorld);
+    test      = test || test_parallel_build<Cluster<PCAGeometricClustering>>(nb_pt, p, r, g, nb_threads, rankWorld, sizeWorld);
+    test      = test || test_parallel_build<Cluster<BoundingBox1RegularClustering>>(nb_pt, p, r, g, nb_threads, rankWorld, sizeWorld);
+    test      = test || test_parallel_build<Cluster<BoundingBox1GeometricClustering>>(nb_pt, p, r, g, nb_threads, rankWorld, sizeWorld);
+    test      = test || test_parallel_build<Cluster<MortonClustering>>(nb_pt, p, r, g, nb_threads, rankWorld, sizeWorld);
+    test      = test || test_parallel_build<Cluster<HilbertClustering>>(nb_pt, p, r, g, nb_threads, rankWorld, sizeWorld);
+
+    if (rankWorld == 0) {
+        cout << "test: " << test << endl;
+    }
+    MPI_Finalize();
+    return test;
+}
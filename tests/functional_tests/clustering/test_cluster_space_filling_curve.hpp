@@ -0,0 +1,91 @@
+#include <htool/clustering/space_filling_curve.hpp>
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+using namespace std;
+using namespace htool;
+
+// Radix sort against a stable sort, with several chunks and keys sharing digits
+int test_radix_sort() {
+    bool test = 0;
+
+    int size = 100000;
+    std::mt19937_64 generator(1);
+    std::vector<std::uint64_t> keys(size);
+    std::vector<int> indices(size);
+    for (int i = 0; i < size; i++) {
+        keys[i]    = (generator() % 1000) << 40 | (generator() % 3) << 8;
+        indices[i] = i;
+    }
+
+    std::vector<std::pair<std::uint64_t, int>> ref(size);
+    for (int i = 0; i < size; i++) {
+        ref[i] = std::make_pair(keys[i], indices[i]);
+    }
+    std::stable_sort(ref.begin(), ref.end(), [](const std::pair<std::uint64_t, int> &a, const std::pair<std::uint64_t, int> &b) { return a.first < b.first; });
+
+    radix_sort(keys, indices);
+    for (int i = 0; i < size; i++) {
+        test = test || !(keys[i] == ref[i].first && indices[i] == ref[i].second);
+    }
+
+    std::cout << "test radix sort " << test << std::endl;
+    return test;
+}
+
+// Points of a regular grid with 2^nb_levels points per axis, in random order. Each group of 2^dim consecutive points
+// along the curve is a cell of the grid, and along the Hilbert curve consecutive points are neighbours
+template <typename Cluster_type, int dim>
+int test_curve_order(int nb_levels, bool neighbours) {
+    bool test = 0;
+
+    int nb_pt_per_axis = 1 << nb_levels;
+    int size           = 1;
+    for (int p = 0; p < dim; p++) {
+        size *= nb_pt_per_axis;
+    }
+    std::vector<int> grid_numbering(size);
+    std::iota(grid_numbering.begin(), grid_numbering.end(), 0);
+    std::shuffle(grid_numbering.begin(), grid_numbering.end(), std::mt19937(1));
+
+    std::vector<int> grid_coordinates(dim * size);
+    vector<double> p(dim * size);
+    for (int j = 0; j < size; j++) {
+        int index = grid_numbering[j];
+        for (int q = 0; q < dim; q++) {
+            grid_coordinates[dim * j + q] = index % nb_pt_per_axis;
+            p[dim * j + q]                = 0.1 * (index % nb_pt_per_axis);
+            index /= nb_pt_per_axis;
+        }
+    }
+
+    Cluster_type t(dim);
+    t.build(size, p.data(), 2);
+    const std::vector<int> &perm = t.get_perm();
+
+    int cell_size = 1 << dim;
+    for (int j = 0; j < size; j += cell_size) {
+        for (int q = 0; q < dim; q++) {
+            int min_coordinate = nb_pt_per_axis, max_coordinate = -1;
+            for (int k = j; k < j + cell_size; k++) {
+                min_coordinate = std::min(min_coordinate, grid_coordinates[dim * perm[k] + q]);
+                max_coordinate = std::max(max_coordinate, grid_coordinates[dim * perm[k] + q]);
+            }
+            test = test || !(min_coordinate % 2 == 0 && max_coordinate == min_coordinate + 1);
+        }
+    }
+
+    if (neighbours) {
+        for (int j = 0; j < size - 1; j++) {
+            int distance = 0;
+            for (int q = 0; q < dim; q++) {
+                distance += std::abs(grid_coordinates[dim * perm[j] + q] - grid_coordinates[dim * perm[j + 1] + q]);
+            }
+            test = test || !(distance == 1);
+        }
+    }
+
+    std::cout << "test curve order " << test << std::endl;
+    return test;
+}
@@ -0,0 +1,27 @@
+#include "test_cluster_global.hpp"
+#include "test_cluster_local.hpp"
+#include "test_cluster_space_filling_curve.hpp"
+
+using namespace std;
+using namespace htool;
+
+int main(int argc, char *argv[]) {
+
+    MPI_Init(&argc, &argv);
+
+    bool test = test_cluster_global<Cluster<HilbertClustering>, 2>(argc, argv);
+
+    test = test || test_cluster_global<Cluster<HilbertClustering>, 3>(argc, argv);
+
+    test = test || test_cluster_local<Cluster<HilbertClustering>, 2>(argc, argv);
+
+    test = test || test_cluster_local<Cluster<HilbertClustering>, 3>(argc, argv);
+
+    test = test || test_curve_order<Cluster<HilbertClustering>, 2>(6, true);
+
+    test = test || test_curve_order<Cluster<HilbertClustering>, 3>(4, true);
+
+    test = test || test_radix_sort();
+    MPI_Finalize();
+    return test;
+}
\ No newline at end of file
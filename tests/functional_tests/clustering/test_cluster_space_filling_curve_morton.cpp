@@ -0,0 +1,27 @@
+#include "test_cluster_global.hpp"
+#include "test_cluster_local.hpp"
+#include "test_cluster_space_filling_curve.hpp"
+
+using namespace std;
+using namespace htool;
+
+int main(int argc, char *argv[]) {
+
+    MPI_Init(&argc, &argv);
+
+    bool test = test_cluster_global<Cluster<MortonClustering>, 2>(argc, argv);
+
+    test = test || test_cluster_global<Cluster<MortonClustering>, 3>(argc, argv);
+
+    test = test || test_cluster_local<Cluster<MortonClustering>, 2>(argc, argv);
+
+    test = test || test_cluster_local<Cluster<MortonClustering>, 3>(argc, argv);
+
+    test = test || test_curve_order<Cluster<MortonClustering>, 2>(6, false);
+
+    test = test || test_curve_order<Cluster<MortonClustering>, 3>(4, false);
+
+    test = test || test_radix_sort();
+    MPI_Finalize();
+    return test;
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include <htool/clustering/flat_cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/testing/geometry.hpp>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace htool;
+
+// Same nodes, in the same order
+bool same_tree(const VirtualCluster &a, const VirtualCluster &b) {
+    bool same = a.get_offset() == b.get_offset() && a.get_size() == b.get_size() && a.get_rank() == b.get_rank() && a.get_counter() == b.get_counter() && a.get_depth() == b.get_depth() && a.get_rad() == b.get_rad() && std::equal(a.get_ctr_data(), a.get_ctr_data() + a.get_space_dim(), b.get_ctr_data()) && a.get_nb_sons() == b.get_nb_sons() && a.IsLeaf() == b.IsLeaf();
+    for (int p = 0; same && p < a.get_nb_sons(); p++) {
+        same = same_tree(a.get_son(p), b.get_son(p));
+    }
+    return same;
+}
+
+// Same global data
+bool same_global_data(const VirtualCluster &a, const VirtualCluster &b) {
+    return a.get_perm() == b.get_perm() && a.get_masteroffset() == b.get_masteroffset() && a.get_local_offset() == b.get_local_offset() && a.get_local_size() == b.get_local_size() && a.get_space_dim() == b.get_space_dim() && a.get_minclustersize() == b.get_minclustersize() && a.get_ndofperelt() == b.get_ndofperelt() && a.IsLocal() == b.IsLocal();
+}
+
+string read_file(const string &filename) {
+    ifstream input(filename);
+    stringstream content;
+    content << input.rdbuf();
+    return content.str();
+}
+
+// Outputs are written in files starting with prefix
+template <typename ClusterType>
+bool test_flat_cluster(ClusterType &t, const vector<double> &p, int rankWorld, const string &prefix) {
+    bool test = 0;
+    FlatCluster flat(t);
+
+    test = test || !(same_tree(t, flat) && same_tree(t, *flat.get_root()));
+    test = test || !(same_global_data(t, flat) && t.get_max_depth() == flat.get_max_depth() && t.get_min_depth() == flat.get_min_depth());
+    test = test || !(same_tree(t.get_local_cluster(), flat.get_local_cluster()));
+    if (t.IsLocal()) {
+        test = test || !(t.get_local_perm() == flat.get_local_perm());
+    }
+
+    // Nodes in breadth-first order, sons are consecutive
+    std::vector<const VirtualCluster *> queue(1, flat.get_root());
+    for (int i = 0; i < queue.size(); i++) {
+        test = test || !(static_cast<const FlatCluster *>(queue[i])->get_index() == i);
+        test = test || !(static_cast<const FlatCluster *>(queue[i])->get_ctr() == flat.get_ctr() + flat.get_space_dim() * i);
+        for (int l = 0; l < queue[i]->get_nb_sons(); l++) {
+            test = test || !(static_cast<const FlatCluster *>(&(queue[i]->get_son(l))) == static_cast<const FlatCluster *>(&(queue[i]->get_son(0))) + l);
+            queue.push_back(&(queue[i]->get_son(l)));
+        }
+    }
+
+    // Local cluster trees
+    std::shared_ptr<VirtualCluster> local_cluster_tree      = t.get_local_cluster_tree();
+    std::shared_ptr<VirtualCluster> flat_local_cluster_tree = flat.get_local_cluster_tree();
+    test                                                    = test || !(same_tree(*local_cluster_tree, *flat_local_cluster_tree) && same_global_data(*local_cluster_tree, *flat_local_cluster_tree));
+
+    // Same outputs
+    t.save_cluster(prefix + "cluster");
+    flat.save_cluster(prefix + "flat_cluster");
+    t.save_geometry(p.data(), prefix + "geometry", {1, 2, 3});
+    flat.save_geometry(p.data(), prefix + "flat_geometry", {1, 2, 3});
+    if (rankWorld == 0) {
+        test = test || !(read_file(prefix + "cluster_permutation.csv") == read_file(prefix + "flat_cluster_permutation.csv"));
+        test = test || !(read_file(prefix + "cluster_tree.csv") == read_file(prefix + "flat_cluster_tree.csv"));
+        test = test || !(read_file(prefix + "geometry.csv") == read_file(prefix + "flat_geometry.csv"));
+    }
+
+    // Immutable
+    try {
+        flat.set_offset(0);
+        test = 1;
+    } catch (const std::logic_error &) {
+    }
+    try {
+        flat.build(int(p.size() / 3), p.data());
+        test = 1;
+    } catch (const std::logic_error &) {
+    }
+
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+    MPI_Init(&argc, &argv);
+    int rankWorld, sizeWorld;
+    MPI_Comm_size(MPI_COMM_WORLD, &sizeWorld);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rankWorld);
+
+    int nb_pt = 2000;
+    vector<double> p(3 * nb_pt);
+    srand(1);
+    create_disk(3, 0, nb_pt, p.data());
+
+    // Unique names, so that runs with different numbers of processes do not share files
+    string prefix = "test_flat_cluster_" + NbrToStr(sizeWorld) + "_";
+
+    bool test = 0;
+    Cluster<PCARegularClustering> t;
+    t.build(nb_pt, p.data(), 2);
+    test = test || test_flat_cluster(t, p, rankWorld, prefix);
+
+    // With a given partition, the permutation is local
+    std::vector<int> MasterOffset;
+    for (int i = 0; i < sizeWorld; i++) {
+        MasterOffset.push_back(i * (nb_pt / sizeWorld));
+        MasterOffset.push_back(i == sizeWorld - 1 ? nb_pt - i * (nb_pt / sizeWorld) : nb_pt / sizeWorld);
+    }
+    Cluster<PCAGeometricClustering> t_local;
+    t_local.build(nb_pt, p.data(), MasterOffset.data(), 4);
+    test = test || test_flat_cluster(t_local, p, rankWorld, prefix);
+
+    if (rankWorld == 0) {
+        cout << "test: " << test << endl;
+    }
+    MPI_Finalize();
+    return test;
+}
@@ -5,6 +5,7 @@
 #include "test_lrmat.hpp"
 #include <htool/clustering/pca.hpp>
 #include <htool/lrmat/SVD.hpp>
+#include <htool/lrmat/partialACA.hpp>
 
 using namespace std;
 using namespace htool;
@@ -91,6 +92,30 @@ int main(int argc, char *argv[]) {
         A_SVD.set_epsilon(epsilon);
         A_SVD.build(A, compressor_SVD, t, xt.data(), s, xs.data());
 
+        // Fallback above the size cap
+        SVD<double> compressor_capped(sizeof(double) * nr * nc - 1, std::make_shared<partialACA<double>>());
+        LowRankMatrix<double> A_capped(A.get_dimension(), t.get_perm(), s.get_perm());
+        A_capped.set_epsilon(epsilon);
+        A_capped.build(A, compressor_capped, t, xt.data(), s, xs.data());
+        partialACA<double> compressor_partialACA;
+        LowRankMatrix<double> A_partialACA(A.get_dimension(), t.get_perm(), s.get_perm());
+        A_partialACA.set_epsilon(epsilon);
+        A_partialACA.build(A, compressor_partialACA, t, xt.data(), s, xs.data());
+        test = test || !(A_capped.rank_of() == A_partialACA.rank_of());
+        for (int j = 0; j < A_capped.rank_of(); j++) {
+            for (int i = 0; i < nr; i++) {
+                test = test || !(A_capped.get_U(i, j) == A_partialACA.get_U(i, j));
+            }
+        }
+
+        // No fallback below the size cap
+        SVD<double> compressor_uncapped(sizeof(double) * nr * nc);
+        LowRankMatrix<double> A_uncapped(A.get_dimension(), t.get_perm(), s.get_perm());
+        A_uncapped.set_epsilon(epsilon);
+        A_uncapped.build(A, compressor_uncapped, t, xt.data(), s, xs.data());
+        test = test || !(A_uncapped.rank_of() == A_SVD.rank_of());
+        cout << "> Ranks with automatic building, SVD: " << A_SVD.rank_of() << ", SVD with fallback: " << A_capped.rank_of() << endl;
+
         std::pair<double, double> fixed_compression_interval(0.87, 0.89);
         std::pair<double, double> auto_compression_interval(0.95, 0.97);
         test = test || test_lrmat(A, A_SVD_fixed, A_SVD, t.get_perm(), s.get_perm(), fixed_compression_interval, auto_compression_interval, 1);
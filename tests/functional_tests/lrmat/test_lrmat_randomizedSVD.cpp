@@ -0,0 +1,103 @@
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include "test_lrmat.hpp"
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/SVD.hpp>
+#include <htool/lrmat/randomizedSVD.hpp>
+
+using namespace std;
+using namespace htool;
+
+int main(int argc, char *argv[]) {
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    bool verbose = 1;
+    if (argc >= 2) {
+        verbose = argv[1]; // LCOV_EXCL_LINE
+    }
+
+    const int ndistance = 4;
+    double distance[ndistance];
+    distance[0] = 15;
+    distance[1] = 20;
+    distance[2] = 30;
+    distance[3] = 40;
+
+    double epsilon = 0.0001;
+
+    int nr = 500;
+    int nc = 100;
+    std::vector<double> xt(3 * nr);
+    std::vector<double> xs(3 * nc);
+    std::vector<int> tabt(500);
+    std::vector<int> tabs(100);
+    bool test = 0;
+    for (int idist = 0; idist < ndistance; idist++) {
+
+        srand(1);
+        // we set a constant seed for rand because we want always the same result if we run the check many times
+        // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+        create_disk(3, 0, nr, xt.data());
+        create_disk(3, distance[idist], nc, xs.data());
+
+        Cluster<PCAGeometricClustering> t, s;
+
+        std::vector<int> tabt(xt.size()), tabs(xs.size());
+        std::iota(tabt.begin(), tabt.end(), int(0));
+        std::iota(tabs.begin(), tabs.end(), int(0));
+        t.build(nr, xt.data());
+        s.build(nc, xs.data());
+
+        GeneratorTestDouble A(3, nr, nc, xt, xs);
+
+        // randomizedSVD fixed rank
+        int reqrank_max = 10;
+        LowRankMatrix<double> A_randomizedSVD_fixed(A.get_dimension(), t.get_perm(), s.get_perm(), reqrank_max, epsilon);
+        randomizedSVD<double> compressor;
+        A_randomizedSVD_fixed.build(A, compressor, t, xt.data(), s, xs.data());
+
+        // randomizedSVD automatic building
+        LowRankMatrix<double> A_randomizedSVD(A.get_dimension(), t.get_perm(), s.get_perm());
+        A_randomizedSVD.set_epsilon(epsilon);
+        A_randomizedSVD.build(A, compressor, t, xt.data(), s, xs.data());
+
+        // Near optimal approximation, compared to SVD
+        SVD<double> compressor_SVD;
+        LowRankMatrix<double> A_SVD_fixed(A.get_dimension(), t.get_perm(), s.get_perm(), reqrank_max, epsilon);
+        A_SVD_fixed.build(A, compressor_SVD, t, xt.data(), s, xs.data());
+        LowRankMatrix<double> A_SVD(A.get_dimension(), t.get_perm(), s.get_perm());
+        A_SVD.set_epsilon(epsilon);
+        A_SVD.build(A, compressor_SVD, t, xt.data(), s, xs.data());
+        double randomized_error = Frobenius_absolute_error(A_randomizedSVD_fixed, A);
+        double SVD_error        = Frobenius_absolute_error(A_SVD_fixed, A);
+        test                    = test || !(randomized_error < 1.5 * SVD_error);
+        test                    = test || !(A_randomizedSVD.rank_of() <= A_SVD.rank_of() + 1);
+        cout << "> Errors with fixed rank, randomizedSVD: " << randomized_error << ", SVD: " << SVD_error << endl;
+        cout << "> Ranks with automatic building, randomizedSVD: " << A_randomizedSVD.rank_of() << ", SVD: " << A_SVD.rank_of() << endl;
+
+        // Same approximation for the same seed
+        LowRankMatrix<double> A_randomizedSVD_bis(A.get_dimension(), t.get_perm(), s.get_perm());
+        A_randomizedSVD_bis.set_epsilon(epsilon);
+        A_randomizedSVD_bis.build(A, compressor, t, xt.data(), s, xs.data());
+        test = test || !(A_randomizedSVD_bis.rank_of() == A_randomizedSVD.rank_of());
+        for (int j = 0; j < A_randomizedSVD.rank_of(); j++) {
+            for (int i = 0; i < nr; i++) {
+                test = test || !(A_randomizedSVD_bis.get_U(i, j) == A_randomizedSVD.get_U(i, j));
+            }
+        }
+
+        std::pair<double, double> fixed_compression_interval(0.87, 0.89);
+        std::pair<double, double> auto_compression_interval(0.95, 0.98);
+        test = test || (test_lrmat(A, A_randomizedSVD_fixed, A_randomizedSVD, t.get_perm(), s.get_perm(), fixed_compression_interval, auto_compression_interval, verbose, 3));
+    }
+
+    cout << "test : " << test << endl;
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+
+    return test;
+}
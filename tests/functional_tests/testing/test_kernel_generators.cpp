@@ -0,0 +1,127 @@
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/testing/kernel_generators.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+double point_distance(const vector<double> &p1, int i, const vector<double> &p2, int j) {
+    return std::sqrt(std::pow(p1[3 * i] - p2[3 * j], 2) + std::pow(p1[3 * i + 1] - p2[3 * j + 1], 2) + std::pow(p1[3 * i + 2] - p2[3 * j + 2], 2));
+}
+
+// Compares a block computed by the generator with the kernel evaluated coefficient by coefficient
+template <typename T, typename Kernel>
+double block_error(const VirtualGenerator<T> &generator, const vector<double> &p1, const vector<double> &p2, const vector<int> &rows, const vector<int> &cols, Kernel kernel) {
+    vector<T> block(rows.size() * cols.size());
+    generator.copy_submatrix(rows.size(), cols.size(), rows.data(), cols.data(), block.data());
+    double error = 0;
+    for (int j = 0; j < cols.size(); j++) {
+        for (int i = 0; i < rows.size(); i++) {
+            double r = point_distance(p1, rows[i], p2, cols[j]);
+            if (r > 0) {
+                T ref = kernel(r);
+                error = std::max(error, std::abs(block[i + rows.size() * j] - ref) / std::abs(ref));
+            } else {
+                error = std::max(error, std::abs(block[i + rows.size() * j]));
+            }
+        }
+    }
+    return error;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    bool test = 0;
+    int nr    = 500;
+    int nc    = 400;
+    vector<double> p1(3 * nr), p2(3 * nc);
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, 1, nr, p1.data());
+    create_disk(3, 2, nc, p2.data());
+
+    // Blocks with arbitrary indices, including coinciding points in the symmetric case
+    vector<int> rows, cols;
+    for (int i = 0; i < nr; i += 3) {
+        rows.push_back(i);
+    }
+    for (int j = nc - 1; j >= 0; j -= 2) {
+        cols.push_back(j);
+    }
+
+    double kappa = 2;
+    double k     = 5;
+    LaplaceSingleLayerGenerator laplace(nr, nc, p1.data(), p2.data());
+    LaplaceSingleLayerGenerator laplace_sym(nr, p1.data());
+    YukawaSingleLayerGenerator yukawa(kappa, nr, nc, p1.data(), p2.data());
+    YukawaSingleLayerGenerator yukawa_sym(kappa, nr, p1.data());
+    HelmholtzSingleLayerGenerator helmholtz(k, nr, nc, p1.data(), p2.data());
+    HelmholtzSingleLayerGenerator helmholtz_sym(k, nr, p1.data());
+
+    auto laplace_kernel   = [](double r) { return 1. / (4 * M_PI * r); };
+    auto yukawa_kernel    = [kappa](double r) { return std::exp(-kappa * r) / (4 * M_PI * r); };
+    auto helmholtz_kernel = [k](double r) { return std::exp(std::complex<double>(0, k * r)) / (4 * M_PI * r); };
+
+    vector<double> errors;
+    errors.push_back(block_error(laplace, p1, p2, rows, cols, laplace_kernel));
+    errors.push_back(block_error(laplace_sym, p1, p1, rows, rows, laplace_kernel));
+    errors.push_back(block_error(yukawa, p1, p2, rows, cols, yukawa_kernel));
+    errors.push_back(block_error(yukawa_sym, p1, p1, rows, rows, yukawa_kernel));
+    errors.push_back(block_error(helmholtz, p1, p2, rows, cols, helmholtz_kernel));
+    errors.push_back(block_error(helmholtz_sym, p1, p1, rows, rows, helmholtz_kernel));
+    for (double error : errors) {
+        test = test || !(error < 1e-14);
+    }
+    cout << "Errors on blocks : " << errors << endl;
+
+    // Same coefficients as the generator used in other tests
+    GeneratorTestDouble reference(3, nr, nc, p1, p2);
+    vector<double> block(rows.size() * cols.size()), block_ref(rows.size() * cols.size());
+    laplace.copy_submatrix(rows.size(), cols.size(), rows.data(), cols.data(), block.data());
+    reference.copy_submatrix(rows.size(), cols.size(), rows.data(), cols.data(), block_ref.data());
+    double error_ref = norm2(block - block_ref) / norm2(block_ref);
+    test             = test || !(error_ref < 1e-14);
+    cout << "Error with GeneratorTestDouble : " << error_ref << endl;
+
+    // HMatrix
+    double epsilon = 1e-6;
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    std::shared_ptr<Cluster<PCARegularClustering>> s = make_shared<Cluster<PCARegularClustering>>();
+    t->build(nr, p1.data(), 2);
+    s->build(nc, p2.data(), 2);
+    HMatrix<double> HA(t, s, epsilon, 10);
+    HA.build(laplace, p1.data(), p2.data());
+
+    vector<double> f(nc, 1), result(nr, 0);
+    generate_random_vector(f);
+    MPI_Bcast(f.data(), nc, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    HA.mvprod_global_to_global(f.data(), result.data(), 1);
+    double erreur2 = norm2(reference * f - result) / norm2(reference * f);
+    test           = test || !(erreur2 < epsilon);
+
+    if (rank == 0) {
+        cout << "Errors on a mat vec prod : " << erreur2 << endl;
+        cout << "test: " << test << endl;
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
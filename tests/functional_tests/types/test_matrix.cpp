@@ -193,6 +193,14 @@ int main(int argc, char const *argv[]) {
     test  = test || !(error < 1e-16);
     cout << "Error on submatrix : " << error << endl;
 
+    // Submatrix indices are copied, unless they are referenced
+    test = test || !(SMd.data_ir() != ir.data() && SMd.data_ic() != ic.data());
+    test = test || !(SMd.get_ir() == ir && SMd.get_ic() == ic);
+    SubMatrix<double> SMd_reference(ReferenceIndices(), Generator, ir.size(), ic.size(), ir.data(), ic.data());
+    test = test || !(SMd_reference.data_ir() == ir.data() && SMd_reference.data_ic() == ic.data());
+    SubMatrix<double> SMd_copy(SMd);
+    test = test || !(SMd_copy.data_ir() != SMd.data_ir() && SMd_copy.get_ir() == ir);
+
     cout << test << endl;
     return test;
 }
@@ -0,0 +1,94 @@
+#include "htool/types/matvec_schedule.hpp"
+#include <atomic>
+#include <iostream>
+#include <vector>
+using namespace std;
+using namespace htool;
+
+// Intervals of a binary tree, as the rows of the blocks of an HMatrix, with several blocks per interval
+void add_intervals(int begin, int size, vector<int> &begins, vector<int> &sizes) {
+    for (int k = 0; k < 1 + begin % 3; k++) {
+        begins.push_back(begin);
+        sizes.push_back(size);
+    }
+    if (size > 10) {
+        add_intervals(begin, size / 2, begins, sizes);
+        add_intervals(begin + size / 2, size - size / 2, begins, sizes);
+    }
+}
+
+int main(int argc, char const *argv[]) {
+    bool test = 0;
+
+    vector<int> begins, sizes;
+    add_intervals(0, 1000, begins, sizes);
+    vector<double> costs(sizes.begin(), sizes.end());
+    int band_size = 100;
+
+    MatvecSchedule schedule(begins, sizes, costs, band_size);
+    const vector<vector<int>> &bands          = schedule.get_bands();
+    const vector<vector<vector<int>>> &colors = schedule.get_colors();
+    auto overlap                              = [&](int i, int j) { return begins[i] < begins[j] + sizes[j] && begins[j] < begins[i] + sizes[i]; };
+
+    // Every item is scheduled once
+    vector<int> nb_scheduled(begins.size(), 0);
+    for (auto &band : bands) {
+        for (int i : band) {
+            nb_scheduled[i]++;
+            test = test || !(sizes[i] <= band_size);
+        }
+    }
+    for (auto &groups : colors) {
+        for (auto &group : groups) {
+            for (int i : group) {
+                nb_scheduled[i]++;
+                test = test || !(sizes[i] > band_size);
+                test = test || !(begins[i] == begins[group[0]] && sizes[i] == sizes[group[0]]);
+            }
+        }
+    }
+    test = test || !(std::all_of(nb_scheduled.begin(), nb_scheduled.end(), [](int n) { return n == 1; }));
+
+    // Different bands and different groups of the same color are disjoint
+    for (int b = 0; b < bands.size(); b++) {
+        for (int c = b + 1; c < bands.size(); c++) {
+            for (int i : bands[b]) {
+                for (int j : bands[c]) {
+                    test = test || overlap(i, j);
+                }
+            }
+        }
+    }
+    for (auto &groups : colors) {
+        for (int g = 0; g < groups.size(); g++) {
+            for (int h = g + 1; h < groups.size(); h++) {
+                test = test || overlap(groups[g][0], groups[h][0]);
+            }
+        }
+    }
+
+    // The intervals are nested, so there is one color per level above band_size
+    test = test || !(bands.size() == 16 && colors.size() == 4);
+    cout << "Number of bands: " << bands.size() << ", number of colors: " << colors.size() << endl;
+
+    // Parallel run
+    vector<atomic<int>> nb_calls(begins.size());
+    for (auto &n : nb_calls) {
+        n = 0;
+    }
+#if _OPENMP
+#    pragma omp parallel
+#endif
+    schedule.run([&](int i) { nb_calls[i]++; });
+    test = test || !(std::all_of(nb_calls.begin(), nb_calls.end(), [](const atomic<int> &n) { return n == 1; }));
+
+    // Items writing two intervals are colored with both intervals, not with their hull
+    vector<int> begins_1 = {0, 400, 50, 0}, sizes_1 = {100, 200, 100, 3}, begins_2 = {900, 0, 0, 5}, sizes_2 = {100, 0, 0, 3};
+    MatvecSchedule schedule_2(begins_1, sizes_1, begins_2, sizes_2, vector<double>(4, 1), 10);
+    test = test || !(schedule_2.get_bands().size() == 1 && schedule_2.get_bands()[0] == vector<int>{3});
+    test = test || !(schedule_2.get_colors().size() == 2 && schedule_2.get_colors()[0].size() == 2 && schedule_2.get_colors()[1] == vector<vector<int>>{{2}});
+    cout << "Number of colors with two intervals: " << schedule_2.get_colors().size() << endl;
+
+    cout << "test: " << test << endl;
+    return test;
+}
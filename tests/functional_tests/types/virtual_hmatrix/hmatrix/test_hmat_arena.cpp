@@ -0,0 +1,99 @@
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test         = 0;
+    double epsilon    = 1e-8;
+    double eta        = 0.1;
+    double distance[] = {0.5, 10};
+
+    for (int idist = 0; idist < 2; idist++) {
+        int nr = 500;
+        int nc = 400;
+
+        double z1 = 1;
+        double z2 = 1 + distance[idist];
+        vector<double> p1(3 * nr);
+        vector<double> p2(3 * nc);
+
+        srand(1);
+        // we set a constant seed for rand because we want always the same result if we run the check many times
+        // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+        create_disk(3, z1, nr, p1.data());
+        create_disk(3, z2, nc, p2.data());
+
+        GeneratorTestDouble A(3, nr, nc, p1, p2);
+        std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+        std::shared_ptr<Cluster<PCARegularClustering>> s = make_shared<Cluster<PCARegularClustering>>();
+        t->build(nr, p1.data(), 2);
+        s->build(nc, p2.data(), 2);
+
+        std::shared_ptr<partialACA<double>> compressor = std::make_shared<partialACA<double>>();
+
+        // Reference
+        HMatrix<double> HA(t, s, epsilon, eta);
+        HA.set_compression(compressor);
+        HA.build(A, p1.data(), p2.data());
+
+        // Small chunks so that several chunks and dedicated chunks for large blocks are used
+        HMatrix<double> HA_arena(t, s, epsilon, eta);
+        HA_arena.set_compression(compressor);
+        HA_arena.set_use_arena(true);
+        HA_arena.set_arena_chunk_size(1 << 14);
+        HA_arena.build(A, p1.data(), p2.data());
+        HA_arena.print_infos();
+
+        // Memory
+        test = test || !(HA.get_arena_bytes() == 0);
+        test = test || !(HA_arena.get_payload_bytes() == HA.get_payload_bytes());
+        test = test || !(HA_arena.get_arena_bytes() >= HA_arena.get_payload_bytes());
+        if (rank == 0) {
+            test = test || !(StrToNbr<std::size_t>(HA_arena.get_infos("Arena_bytes")) >= StrToNbr<std::size_t>(HA_arena.get_infos("Payload_bytes")));
+        }
+
+        // Same blocks, so same product
+        vector<double> f(nc, 1), result(nr, 0), result_arena(nr, 0);
+        generate_random_vector(f);
+        MPI_Bcast(f.data(), nc, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        HA.mvprod_global_to_global(f.data(), result.data(), 1);
+        HA_arena.mvprod_global_to_global(f.data(), result_arena.data(), 1);
+
+        double erreur_arena = norm2(result - result_arena) / norm2(result);
+        double erreur2      = norm2(A * f - result_arena) / norm2(A * f);
+        test                = test || !(erreur_arena < 1e-14);
+        test                = test || !(erreur2 < epsilon);
+
+        if (rank == 0) {
+            cout << "Arena bytes : " << HA_arena.get_infos("Arena_bytes") << endl;
+            cout << "Payload bytes : " << HA_arena.get_infos("Payload_bytes") << endl;
+            cout << "Difference with the reference : " << erreur_arena << endl;
+            cout << "Errors on a mat vec prod : " << erreur2 << endl;
+            cout << "test: " << test << endl;
+        }
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,128 @@
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/lrmat/sympartialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Asynchronous products overlapped with other work against mvprod_local_to_local
+template <typename T>
+bool test_async(const HMatrix<T> &H, int rank) {
+    bool test      = 0;
+    int local_size = H.get_local_size();
+    for (int mu : {1, 4}) {
+        vector<T> f(local_size * mu), result(local_size * mu), result_async(local_size * mu);
+        generate_random_vector(f);
+        H.mvprod_local_to_local(f.data(), result.data(), mu);
+
+        // Other work until the product is completed, the source is reused right away
+        MatvecPlan<T> plan                         = H.create_matvec_plan(mu);
+        typename HMatrix<T>::MatvecRequest request = H.mvprod_async(f.data(), result_async.data(), plan);
+        vector<T> f_copy(f);
+        std::fill(f.begin(), f.end(), T(0));
+        double other_work = 0;
+        int nb_tests      = 0;
+        while (!request.test()) {
+            for (int i = 0; i < 1000; i++) {
+                other_work += std::sqrt(double(i + nb_tests));
+            }
+            nb_tests++;
+        }
+        request.wait();
+        test = test || !(request.test());
+
+        double error = 0, norm = 0;
+        for (int i = 0; i < local_size * mu; i++) {
+            error += std::norm(result_async[i] - result[i]);
+            norm += std::norm(result[i]);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        MPI_Allreduce(MPI_IN_PLACE, &norm, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        error = std::sqrt(error / norm);
+        test  = test || !(error < 1e-14);
+
+        // Requests completed by their destructor, with the same plan one after the other
+        f                 = f_copy;
+        std::size_t bytes = plan.get_bytes();
+        for (int repeat = 0; repeat < 2; repeat++) {
+            H.mvprod_async(f.data(), result_async.data(), plan);
+            test = test || !(result_async == result);
+        }
+        test = test || !(plan.get_bytes() == bytes);
+
+        if (rank == 0) {
+            cout << "Symmetry: " << H.get_symmetry_type() << ", mu: " << mu << ", number of tests: " << nb_tests << ", difference: " << error << endl;
+        }
+    }
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the number of processes
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test      = 0;
+    double epsilon = 1e-6;
+    double eta     = 10;
+
+    int n = 500;
+    vector<double> p(3 * n);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, 0, n, p.data());
+
+    // Local permutation, as required by mvprod_local_to_local
+    int size_numbering = n / size;
+    std::vector<int> MasterOffset;
+    for (int i = 0; i < size; i++) {
+        MasterOffset.push_back(i * size_numbering);
+        MasterOffset.push_back(i == size - 1 ? n - i * size_numbering : size_numbering);
+    }
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    t->build(n, p.data(), MasterOffset.data(), 2);
+
+    GeneratorTestDoubleSymmetric A_sym(3, n, n, p, p);
+    HMatrix<double> HA(t, t, epsilon, eta);
+    HA.set_compression(std::make_shared<partialACA<double>>());
+    HA.build(A_sym, p.data(), p.data());
+    test = test || test_async(HA, rank);
+
+    HMatrix<double> HA_sym(t, t, epsilon, eta, 'S', 'U');
+    HA_sym.set_compression(std::make_shared<sympartialACA<double>>());
+    HA_sym.build(A_sym, p.data());
+    test = test || test_async(HA_sym, rank);
+
+    GeneratorTestComplexHermitian A_herm(3, n, n, p, p);
+    HMatrix<complex<double>> HA_herm(t, t, epsilon, eta, 'H', 'L');
+    HA_herm.set_compression(std::make_shared<sympartialACA<complex<double>>>());
+    HA_herm.build(A_herm, p.data());
+    test = test || test_async(HA_herm, rank);
+
+    if (rank == 0) {
+        cout << "test: " << test << endl;
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,113 @@
+#include <atomic>
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+class BatchedGenerator : public GeneratorTestDouble {
+  public:
+    mutable std::atomic<int> nb_calls;
+    mutable std::atomic<int> nb_blocks;
+    mutable std::atomic<int> max_batch_size;
+
+    BatchedGenerator(int space_dim, int nr, int nc, const std::vector<double> &p1, const std::vector<double> &p2) : GeneratorTestDouble(space_dim, nr, nc, p1, p2), nb_calls(0), nb_blocks(0), max_batch_size(0) {}
+
+    void copy_submatrices(const std::vector<int> &M, const std::vector<int> &N, const std::vector<const int *> &rows, const std::vector<const int *> &cols, std::vector<double *> &ptr) const override {
+        nb_calls += 1;
+        nb_blocks += M.size();
+        int batch_size = M.size();
+        int current    = max_batch_size;
+        while (current < batch_size && !max_batch_size.compare_exchange_weak(current, batch_size)) {
+        }
+        for (int i = 0; i < M.size(); i++) {
+            this->copy_submatrix(M[i], N[i], rows[i], cols[i], ptr[i]);
+        }
+    }
+};
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test             = 0;
+    double epsilon        = 1e-8;
+    double eta            = 0.1;
+    int batch_sizes[]     = {1, 7, 1000};
+    bool use_arena_list[] = {false, true};
+
+    int nr = 500;
+    int nc = 400;
+
+    double z1 = 1;
+    double z2 = 1.5;
+    vector<double> p1(3 * nr);
+    vector<double> p2(3 * nc);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, z1, nr, p1.data());
+    create_disk(3, z2, nc, p2.data());
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    std::shared_ptr<Cluster<PCARegularClustering>> s = make_shared<Cluster<PCARegularClustering>>();
+    t->build(nr, p1.data(), 2);
+    s->build(nc, p2.data(), 2);
+
+    std::shared_ptr<partialACA<double>> compressor = std::make_shared<partialACA<double>>();
+
+    vector<double> f(nc, 1);
+    generate_random_vector(f);
+    MPI_Bcast(f.data(), nc, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    for (int batch_size : batch_sizes) {
+        for (bool use_arena : use_arena_list) {
+            BatchedGenerator A(3, nr, nc, p1, p2);
+
+            HMatrix<double> HA(t, s, epsilon, eta);
+            HA.set_compression(compressor);
+            HA.set_use_arena(use_arena);
+            HA.set_dense_blocks_batch_size(batch_size);
+            test = test || !(HA.get_dense_blocks_batch_size() == batch_size);
+            HA.build(A, p1.data(), p2.data());
+
+            // Every dense block is computed once, in batches of at most batch_size blocks
+            int nb_dense_blocks = HA.get_MyNearFieldMats().size();
+            test                = test || !(A.nb_blocks == nb_dense_blocks);
+            test                = test || !(A.nb_calls == (nb_dense_blocks + batch_size - 1) / batch_size);
+            test                = test || !(A.max_batch_size <= batch_size);
+
+            std::vector<double> result(nr, 0);
+            HA.mvprod_global_to_global(f.data(), result.data(), 1);
+            double erreur2 = norm2(A * f - result) / norm2(A * f);
+            test           = test || !(erreur2 < epsilon);
+
+            if (rank == 0) {
+                cout << "Batch size : " << batch_size << ", arena : " << use_arena << endl;
+                cout << "Number of calls : " << A.nb_calls << " for " << A.nb_blocks << " blocks" << endl;
+                cout << "Errors on a mat vec prod : " << erreur2 << endl;
+                cout << "test: " << test << endl;
+            }
+        }
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
@@ -9,12 +9,16 @@ int main(int argc, char *argv[]) {
     test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::GeometricSplitting>>, fullACA>(argc, argv);
     test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::GeometricSplitting>>, partialACA>(argc, argv);
     test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::GeometricSplitting>>, sympartialACA>(argc, argv);
+    test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::GeometricSplitting>>, blockedACA>(argc, argv);
+    test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::GeometricSplitting>>, randomizedSVD>(argc, argv);
 
     test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::RegularSplitting>>, SVD>(argc, argv);
 
     test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::RegularSplitting>>, fullACA>(argc, argv);
     test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::RegularSplitting>>, partialACA>(argc, argv);
     test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::RegularSplitting>>, sympartialACA>(argc, argv);
+    test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::RegularSplitting>>, blockedACA>(argc, argv);
+    test = test || test_hmat_cluster<Cluster<PCA<SplittingTypes::RegularSplitting>>, randomizedSVD>(argc, argv);
 
     // Finalize the MPI environment.
     MPI_Finalize();
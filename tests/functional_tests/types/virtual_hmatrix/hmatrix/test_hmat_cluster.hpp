@@ -6,8 +6,10 @@
 #include <htool/clustering/cluster.hpp>
 #include <htool/clustering/pca.hpp>
 #include <htool/lrmat/SVD.hpp>
+#include <htool/lrmat/blockedACA.hpp>
 #include <htool/lrmat/fullACA.hpp>
 #include <htool/lrmat/partialACA.hpp>
+#include <htool/lrmat/randomizedSVD.hpp>
 #include <htool/lrmat/sympartialACA.hpp>
 #include <htool/testing/generator_test.hpp>
 #include <htool/testing/geometry.hpp>
@@ -94,6 +96,7 @@ int test_hmat_cluster(int argc, char *argv[], double margin = 0) {
         HA.build(A, p1.data(), p2.data());
         HA.print_infos();
         auto info = HA.get_infos();
+        test      = test || !(info.count("Blocks_thread_busy_max") && info.count("Blocks_thread_idle_mean"));
 
         // Random vector
         vector<double> f(nc, 1);
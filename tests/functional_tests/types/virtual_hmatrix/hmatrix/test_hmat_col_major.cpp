@@ -0,0 +1,124 @@
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/lrmat/sympartialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Products with padded column-major panels against mvprod_local_to_local, before and after freezing the layout
+template <typename T>
+bool test_col_major(HMatrix<T> &H, int rank) {
+    bool test       = 0;
+    int local_size  = H.get_local_size();
+    int ld          = local_size + 3;
+    const T padding = 42;
+    for (bool freeze : {false, true}) {
+        if (freeze) {
+            H.freeze_layout();
+        }
+        for (int mu : {1, 4}) {
+            vector<T> f(local_size * mu), result(local_size * mu);
+            generate_random_vector(f);
+            H.mvprod_local_to_local(f.data(), result.data(), mu);
+
+            vector<T> f_padded(ld * mu, padding), result_padded(ld * mu, padding);
+            for (int i = 0; i < mu; i++) {
+                std::copy_n(f.data() + i * local_size, local_size, f_padded.data() + i * ld);
+            }
+            // Repeated products with a plan do not allocate
+            MatvecPlan<T> plan = H.create_matvec_plan(mu);
+            H.mvprod_local_to_local_col_major(f_padded.data(), ld, result_padded.data(), ld, plan);
+            std::size_t bytes = plan.get_bytes();
+            H.mvprod_local_to_local_col_major(f_padded.data(), ld, result_padded.data(), ld, plan);
+            test = test || !(plan.get_bytes() == bytes);
+
+            double error = 0, norm = 0;
+            for (int i = 0; i < mu; i++) {
+                for (int j = 0; j < local_size; j++) {
+                    error += std::norm(result_padded[j + i * ld] - result[j + i * local_size]);
+                    norm += std::norm(result[j + i * local_size]);
+                }
+                test = test || !(std::all_of(result_padded.begin() + i * ld + local_size, result_padded.begin() + (i + 1) * ld, [&](const T &x) { return x == padding; }));
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &error, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            MPI_Allreduce(MPI_IN_PLACE, &norm, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            error = std::sqrt(error / norm);
+            test  = test || !(error < 1e-12);
+
+            if (rank == 0) {
+                cout << "Symmetry: " << H.get_symmetry_type() << ", frozen: " << freeze << ", mu: " << mu << ", difference: " << error << endl;
+            }
+        }
+    }
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the number of processes
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test      = 0;
+    double epsilon = 1e-6;
+    double eta     = 10;
+
+    int n = 500;
+    vector<double> p(3 * n);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, 0, n, p.data());
+
+    // Local permutation, as required by mvprod_local_to_local
+    int size_numbering = n / size;
+    std::vector<int> MasterOffset;
+    for (int i = 0; i < size; i++) {
+        MasterOffset.push_back(i * size_numbering);
+        MasterOffset.push_back(i == size - 1 ? n - i * size_numbering : size_numbering);
+    }
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    t->build(n, p.data(), MasterOffset.data(), 2);
+
+    GeneratorTestDoubleSymmetric A_sym(3, n, n, p, p);
+    HMatrix<double> HA(t, t, epsilon, eta);
+    HA.set_compression(std::make_shared<partialACA<double>>());
+    HA.build(A_sym, p.data(), p.data());
+    test = test || test_col_major(HA, rank);
+
+    HMatrix<double> HA_sym(t, t, epsilon, eta, 'S', 'U');
+    HA_sym.set_compression(std::make_shared<sympartialACA<double>>());
+    HA_sym.build(A_sym, p.data());
+    test = test || test_col_major(HA_sym, rank);
+
+    GeneratorTestComplexHermitian A_herm(3, n, n, p, p);
+    HMatrix<complex<double>> HA_herm(t, t, epsilon, eta, 'H', 'L');
+    HA_herm.set_compression(std::make_shared<sympartialACA<complex<double>>>());
+    HA_herm.build(A_herm, p.data());
+    test = test || test_col_major(HA_herm, rank);
+
+    if (rank == 0) {
+        cout << "test: " << test << endl;
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/lrmat/sympartialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test      = 0;
+    double epsilon = 1e-8;
+    double eta     = 10;
+    int mu         = 3;
+
+    int n = 600;
+    vector<double> p(3 * n);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, 0, n, p.data());
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    t->build(n, p.data(), 2);
+    GeneratorTestDoubleSymmetric A(3, n, n, p, p);
+
+    vector<double> f(n * mu, 1);
+    generate_random_vector(f);
+    MPI_Bcast(f.data(), n * mu, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    HMatrix<double> HA(t, t, epsilon, eta);
+    HA.set_compression(std::make_shared<partialACA<double>>());
+    HA.build(A, p.data(), p.data());
+
+    HMatrix<double> HA_sym(t, t, epsilon, eta, 'S', 'U');
+    HA_sym.set_compression(std::make_shared<sympartialACA<double>>());
+    HA_sym.set_use_arena(true);
+    HA_sym.build(A, p.data());
+
+    for (HMatrix<double> *H : {&HA, &HA_sym}) {
+        vector<double> result(n * mu), result_transp(n * mu), result_vec(n), result_transp_vec(n);
+        H->mvprod_global_to_global(f.data(), result.data(), mu);
+        H->mvprod_transp_global_to_global(f.data(), result_transp.data(), mu);
+        H->mvprod_global_to_global(f.data(), result_vec.data(), 1);
+        H->mvprod_transp_global_to_global(f.data(), result_transp_vec.data(), 1);
+        Matrix<double> dense = H->get_local_dense();
+
+        test = test || H->get_frozen_layout();
+        H->freeze_layout();
+        test = test || !(H->get_frozen_layout() && H->get_frozen_layout_bytes() > 0);
+
+        // Only the order of the sums changes
+        vector<double> result_frozen(n * mu), result_transp_frozen(n * mu), result_vec_frozen(n), result_transp_vec_frozen(n);
+        H->mvprod_global_to_global(f.data(), result_frozen.data(), mu);
+        H->mvprod_transp_global_to_global(f.data(), result_transp_frozen.data(), mu);
+        H->mvprod_global_to_global(f.data(), result_vec_frozen.data(), 1);
+        H->mvprod_transp_global_to_global(f.data(), result_transp_vec_frozen.data(), 1);
+        double error = std::max({norm2(result - result_frozen) / norm2(result), norm2(result_transp - result_transp_frozen) / norm2(result_transp), norm2(result_vec - result_vec_frozen) / norm2(result_vec), norm2(result_transp_vec - result_transp_vec_frozen) / norm2(result_transp_vec)});
+        test         = test || !(error < 1e-14);
+
+        // Packed rows are split between the local and the remote part of the source, both products of the local parts agree
+        int local_size   = H->get_local_size();
+        int local_offset = H->get_local_offset();
+        vector<double> f_perm(n), f_perm_rows(n * mu), out_global(local_size * mu), out_local(local_size * mu);
+        for (int i = 0; i < mu; i++) {
+            H->source_to_cluster_permutation(f.data() + i * n, f_perm.data());
+            for (int j = 0; j < n; j++) {
+                f_perm_rows[i + j * mu] = f_perm[j];
+            }
+        }
+        H->mymvprod_global_to_local(f_perm_rows.data(), out_global.data(), mu);
+        H->mymvprod_local_to_local(f_perm_rows.data() + local_offset * mu, out_local.data(), mu);
+        test = test || !(out_global == out_local);
+
+        // Blocks are views on the frozen layout
+        test = test || !(normFrob(dense - H->get_local_dense()) == 0);
+
+        if (rank == 0) {
+            cout << "Symmetry: " << H->get_symmetry_type() << ", frozen layout bytes: " << H->get_frozen_layout_bytes() << ", difference with the blocks: " << error << endl;
+        }
+    }
+
+    if (rank == 0) {
+        cout << "test: " << test << endl;
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,126 @@
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/sympartialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Symmetric products with fused blocks against the same products without fusion, before and after freezing the layout
+template <typename T>
+bool test_fused_symmetric(HMatrix<T> &H, int rank) {
+    bool test      = 0;
+    int nr         = H.nb_rows();
+    int local_size = H.get_local_size();
+    vector<int> mus{1, 4};
+    vector<vector<T>> inputs(mus.size()), inputs_local(mus.size()), results(mus.size()), results_local(mus.size());
+    for (int k = 0; k < mus.size(); k++) {
+        int mu = mus[k];
+        inputs[k].resize(nr * mu);
+        inputs_local[k].resize(local_size * mu);
+        results[k].resize(nr * mu);
+        results_local[k].resize(local_size * mu);
+        generate_random_vector(inputs[k]);
+        generate_random_vector(inputs_local[k]);
+        MPI_Bcast(inputs[k].data(), nr * mu, wrapper_mpi<T>::mpi_type(), 0, MPI_COMM_WORLD);
+        MatvecPlan<T> plan = H.create_matvec_plan(mu);
+        H.mvprod_global_to_global(inputs[k].data(), results[k].data(), mu);
+        H.mvprod_local_to_local_col_major(inputs_local[k].data(), local_size, results_local[k].data(), local_size, plan);
+    }
+
+    // Every block of the local diagonal part is fused
+    H.set_fused_symmetric_products(true, 0);
+    for (bool freeze : {false, true}) {
+        if (freeze) {
+            H.freeze_layout();
+        }
+        for (int k = 0; k < mus.size(); k++) {
+            int mu = mus[k];
+            vector<T> result(nr * mu), result_local(local_size * mu);
+            MatvecPlan<T> plan = H.create_matvec_plan(mu);
+            H.mvprod_global_to_global(inputs[k].data(), result.data(), mu);
+            H.mvprod_local_to_local_col_major(inputs_local[k].data(), local_size, result_local.data(), local_size, plan);
+
+            double error = norm2(results[k] - result) / norm2(results[k]);
+            test         = test || !(error < 1e-12);
+
+            double error_local = 0, norm_local = 0;
+            for (int i = 0; i < local_size * mu; i++) {
+                error_local += std::norm(result_local[i] - results_local[k][i]);
+                norm_local += std::norm(results_local[k][i]);
+            }
+            MPI_Allreduce(MPI_IN_PLACE, &error_local, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            MPI_Allreduce(MPI_IN_PLACE, &norm_local, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            error_local = std::sqrt(error_local / norm_local);
+            test        = test || !(error_local < 1e-12);
+
+            if (rank == 0) {
+                cout << "Symmetry: " << H.get_symmetry_type() << ", frozen: " << freeze << ", mu: " << mu << ", difference: " << error << ", column-major difference: " << error_local << endl;
+            }
+        }
+    }
+    return test;
+}
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the number of processes
+    int size;
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test      = 0;
+    double epsilon = 1e-6;
+    double eta     = 10;
+
+    int n = 500;
+    vector<double> p(3 * n);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, 0, n, p.data());
+
+    // Local permutation, as required by mvprod_local_to_local
+    int size_numbering = n / size;
+    std::vector<int> MasterOffset;
+    for (int i = 0; i < size; i++) {
+        MasterOffset.push_back(i * size_numbering);
+        MasterOffset.push_back(i == size - 1 ? n - i * size_numbering : size_numbering);
+    }
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    t->build(n, p.data(), MasterOffset.data(), 2);
+
+    GeneratorTestDoubleSymmetric A_sym(3, n, n, p, p);
+    HMatrix<double> HA_sym(t, t, epsilon, eta, 'S', 'U');
+    HA_sym.set_compression(std::make_shared<sympartialACA<double>>());
+    HA_sym.build(A_sym, p.data());
+    test = test || test_fused_symmetric(HA_sym, rank);
+
+    GeneratorTestComplexHermitian A_herm(3, n, n, p, p);
+    HMatrix<complex<double>> HA_herm(t, t, epsilon, eta, 'H', 'L');
+    HA_herm.set_compression(std::make_shared<sympartialACA<complex<double>>>());
+    HA_herm.build(A_herm, p.data());
+    test = test || test_fused_symmetric(HA_herm, rank);
+
+    if (rank == 0) {
+        cout << "test: " << test << endl;
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,176 @@
+#include <atomic>
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/lrmat/sympartialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+#include <htool/types/kernel_cache.hpp>
+
+using namespace std;
+using namespace htool;
+
+class CountingGenerator : public GeneratorTestDouble {
+  public:
+    mutable std::atomic<int> nb_calls;
+    mutable std::atomic<int> nb_coefs;
+
+    CountingGenerator(int space_dim, int nr, int nc, const std::vector<double> &p1, const std::vector<double> &p2) : GeneratorTestDouble(space_dim, nr, nc, p1, p2), nb_calls(0), nb_coefs(0) {}
+
+    void copy_submatrix(int M, int N, const int *const rows, const int *const cols, double *ptr) const override {
+        nb_calls += 1;
+        nb_coefs += M * N;
+        GeneratorTestDouble::copy_submatrix(M, N, rows, cols, ptr);
+    }
+};
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test      = 0;
+    double epsilon = 1e-8;
+    double eta     = 100;
+
+    int nr = 500;
+    int nc = 400;
+
+    double z1 = 1;
+    double z2 = 1.5;
+    vector<double> p1(3 * nr);
+    vector<double> p2(3 * nc);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, z1, nr, p1.data());
+    create_disk(3, z2, nc, p2.data());
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    std::shared_ptr<Cluster<PCARegularClustering>> s = make_shared<Cluster<PCARegularClustering>>();
+    t->build(nr, p1.data(), 2);
+    s->build(nc, p2.data(), 2);
+
+    // Kernel cache alone, indices point to the permutations
+    {
+        CountingGenerator A(3, nr, nc, p1, p2);
+        KernelCache<double> cache(A, 150 * sizeof(double), *t, t->get_perm().data(), *s, s->get_perm().data());
+        const int *rows = t->get_perm().data();
+        const int *cols = s->get_perm().data();
+
+        vector<double> row(100), col(100), ref(100);
+        cache.copy_submatrix(1, 60, rows + 3, cols, row.data());
+        cache.copy_submatrix(1, 20, rows + 3, cols + 30, row.data());
+        A.copy_submatrix(1, 20, rows + 3, cols + 30, ref.data());
+        test = test || !(std::equal(ref.begin(), ref.begin() + 20, row.begin()));
+
+        cache.copy_submatrix(30, 1, rows + 5, cols + 7, col.data());
+        cache.copy_submatrix(10, 1, rows + 10, cols + 7, col.data());
+        A.copy_submatrix(10, 1, rows + 10, cols + 7, ref.data());
+        test = test || !(std::equal(ref.begin(), ref.begin() + 10, col.begin()));
+        test = test || !(cache.get_hits() == 2 && cache.get_misses() == 2);
+
+        // Partial overlap, only the missing coefficients are computed
+        int nb_coefs = A.nb_coefs;
+        cache.copy_submatrix(1, 20, rows + 3, cols + 50, row.data());
+        test = test || !(A.nb_coefs == nb_coefs + 10);
+        A.copy_submatrix(1, 20, rows + 3, cols + 50, ref.data());
+        test = test || !(std::equal(ref.begin(), ref.begin() + 20, row.begin()));
+        test = test || !(cache.get_hits() == 2 && cache.get_misses() == 3);
+
+        cache.copy_submatrix(1, 70, rows + 3, cols, row.data());
+        test = test || !(cache.get_hits() == 3 && cache.get_misses() == 3);
+
+        // Missing coefficients on both sides of a stored range
+        cache.copy_submatrix(1, 10, rows + 3, cols + 80, row.data());
+        nb_coefs = A.nb_coefs;
+        cache.copy_submatrix(1, 40, rows + 3, cols + 60, row.data());
+        test = test || !(A.nb_coefs == nb_coefs + 20);
+        A.copy_submatrix(1, 40, rows + 3, cols + 60, ref.data());
+        test = test || !(std::equal(ref.begin(), ref.begin() + 40, row.begin()));
+        test = test || !(cache.get_hits() == 3 && cache.get_misses() == 5);
+
+        // The first row is evicted to stay within the budget
+        cache.copy_submatrix(1, 60, rows + 3, cols + 200, row.data());
+        test = test || !(cache.get_stored_bytes() <= cache.get_budget());
+        cache.copy_submatrix(1, 20, rows + 3, cols + 30, row.data());
+        test = test || !(cache.get_hits() == 3 && cache.get_misses() == 7);
+
+        // Indices not pointing to the permutations and blocks are not stored
+        int nb_calls = A.nb_calls;
+        vector<int> indices(nc);
+        std::iota(indices.begin(), indices.end(), int(0));
+        cache.copy_submatrix(1, 20, rows + 3, indices.data(), row.data());
+        cache.copy_submatrix(1, 20, rows + 3, indices.data(), row.data());
+        cache.copy_submatrix(2, 2, rows, cols, row.data());
+        cache.copy_submatrix(2, 2, rows, cols, row.data());
+        test = test || !(A.nb_calls == nb_calls + 4);
+        test = test || !(cache.get_hits() == 3 && cache.get_misses() == 7);
+
+        if (rank == 0) {
+            cout << "Kernel cache hits : " << cache.get_hits() << ", misses : " << cache.get_misses() << endl;
+        }
+    }
+
+    // HMatrix, with a large eta so that there are false positives whose sons reuse rows and columns
+    vector<double> f(nc, 1);
+    generate_random_vector(f);
+    MPI_Bcast(f.data(), nc, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    std::vector<std::shared_ptr<VirtualLowRankGenerator<double>>> compressors{std::make_shared<partialACA<double>>(), std::make_shared<sympartialACA<double>>()};
+    for (auto &compressor : compressors) {
+        CountingGenerator A(3, nr, nc, p1, p2);
+
+        HMatrix<double> HA(t, s, epsilon, eta);
+        HA.set_compression(compressor);
+        HA.build(A, p1.data(), p2.data());
+        int nb_calls = A.nb_calls;
+        A.nb_calls   = 0;
+
+        HMatrix<double> HA_cache(t, s, epsilon, eta);
+        HA_cache.set_compression(compressor);
+        HA_cache.set_kernel_cache_budget(std::size_t(1) << 20);
+        HA_cache.build(A, p1.data(), p2.data());
+        HA_cache.print_infos();
+
+        // Same coefficients, so same blocks
+        test = test || !(HA_cache.get_kernel_cache_budget() == std::size_t(1) << 20);
+        test = test || !(A.nb_calls + HA_cache.get_kernel_cache_hits() == nb_calls);
+        test = test || !(HA.get_kernel_cache_hits() == 0 && HA.get_kernel_cache_misses() == 0);
+        if (rank == 0) {
+            test = test || !(StrToNbr<int>(HA_cache.get_infos("Number_of_false_positive")) > 0);
+            test = test || !(StrToNbr<std::size_t>(HA_cache.get_infos("Kernel_cache_hits")) > 0);
+        }
+
+        std::vector<double> result(nr, 0), result_cache(nr, 0);
+        HA.mvprod_global_to_global(f.data(), result.data(), 1);
+        HA_cache.mvprod_global_to_global(f.data(), result_cache.data(), 1);
+        double erreur_cache = norm2(result - result_cache) / norm2(result);
+        double erreur2      = norm2(A * f - result_cache) / norm2(A * f);
+        test                = test || !(erreur_cache < 1e-14);
+        test                = test || !(erreur2 < epsilon);
+
+        if (rank == 0) {
+            cout << "Kernel cache hits : " << HA_cache.get_infos("Kernel_cache_hits") << ", misses : " << HA_cache.get_infos("Kernel_cache_misses") << endl;
+            cout << "Difference with the reference : " << erreur_cache << endl;
+            cout << "Errors on a mat vec prod : " << erreur2 << endl;
+            cout << "test: " << test << endl;
+        }
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,139 @@
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/lrmat/sympartialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+#include <htool/types/matvec_plan.hpp>
+
+using namespace std;
+using namespace htool;
+
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test      = 0;
+    double epsilon = 1e-8;
+    double eta     = 10;
+    int mu         = 3;
+
+    int n = 600;
+    vector<double> p(3 * n);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, 0, n, p.data());
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    t->build(n, p.data(), 2);
+    GeneratorTestDoubleSymmetric A(3, n, n, p, p);
+
+    vector<double> f(n * mu, 1);
+    generate_random_vector(f);
+    MPI_Bcast(f.data(), n * mu, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    HMatrix<double> HA(t, t, epsilon, eta);
+    HA.set_compression(std::make_shared<partialACA<double>>());
+    HA.build(A, p.data(), p.data());
+
+    HMatrix<double> HA_sym(t, t, epsilon, eta, 'S', 'U');
+    HA_sym.set_compression(std::make_shared<sympartialACA<double>>());
+    HA_sym.build(A, p.data());
+
+    for (HMatrix<double> *H : {&HA, &HA_sym}) {
+        for (int nb_rhs : {1, mu}) {
+            MatvecPlan<double> plan = H->create_matvec_plan(nb_rhs);
+            test                    = test || !(plan.get_mu() == nb_rhs);
+
+            // Products with a plan give the same results as without
+            vector<double> result(n * nb_rhs), result_plan(n * nb_rhs), result_transp(n * nb_rhs), result_transp_plan(n * nb_rhs);
+            H->mvprod_global_to_global(f.data(), result.data(), nb_rhs);
+            H->mvprod_transp_global_to_global(f.data(), result_transp.data(), nb_rhs);
+            H->mvprod_global_to_global(f.data(), result_plan.data(), plan);
+            H->mvprod_transp_global_to_global(f.data(), result_transp_plan.data(), plan);
+            test = test || !(result == result_plan);
+            test = test || !(result_transp == result_transp_plan);
+
+            // Repeated products do not allocate once the buffers of the plan are large enough
+            std::size_t bytes = plan.get_bytes();
+            for (int k = 0; k < 3; k++) {
+                H->mvprod_global_to_global(f.data(), result_plan.data(), plan);
+                H->mvprod_transp_global_to_global(f.data(), result_transp_plan.data(), plan);
+            }
+            test = test || !(plan.get_bytes() == bytes);
+            test = test || !(result == result_plan);
+            test = test || !(result_transp == result_transp_plan);
+
+            // Products of the local parts
+            int local_size   = H->get_local_size();
+            int local_offset = H->get_local_offset();
+            vector<double> f_perm(n), f_perm_rows(n * nb_rhs), f_local(local_size * nb_rhs);
+            for (int i = 0; i < nb_rhs; i++) {
+                H->source_to_cluster_permutation(f.data() + i * n, f_perm.data());
+                for (int j = 0; j < n; j++) {
+                    f_perm_rows[i + j * nb_rhs] = f_perm[j];
+                }
+            }
+            std::copy_n(f_perm_rows.data() + local_offset * nb_rhs, local_size * nb_rhs, f_local.data());
+            vector<double> out_global(local_size * nb_rhs), out_local(local_size * nb_rhs), out_local_work(local_size * nb_rhs), work(n * nb_rhs);
+            H->mymvprod_global_to_local(f_perm_rows.data(), out_global.data(), plan);
+            H->mymvprod_local_to_local(f_local.data(), out_local.data(), plan);
+            H->mymvprod_local_to_local(f_local.data(), out_local_work.data(), nb_rhs, work.data());
+            test = test || !(out_global == out_local);
+            test = test || !(out_global == out_local_work);
+
+            // Only the halo of the source is exchanged, which is empty with one process
+            int size;
+            MPI_Comm_size(MPI_COMM_WORLD, &size);
+            double halo_size = StrToNbr<double>(H->get_infos("Matvec_halo_size_max"));
+            test             = test || !(halo_size < n && (size > 1 || halo_size == 0));
+
+            // Transposed products of the local parts, the sparse reduce-scatter gives the local part of the allreduce
+            if (H->get_symmetry_type() == 'N') {
+                vector<double> out_transp_global(n * nb_rhs), out_transp_local(local_size * nb_rhs);
+                H->mymvprod_transp_local_to_global(f_local.data(), out_transp_global.data(), plan);
+                H->mymvprod_transp_local_to_local(f_local.data(), out_transp_local.data(), plan);
+                vector<double> out_transp_global_local(out_transp_global.begin() + local_offset * nb_rhs, out_transp_global.begin() + (local_offset + local_size) * nb_rhs);
+                test = test || !(norm2(out_transp_global_local - out_transp_local) < 1e-14 * norm2(out_transp_global_local));
+            }
+
+            // Errors with respect to the dense product
+            double error = 0;
+            for (int i = 0; i < nb_rhs; i++) {
+                vector<double> f_i(f.begin() + i * n, f.begin() + (i + 1) * n);
+                vector<double> Af_i = A * f_i;
+                vector<double> result_i(result_plan.begin() + i * n, result_plan.begin() + (i + 1) * n);
+                error = std::max(error, norm2(Af_i - result_i) / norm2(Af_i));
+            }
+            test = test || !(error < epsilon);
+
+            if (rank == 0) {
+                cout << "Symmetry: " << H->get_symmetry_type() << ", mu: " << nb_rhs << ", plan bytes: " << plan.get_bytes() << ", halo: " << H->get_infos("Matvec_halo_size_max") << ", error: " << error << endl;
+            }
+        }
+    }
+
+    // Products without plan are counted as before
+    test = test || !(StrToNbr<int>(HA.get_infos("nb_mat_vec_prod")) > 0);
+    if (rank == 0) {
+        cout << "Number of products: " << HA.get_infos("nb_mat_vec_prod") << endl;
+        cout << "test: " << test << endl;
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
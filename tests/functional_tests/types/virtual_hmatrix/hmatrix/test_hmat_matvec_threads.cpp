@@ -0,0 +1,93 @@
+#include <complex>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Products of HMatrix built and applied with 1 and nb_threads threads are bitwise equal
+int main(int argc, char *argv[]) {
+
+    // Initialize the MPI environment
+    MPI_Init(&argc, &argv);
+
+    // Get the rank of the process
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    //
+    bool test      = 0;
+    double epsilon = 1e-6;
+    double eta     = 10;
+    int nb_threads = 4;
+    int mu         = 3;
+
+    int nr = 800;
+    int nc = 600;
+
+    double z1 = 1;
+    double z2 = 1.5;
+    vector<double> p1(3 * nr);
+    vector<double> p2(3 * nc);
+
+    srand(1);
+    // we set a constant seed for rand because we want always the same result if we run the check many times
+    // (two different initializations with the same seed will generate the same succession of results in the subsequent calls to rand)
+    create_disk(3, z1, nr, p1.data());
+    create_disk(3, z2, nc, p2.data());
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    std::shared_ptr<Cluster<PCARegularClustering>> s = make_shared<Cluster<PCARegularClustering>>();
+    t->build(nr, p1.data(), 2);
+    s->build(nc, p2.data(), 2);
+
+    GeneratorTestDouble A(3, nr, nc, p1, p2);
+    GeneratorTestDoubleSymmetric A_sym(3, nr, nr, p1, p1);
+
+    vector<double> f(nc * mu, 1), g(nr * mu, 1);
+    generate_random_vector(f);
+    generate_random_vector(g);
+    MPI_Bcast(f.data(), nc * mu, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(g.data(), nr * mu, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    // Products for each number of threads, both the build and the products use it
+    vector<vector<double>> results;
+    for (int nb : {1, nb_threads}) {
+#if _OPENMP
+        omp_set_num_threads(nb);
+#endif
+        HMatrix<double> HA(t, s, epsilon, eta);
+        HA.build(A, p1.data(), p2.data());
+        HMatrix<double> HA_sym(t, t, epsilon, eta, 'S', 'U');
+        HA_sym.build(A_sym, p1.data());
+
+        vector<double> result(nr * mu, 0), transp_result(nc * mu, 0), sym_result(nr * mu, 0);
+        HA.mvprod_global_to_global(f.data(), result.data(), mu);
+        HA.mvprod_transp_global_to_global(g.data(), transp_result.data(), mu);
+        HA_sym.mvprod_global_to_global(g.data(), sym_result.data(), mu);
+        results.push_back(result);
+        results.push_back(transp_result);
+        results.push_back(sym_result);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        test = test || !(results[i] == results[i + 3]);
+    }
+
+    if (rank == 0) {
+        cout << "Products with 1 and " << nb_threads << " threads are equal: " << !test << endl;
+        cout << "test: " << test << endl;
+    }
+
+    // Finalize the MPI environment.
+    MPI_Finalize();
+    return test;
+}
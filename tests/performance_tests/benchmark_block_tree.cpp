@@ -0,0 +1,63 @@
+#include <iostream>
+#include <vector>
+
+#include <htool/blocks/blocks.hpp>
+#include <htool/clustering/flat_cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/misc/user.hpp>
+#include <htool/testing/geometry.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Mean time of the construction of the block tree of t and s, maximum over the processes, and offsets and sizes of the local blocks
+double time_block_tree(const VirtualCluster &t, const VirtualCluster &s, int nrepeat, vector<int> &blocks) {
+    RjasanowSteinbach admissibility_condition;
+    MPI_Barrier(MPI_COMM_WORLD);
+    double time = MPI_Wtime();
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        Block block(&admissibility_condition, t, s);
+        block.build('N');
+        blocks.clear();
+        for (const Block *task : block.get_local_tasks()) {
+            blocks.insert(blocks.end(), {task->get_target_cluster().get_offset(), task->get_target_cluster().get_size(), task->get_source_cluster().get_offset(), task->get_source_cluster().get_size()});
+        }
+    }
+    time = (MPI_Wtime() - time) / nrepeat;
+    MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return time;
+}
+
+int main(int argc, char *argv[]) {
+    // Usage: Benchmark_block_tree [number of points] [number of repetitions]
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int n       = argc > 1 ? StrToNbr<int>(argv[1]) : 200000;
+    int nrepeat = argc > 2 ? StrToNbr<int>(argv[2]) : 5;
+
+    vector<double> p(3 * n);
+    srand(1);
+    create_disk(3, 0, n, p.data());
+
+    Cluster<PCARegularClustering> t;
+    t.build(n, p.data(), 2);
+
+    double time_copy = MPI_Wtime();
+    FlatCluster flat(t);
+    time_copy = MPI_Wtime() - time_copy;
+
+    // Same block tree on the cluster tree and its flat copy
+    vector<int> blocks, blocks_flat;
+    double time      = time_block_tree(t, t, nrepeat, blocks);
+    double time_flat = time_block_tree(flat, flat, nrepeat, blocks_flat);
+    bool test        = !(blocks == blocks_flat);
+
+    if (rank == 0) {
+        cout << "Block tree of " << n << " points, " << blocks.size() / 4 << " local blocks, Cluster : " << time << " s, FlatCluster : " << time_flat << " s, speedup : " << time / time_flat << ", copy of the cluster tree : " << time_copy << " s" << endl;
+    }
+
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,81 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/bounding_box_1.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/misc/user.hpp>
+#include <htool/testing/geometry.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Mean time of the build of a cluster tree
+template <typename ClusterType>
+double time_build(int n, const vector<double> &p, int nrepeat) {
+    auto start = chrono::steady_clock::now();
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        ClusterType t;
+        t.build(n, p.data(), 2, MPI_COMM_SELF);
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count() / nrepeat;
+}
+
+int main(int argc, char *argv[]) {
+    // Usage: Benchmark_cluster_build [number of points] [number of repetitions]
+    MPI_Init(&argc, &argv);
+
+    int n       = argc > 1 ? StrToNbr<int>(argv[1]) : 1000000;
+    int nrepeat = argc > 2 ? StrToNbr<int>(argv[2]) : 5;
+    bool test   = 0;
+
+    vector<double> p(3 * n);
+    srand(1);
+    create_disk(3, 0, n, p.data());
+
+    // Splitting of the root in two sons against a full sort along the direction, as regular_splitting did before
+    Cluster<PCARegularClustering> t;
+    t.build(n, p.data(), 2, MPI_COMM_SELF);
+    vector<double> dir{0.6, 0.8, 0};
+    vector<int> num(n), num_sorted(n);
+    double time_sort = 0, time_split = 0;
+    vector<vector<int>> numbering;
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        for (int j = 0; j < n; j++) {
+            num[j] = num_sorted[j] = j;
+        }
+        auto start = chrono::steady_clock::now();
+        std::sort(num_sorted.begin(), num_sorted.end(), [&](int a, int b) {
+            double c = std::inner_product(p.data() + 3 * a, p.data() + 3 * (1 + a), dir.data(), double(0));
+            double d = std::inner_product(p.data() + 3 * b, p.data() + 3 * (1 + b), dir.data(), double(0));
+            return c < d;
+        });
+        time_sort += chrono::duration<double>(chrono::steady_clock::now() - start).count() / nrepeat;
+
+        start     = chrono::steady_clock::now();
+        numbering = regular_splitting(p.data(), num, t.get_root(), 2, dir);
+
+        time_split += chrono::duration<double>(chrono::steady_clock::now() - start).count() / nrepeat;
+    }
+
+    // Same sons up to the way along the direction
+    std::sort(numbering[0].begin(), numbering[0].end());
+    vector<int> first(num_sorted.begin(), num_sorted.begin() + n / 2), last(num_sorted.rbegin(), num_sorted.rbegin() + n / 2);
+    std::sort(first.begin(), first.end());
+    std::sort(last.begin(), last.end());
+    test = test || !(numbering[0] == first || numbering[0] == last);
+    cout << "Splitting of " << n << " points, sort : " << time_sort << " s, regular_splitting : " << time_split << " s, speedup : " << time_sort / time_split << ", test : " << test << endl;
+
+    // Build of whole trees
+    double time = time_build<Cluster<PCARegularClustering>>(n, p, nrepeat);
+    cout << "PCA, regular splitting : " << time << " s, " << n / time << " points/s" << endl;
+    time = time_build<Cluster<PCAGeometricClustering>>(n, p, nrepeat);
+    cout << "PCA, geometric splitting : " << time << " s, " << n / time << " points/s" << endl;
+    time = time_build<Cluster<BoundingBox1RegularClustering>>(n, p, nrepeat);
+    cout << "BoundingBox1, regular splitting : " << time << " s, " << n / time << " points/s" << endl;
+    time = time_build<Cluster<BoundingBox1GeometricClustering>>(n, p, nrepeat);
+    cout << "BoundingBox1, geometric splitting : " << time << " s, " << n / time << " points/s" << endl;
+
+    MPI_Finalize();
+    return test;
+}
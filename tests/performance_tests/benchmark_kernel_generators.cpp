@@ -0,0 +1,66 @@
+#include <chrono>
+#include <complex>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+#include <htool/misc/user.hpp>
+#include <htool/testing/generator_test.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/testing/kernel_generators.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Computes the whole matrix by square blocks of block_size rows and columns, as in the assembly of the dense blocks of an HMatrix, and returns the number of coefficients computed per second
+template <typename T>
+double coefficients_per_second(const VirtualGenerator<T> &generator, const vector<int> &perm, int block_size, int nrepeat) {
+    int n = perm.size();
+    vector<T> block(block_size * block_size);
+    double time = 0;
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        auto start = chrono::steady_clock::now();
+        for (int j = 0; j < n; j += block_size) {
+            for (int i = 0; i < n; i += block_size) {
+                int M = min(block_size, n - i);
+                int N = min(block_size, n - j);
+                generator.copy_submatrix(M, N, perm.data() + i, perm.data() + j, block.data());
+            }
+        }
+        time += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return double(n) * n * nrepeat / time;
+}
+
+int main(int argc, char *argv[]) {
+    // Usage: Benchmark_kernel_generators [number of points] [block size] [number of repetitions]
+    int n          = argc > 1 ? StrToNbr<int>(argv[1]) : 4000;
+    int block_size = argc > 2 ? StrToNbr<int>(argv[2]) : 128;
+    int nrepeat    = argc > 3 ? StrToNbr<int>(argv[3]) : 3;
+
+    vector<double> p(3 * n);
+    srand(1);
+    create_disk(3, 1, n, p.data());
+
+    // Indices in random order as in a cluster permutation
+    vector<int> perm(n);
+    iota(perm.begin(), perm.end(), 0);
+    for (int i = n - 1; i > 0; i--) {
+        swap(perm[i], perm[rand() % (i + 1)]);
+    }
+
+    GeneratorTestDouble reference_double(3, n, n, p, p);
+    GeneratorTestComplex reference_complex(3, n, n, p, p);
+    LaplaceSingleLayerGenerator laplace(n, p.data());
+    YukawaSingleLayerGenerator yukawa(1, n, p.data());
+    HelmholtzSingleLayerGenerator helmholtz(10, n, p.data());
+
+    cout << "Number of points : " << n << ", block size : " << block_size << endl;
+    cout << "GeneratorTestDouble : " << coefficients_per_second(reference_double, perm, block_size, nrepeat) << " coefficients per second" << endl;
+    cout << "Laplace : " << coefficients_per_second(laplace, perm, block_size, nrepeat) << " coefficients per second" << endl;
+    cout << "Yukawa : " << coefficients_per_second(yukawa, perm, block_size, nrepeat) << " coefficients per second" << endl;
+    cout << "GeneratorTestComplex : " << coefficients_per_second(reference_complex, perm, block_size, nrepeat) << " coefficients per second" << endl;
+    cout << "Helmholtz : " << coefficients_per_second(helmholtz, perm, block_size, nrepeat) << " coefficients per second" << endl;
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/partialACA.hpp>
+#include <htool/misc/user.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/testing/kernel_generators.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Mean time of a product with mu right-hand sides, maximum over the processes
+double time_per_product(const HMatrix<double> &HA, const vector<double> &f, vector<double> &result, int mu, int nrepeat) {
+    MatvecPlan<double> plan = HA.create_matvec_plan(mu);
+    HA.mvprod_global_to_global(f.data(), result.data(), plan);
+    MPI_Barrier(HA.get_comm());
+    double time = MPI_Wtime();
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        HA.mvprod_global_to_global(f.data(), result.data(), plan);
+    }
+    time = (MPI_Wtime() - time) / nrepeat;
+    MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, HA.get_comm());
+    return time;
+}
+
+int main(int argc, char *argv[]) {
+    // Usage: Benchmark_matvec_layout [number of points] [number of repetitions]
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int n       = argc > 1 ? StrToNbr<int>(argv[1]) : 20000;
+    int nrepeat = argc > 2 ? StrToNbr<int>(argv[2]) : 10;
+    bool test   = 0;
+
+    vector<double> p(3 * n);
+    srand(1);
+    create_disk(3, 0, n, p.data());
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    t->build(n, p.data(), 2);
+    LaplaceSingleLayerGenerator laplace(n, p.data());
+
+    HMatrix<double> HA(t, t, 1e-6, 10);
+    HA.set_compression(std::make_shared<partialACA<double>>());
+    HA.build(laplace, p.data(), p.data());
+
+    vector<int> mus{1, 32};
+    vector<vector<double>> inputs(mus.size()), results(mus.size());
+    vector<double> times(mus.size());
+    for (int k = 0; k < mus.size(); k++) {
+        inputs[k].resize(n * mus[k]);
+        results[k].resize(n * mus[k]);
+        generate_random_vector(inputs[k]);
+        MPI_Bcast(inputs[k].data(), n * mus[k], MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        times[k] = time_per_product(HA, inputs[k], results[k], mus[k], nrepeat);
+    }
+
+    HA.freeze_layout();
+
+    if (rank == 0) {
+        cout << "Number of points : " << n << ", frozen layout bytes : " << HA.get_frozen_layout_bytes() << endl;
+    }
+    for (int k = 0; k < mus.size(); k++) {
+        vector<double> result_frozen(n * mus[k]);
+        double time_frozen = time_per_product(HA, inputs[k], result_frozen, mus[k], nrepeat);
+        double difference  = norm2(results[k] - result_frozen) / norm2(results[k]);
+        test               = test || !(difference < 1e-12);
+        if (rank == 0) {
+            cout << "mu : " << mus[k] << ", blocks : " << times[k] << " s, frozen layout : " << time_frozen << " s, speedup : " << times[k] / time_frozen << ", difference : " << difference << endl;
+        }
+    }
+
+    MPI_Finalize();
+    return test;
+}
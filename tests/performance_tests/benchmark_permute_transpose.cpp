@@ -0,0 +1,84 @@
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/misc/permute_transpose.hpp>
+#include <htool/misc/user.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/geometry.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Permutation and transposition of the input and back, as the products with mu right-hand sides did before the fused kernels
+double time_separate_passes(const vector<int> &perm, const vector<double> &in, vector<double> &in_perm, vector<double> &out, int mu, int nrepeat) {
+    int n = perm.size();
+    vector<double> buffer(n);
+    auto start = chrono::steady_clock::now();
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        for (int i = 0; i < mu; i++) {
+            for (int j = 0; j < n; j++) {
+                buffer[j] = in[perm[j] + i * n];
+            }
+            for (int j = 0; j < n; j++) {
+                in_perm[i + j * mu] = buffer[j];
+            }
+        }
+        for (int i = 0; i < mu; i++) {
+            for (int j = 0; j < n; j++) {
+                buffer[j] = in_perm[i + j * mu];
+            }
+            for (int j = 0; j < n; j++) {
+                out[perm[j] + i * n] = buffer[j];
+            }
+        }
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count() / nrepeat;
+}
+
+double time_fused_kernels(const vector<int> &perm, const vector<double> &in, vector<double> &in_perm, vector<double> &out, int mu, int nrepeat) {
+    int n      = perm.size();
+    auto start = chrono::steady_clock::now();
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        gather_transpose(n, mu, perm.data(), 0, in.data(), n, in_perm.data());
+        scatter_transpose(n, mu, perm.data(), 0, in_perm.data(), out.data(), n);
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count() / nrepeat;
+}
+
+int main(int argc, char *argv[]) {
+    // Usage: Benchmark_permute_transpose [number of points] [number of repetitions]
+    MPI_Init(&argc, &argv);
+
+    int n       = argc > 1 ? StrToNbr<int>(argv[1]) : 100000;
+    int nrepeat = argc > 2 ? StrToNbr<int>(argv[2]) : 10;
+    bool test   = 0;
+
+    // Permutation of a cluster tree, as in the products
+    vector<double> p(3 * n);
+    srand(1);
+    create_disk(3, 0, n, p.data());
+    Cluster<PCARegularClustering> t;
+    t.build(n, p.data(), 2, MPI_COMM_SELF);
+    const vector<int> &perm = t.get_perm();
+
+    cout << "Number of points : " << n << endl;
+    for (int mu : {1, 8, 64}) {
+        vector<double> in(std::size_t(n) * mu), in_perm(in.size()), in_perm_fused(in.size()), out(in.size()), out_fused(in.size());
+        generate_random_vector(in);
+
+        double time       = time_separate_passes(perm, in, in_perm, out, mu, nrepeat);
+        double time_fused = time_fused_kernels(perm, in, in_perm_fused, out_fused, mu, nrepeat);
+        test              = test || !(in_perm == in_perm_fused && out == in && out_fused == in);
+
+        // Each round trip reads and writes the panel twice
+        double bytes = 4. * n * mu * sizeof(double);
+        cout << "mu : " << mu << ", separate passes : " << bytes / time * 1e-9 << " GB/s, fused : " << bytes / time_fused * 1e-9 << " GB/s, speedup : " << time / time_fused << endl;
+    }
+
+    cout << "test: " << test << endl;
+    MPI_Finalize();
+    return test;
+}
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <vector>
+
+#include <htool/clustering/cluster.hpp>
+#include <htool/clustering/pca.hpp>
+#include <htool/lrmat/sympartialACA.hpp>
+#include <htool/misc/user.hpp>
+#include <htool/testing/generator_input.hpp>
+#include <htool/testing/geometry.hpp>
+#include <htool/testing/kernel_generators.hpp>
+#include <htool/types/hmatrix.hpp>
+
+using namespace std;
+using namespace htool;
+
+// Mean time of a product with one right-hand side, maximum over the processes
+double time_per_product(const HMatrix<double> &HA, const vector<double> &f, vector<double> &result, int nrepeat) {
+    MatvecPlan<double> plan = HA.create_matvec_plan(1);
+    HA.mvprod_global_to_global(f.data(), result.data(), plan);
+    MPI_Barrier(HA.get_comm());
+    double time = MPI_Wtime();
+    for (int repeat = 0; repeat < nrepeat; repeat++) {
+        HA.mvprod_global_to_global(f.data(), result.data(), plan);
+    }
+    time = (MPI_Wtime() - time) / nrepeat;
+    MPI_Allreduce(MPI_IN_PLACE, &time, 1, MPI_DOUBLE, MPI_MAX, HA.get_comm());
+    return time;
+}
+
+// Bytes of the coefficients read by a symmetric product: blocks of the local diagonal part are read twice, except
+// for the fused ones whose dense coefficients or factor U are read once
+double bytes_per_product(const HMatrix<double> &HA, bool fused, std::size_t min_bytes) {
+    double bytes = HA.get_payload_bytes();
+    for (const LowRankMatrix<double> *lrmat : HA.get_MyDiagFarFieldMats()) {
+        if (lrmat->get_offset_i() != lrmat->get_offset_j()) {
+            double U_bytes = double(lrmat->rank_of()) * lrmat->nb_rows() * sizeof(double);
+            bytes += double(lrmat->rank_of()) * lrmat->nb_cols() * sizeof(double) + ((fused && U_bytes >= min_bytes) ? 0 : U_bytes);
+        }
+    }
+    for (const SubMatrix<double> *dense : HA.get_MyDiagNearFieldMats()) {
+        double dense_bytes = double(dense->nb_rows()) * dense->nb_cols() * sizeof(double);
+        if (dense->get_offset_i() != dense->get_offset_j() && !(fused && dense_bytes >= min_bytes)) {
+            bytes += dense_bytes;
+        }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &bytes, 1, MPI_DOUBLE, MPI_SUM, HA.get_comm());
+    return bytes;
+}
+
+int main(int argc, char *argv[]) {
+    // Usage: Benchmark_symmetric_matvec [number of points] [number of repetitions]
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int n       = argc > 1 ? StrToNbr<int>(argv[1]) : 20000;
+    int nrepeat = argc > 2 ? StrToNbr<int>(argv[2]) : 10;
+    bool test   = 0;
+
+    // Fused kernel against two calls to gemv on square blocks, the fused one reads the block once
+    if (rank == 0) {
+        for (int size : {256, 1024, 2048}) {
+            vector<double> coefficients(std::size_t(size) * size), x_c(size), x_r(size), y_r(size, 0), y_c(size, 0), y_r_fused(size, 0), y_c_fused(size, 0);
+            generate_random_vector(coefficients);
+            generate_random_vector(x_c);
+            generate_random_vector(x_r);
+            Matrix<double> A;
+            A.assign(size, size, coefficients.data(), false);
+            int kernel_nrepeat = std::max(1, int(nrepeat * (std::size_t(1) << 24) / coefficients.size()));
+
+            double time = MPI_Wtime();
+            for (int repeat = 0; repeat < kernel_nrepeat; repeat++) {
+                A.add_mvprod_col_major(x_c.data(), size, y_r.data(), size, 1, 'N');
+                A.add_mvprod_col_major(x_r.data(), size, y_c.data(), size, 1, 'T');
+            }
+            time = (MPI_Wtime() - time) / kernel_nrepeat;
+
+            double time_fused = MPI_Wtime();
+            for (int repeat = 0; repeat < kernel_nrepeat; repeat++) {
+                A.add_mvprod_and_transp(x_c.data(), y_r_fused.data(), x_r.data(), y_c_fused.data(), 'T');
+            }
+            time_fused = (MPI_Wtime() - time_fused) / kernel_nrepeat;
+
+            double difference = (norm2(y_r - y_r_fused) + norm2(y_c - y_c_fused)) / (norm2(y_r) + norm2(y_c));
+            test              = test || !(difference < 1e-12);
+            cout << "Block " << size << " x " << size << ", two gemv : " << time << " s, fused : " << time_fused << " s, speedup : " << time / time_fused << ", difference : " << difference << endl;
+        }
+    }
+
+    vector<double> p(3 * n);
+    srand(1);
+    create_disk(3, 0, n, p.data());
+
+    std::shared_ptr<Cluster<PCARegularClustering>> t = make_shared<Cluster<PCARegularClustering>>();
+    t->build(n, p.data(), 2);
+    LaplaceSingleLayerGenerator laplace(n, p.data());
+
+    HMatrix<double> HA(t, t, 1e-6, 10, 'S', 'U');
+    HA.set_compression(std::make_shared<sympartialACA<double>>());
+    HA.build(laplace, p.data());
+
+    vector<double> f(n), result(n), result_fused(n);
+    generate_random_vector(f);
+    MPI_Bcast(f.data(), n, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    // Every block fused, and only the ones saving at least 1 MiB of reads
+    double bytes = bytes_per_product(HA, false, 0);
+    double time  = time_per_product(HA, f, result, nrepeat);
+    if (rank == 0) {
+        cout << "Number of points : " << n << ", separate : " << time << " s, " << bytes / time * 1e-9 << " GB/s" << endl;
+    }
+    for (std::size_t min_bytes : {std::size_t(0), std::size_t(1) << 20}) {
+        HA.set_fused_symmetric_products(true, min_bytes);
+        double bytes_fused = bytes_per_product(HA, true, min_bytes);
+        double time_fused  = time_per_product(HA, f, result_fused, nrepeat);
+        double difference  = norm2(result - result_fused) / norm2(result);
+        test               = test || !(difference < 1e-12);
+        if (rank == 0) {
+            cout << "Fused above " << min_bytes << " bytes : " << time_fused << " s, " << bytes_fused / time_fused * 1e-9 << " GB/s, bytes read : " << bytes_fused / bytes << " of separate, speedup : " << time / time_fused << ", difference : " << difference << endl;
+        }
+    }
+
+    MPI_Finalize();
+    return test;
+}